@@ -0,0 +1,77 @@
+import hashlib
+import struct
+
+# Checksum files starting with this line use the named algorithm, files
+# without it are MD5
+algorithmTag = "algorithm "
+
+def fileMD5(file):
+	f = open(file, "rb")
+	blockSize = 2**20
+	md5 = hashlib.md5()
+	while True:
+		data = f.read(blockSize)
+		if not data:
+			break
+		md5.update(data)
+	f.close()
+	return md5.hexdigest()
+
+mask64 = 2**64 - 1
+prime1 = 0x9E3779B185EBCA87
+prime2 = 0xC2B2AE3D27D4EB4F
+prime3 = 0x165667B19E3779F9
+prime4 = 0x85EBCA77C2B2AE63
+prime5 = 0x27D4EB2F165667C5
+
+def rotl64(x, r):
+	return ((x << r) | (x >> (64 - r))) & mask64
+
+def xxh64Round(acc, value):
+	acc = (acc + value * prime2) & mask64
+	return (rotl64(acc, 31) * prime1) & mask64
+
+def xxh64(data):
+	length = len(data)
+	p = 0
+	if length >= 32:
+		v = [(prime1 + prime2) & mask64, prime2, 0, (-prime1) & mask64]
+		while p + 32 <= length:
+			lanes = struct.unpack_from("<4Q", data, p)
+			for i in range(4):
+				v[i] = xxh64Round(v[i], lanes[i])
+			p += 32
+		h = (rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18)) & mask64
+		for i in range(4):
+			h = ((h ^ xxh64Round(0, v[i])) * prime1 + prime4) & mask64
+	else:
+		h = prime5
+	h = (h + length) & mask64
+	while p + 8 <= length:
+		h ^= xxh64Round(0, struct.unpack_from("<Q", data, p)[0])
+		h = (rotl64(h, 27) * prime1 + prime4) & mask64
+		p += 8
+	if p + 4 <= length:
+		h ^= (struct.unpack_from("<I", data, p)[0] * prime1) & mask64
+		h = (rotl64(h, 23) * prime2 + prime3) & mask64
+		p += 4
+	while p < length:
+		h ^= (bytearray(data[p:p + 1])[0] * prime5) & mask64
+		h = (rotl64(h, 11) * prime1) & mask64
+		p += 1
+	h ^= h >> 33
+	h = (h * prime2) & mask64
+	h ^= h >> 29
+	h = (h * prime3) & mask64
+	h ^= h >> 32
+	return "%016x" % h
+
+def fileXXH64(file):
+	f = open(file, "rb")
+	data = f.read()
+	f.close()
+	try:
+		import xxhash
+		return xxhash.xxh64(data).hexdigest()
+	except ImportError:
+		return xxh64(data)
@@ -0,0 +1,132 @@
+import os
+import shutil
+import sys
+
+from FileHashes import algorithmTag, fileMD5, fileXXH64
+
+# Clients further behind than this fall back to the full checksum list
+maxChangesRevisions = 50
+
+def buildManifest(dir):
+	manifest = {}
+	for root, dirs, files in os.walk(dir):
+		for file in files:
+			fPath = root + "/" + file
+			manifest[os.path.relpath(fPath, dir).replace("\\", "/")] = fileMD5(fPath)
+	return manifest
+
+def readManifest(path):
+	manifest = {}
+	if not os.path.exists(path):
+		return manifest
+	f = open(path, "r")
+	for line in f:
+		fields = line.strip().split(":")
+		if len(fields) == 2:
+			manifest[fields[0]] = fields[1]
+	f.close()
+	return manifest
+
+# Newer clients read the lists tagged with a faster algorithm, MD5 lists stay
+# for older ones and to tell which files changed
+def buildFastManifest(dir, manifest, oldManifest, oldFastManifest):
+	fastManifest = {}
+	for fPath in manifest:
+		if oldManifest.get(fPath) == manifest[fPath] and fPath in oldFastManifest:
+			fastManifest[fPath] = oldFastManifest[fPath]
+		else:
+			fastManifest[fPath] = fileXXH64(dir + "/" + fPath)
+	return fastManifest
+
+def writeManifest(path, manifest, algorithm=None):
+	f = open(path, "w")
+	if algorithm:
+		f.write(algorithmTag + algorithm + '\n')
+	for fPath in sorted(manifest):
+		f.write(fPath + ":" + manifest[fPath] + '\n')
+	f.close()
+
+def writeChanges(path, revision, old, new, checksums=None, algorithm=None):
+	checksums = checksums or new
+	f = open(path, "w")
+	if algorithm:
+		f.write(algorithmTag + algorithm + '\n')
+	f.write("revision " + str(revision) + '\n')
+	for fPath in sorted(new):
+		if old.get(fPath) != new[fPath]:
+			f.write("+" + fPath + ":" + checksums[fPath] + '\n')
+	for fPath in sorted(old):
+		if fPath not in new:
+			f.write("-" + fPath + '\n')
+	f.close()
+
+if len(sys.argv) != 3:
+	print("Usage: PublishStations.py <catalog dir> <publish dir>")
+	sys.exit(1)
+
+catalogDir = sys.argv[1]
+publishDir = sys.argv[2]
+manifestsDir = publishDir + "/manifests"
+changesDir = publishDir + "/changes"
+fastChangesDir = publishDir + "/changes2"
+
+for dir in [publishDir, manifestsDir, changesDir, fastChangesDir]:
+	if not os.path.exists(dir):
+		os.mkdir(dir)
+
+revision = 0
+if os.path.exists(publishDir + "/revision"):
+	fRevision = open(publishDir + "/revision", "r")
+	revision = int(fRevision.read().strip())
+	fRevision.close()
+
+oldManifest = readManifest(publishDir + "/checksums")
+newManifest = buildManifest(catalogDir)
+if revision != 0 and newManifest == oldManifest:
+	if not os.path.exists(publishDir + "/checksums2"):
+		writeManifest(publishDir + "/checksums2", buildFastManifest(catalogDir,
+			newManifest, {}, {}), "xxh64")
+	print("Catalog unchanged at revision " + str(revision))
+	sys.exit(0)
+
+revision += 1
+
+newFastManifest = buildFastManifest(catalogDir, newManifest, oldManifest,
+	readManifest(publishDir + "/checksums2"))
+
+for fPath in newManifest:
+	if oldManifest.get(fPath) != newManifest[fPath]:
+		dest = publishDir + "/" + fPath
+		if not os.path.exists(os.path.dirname(dest)):
+			os.makedirs(os.path.dirname(dest))
+		shutil.copy(catalogDir + "/" + fPath, dest)
+for fPath in oldManifest:
+	if fPath not in newManifest:
+		os.remove(publishDir + "/" + fPath)
+
+writeManifest(manifestsDir + "/" + str(revision), newManifest)
+
+# Every kept revision gets the changes that bring it up to this one, so a
+# client needs a single request whatever revision it is at
+for oldRevision in range(1, revision + 1):
+	manifestPath = manifestsDir + "/" + str(oldRevision)
+	changesPath = changesDir + "/" + str(oldRevision)
+	fastChangesPath = fastChangesDir + "/" + str(oldRevision)
+	if oldRevision <= revision - maxChangesRevisions:
+		for path in [manifestPath, changesPath, fastChangesPath]:
+			if os.path.exists(path):
+				os.remove(path)
+	elif os.path.exists(manifestPath):
+		oldRevisionManifest = readManifest(manifestPath)
+		writeChanges(changesPath, revision, oldRevisionManifest, newManifest)
+		writeChanges(fastChangesPath, revision, oldRevisionManifest,
+			newManifest, newFastManifest, "xxh64")
+
+# Clients read the revision before the checksums, so the checksums go first
+writeManifest(publishDir + "/checksums", newManifest)
+writeManifest(publishDir + "/checksums2", newFastManifest, "xxh64")
+fRevision = open(publishDir + "/revision", "w")
+fRevision.write(str(revision) + '\n')
+fRevision.close()
+
+print("Published revision " + str(revision))
@@ -1,20 +1,9 @@
 import subprocess as sub
 import datetime as dt
-import hashlib
 import shutil
 import os
 
-def fileMD5(file):
-	f = open(file, "rb")
-	blockSize = 2**20
-	md5 = hashlib.md5()
-	while True:
-		data = f.read(blockSize)
-		if not data:
-			break
-		md5.update(data)
-	f.close()
-	return md5.hexdigest()
+from FileHashes import algorithmTag, fileMD5, fileXXH64
 
 def releaseForArchitecture(arch):
 	sub.Popen("symstore add /r /f " + arch + "\Release\*.* /s \"" + os.environ["SYMBOLPATH"] + "\" /t \"InternetRadio\" /v \"" + gitTag + "\" /c \"" + timeStamp + "\"")
@@ -26,15 +15,20 @@ def releaseForArchitecture(arch):
 	shutil.copy(binDirArch + "/InternetRadio.pdb", outDirArch)
 	shutil.copy("dependencies/bass/bin/" + arch + "/bass.dll", outDirArch)
 	shutil.copy("data/language.json", outDirArch)
+	# Older versions read the MD5 list, newer ones the tagged XXH64 list
 	fChecksums = open(outDirArch + "/checksums", "w")
+	fChecksums2 = open(outDirArch + "/checksums2", "w")
+	fChecksums2.write(algorithmTag + "xxh64" + '\n')
 	for root, dirs, files in os.walk(outDirArch):
 		for file in files:
-			if file == "checksums":
+			if file == "checksums" or file == "checksums2":
 				continue
 			fPath = root + "/" + file
-			fSum = fileMD5(fPath)
-			fChecksums.write(os.path.relpath(fPath, outDirArch) + ":" + fSum + '\n')
+			fRelPath = os.path.relpath(fPath, outDirArch)
+			fChecksums.write(fRelPath + ":" + fileMD5(fPath) + '\n')
+			fChecksums2.write(fRelPath + ":" + fileXXH64(fPath) + '\n')
 	fChecksums.close()
+	fChecksums2.close()
 	
 	sub.Popen(os.environ["INNOSETUP"] + "/ISCC /dMyAppVersion=\"" + gitTag + "\" /dMyAppArchitecture=\"" + arch + "\" Setup.iss")
 
@@ -0,0 +1,304 @@
+#include "AssetSync.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <process.h>
+#include <Windows.h>
+
+#include "ChecksumStreamBuf.hpp"
+#include "CryptUtil.hpp"
+#include "HTTP.hpp"
+#include "MD5.hpp"
+#include "StringUtil.hpp"
+
+using std::ios;
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace inetr {
+	AssetSync::AssetSync(const string &localRoot, const string &remoteRoot,
+		unsigned int downloadWorkers /* = 4 */, unsigned int hashWorkers
+		/* = 0 */) {
+
+		this->localRoot = localRoot;
+		this->remoteRoot = remoteRoot;
+		this->downloadWorkers = (downloadWorkers > 0) ? downloadWorkers : 1;
+
+		if (hashWorkers == 0) {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			hashWorkers = systemInfo.dwNumberOfProcessors;
+		}
+		this->hashWorkers = (hashWorkers > 0) ? hashWorkers : 1;
+		hashAlgorithm = INETR_HA_MD5;
+		hashCache = nullptr;
+		cancel = nullptr;
+
+		InitializeCriticalSection(&queueLock);
+		InitializeCriticalSection(&progressLock);
+		queueSemaphore = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+		doneEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+		memset(&progress, 0, sizeof(progress));
+		memset(&timings, 0, sizeof(timings));
+	}
+
+	AssetSync::~AssetSync() {
+		CloseHandle(doneEvent);
+		CloseHandle(queueSemaphore);
+		DeleteCriticalSection(&progressLock);
+		DeleteCriticalSection(&queueLock);
+	}
+
+	void AssetSync::Add(const string &path, const string &checksum) {
+		Asset asset;
+		asset.Path = path;
+		asset.Checksum = checksum;
+		assets.push_back(asset);
+	}
+
+	bool AssetSync::Run() {
+		memset(&progress, 0, sizeof(progress));
+		progress.Total = assets.size();
+		downloaded.clear();
+		memset(&timings, 0, sizeof(timings));
+
+		startTime = now();
+		firstDownloadTime = 0;
+		lastDownloadTime = 0;
+
+		if (!assets.empty()) {
+			// Every hasher takes MD5::Lanes files at a time
+			size_t batches = (assets.size() + MD5::Lanes - 1) / MD5::Lanes;
+			unsigned int hashers = (batches < hashWorkers) ?
+				static_cast<unsigned int>(batches) : hashWorkers;
+
+			nextHash = 0;
+			runningHashers = static_cast<LONG>(hashers);
+			runningWorkers = static_cast<LONG>(hashers + downloadWorkers);
+			ResetEvent(doneEvent);
+
+			for (unsigned int i = 0; i < downloadWorkers; ++i)
+				_beginthread(staticDownloadThread, 0,
+					reinterpret_cast<void*>(this));
+			for (unsigned int i = 0; i < hashers; ++i)
+				_beginthread(staticHashThread, 0,
+					reinterpret_cast<void*>(this));
+
+			WaitForSingleObject(doneEvent, INFINITE);
+		}
+
+		timings.Total = now() - startTime;
+		if (timings.Hashing == 0)
+			timings.Hashing = timings.Total;
+		if (firstDownloadTime != 0)
+			timings.Downloading = lastDownloadTime - firstDownloadTime;
+
+		return progress.Failed == 0 && !cancelled();
+	}
+
+	AssetSyncProgress AssetSync::GetProgress() const {
+		EnterCriticalSection(&progressLock);
+		AssetSyncProgress current = progress;
+		LeaveCriticalSection(&progressLock);
+
+		return current;
+	}
+
+	void __cdecl AssetSync::staticHashThread(void *param) {
+		AssetSync *parent = reinterpret_cast<AssetSync*>(param);
+		if (parent)
+			parent->hashThread();
+	}
+
+	void __cdecl AssetSync::staticDownloadThread(void *param) {
+		AssetSync *parent = reinterpret_cast<AssetSync*>(param);
+		if (parent)
+			parent->downloadThread();
+	}
+
+	uint64_t AssetSync::now() {
+		static LARGE_INTEGER frequency = { 0 };
+		if (frequency.QuadPart == 0)
+			QueryPerformanceFrequency(&frequency);
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		return static_cast<uint64_t>(counter.QuadPart) * 1000 /
+			static_cast<uint64_t>(frequency.QuadPart);
+	}
+
+	void AssetSync::hashThread() {
+		for (;;) {
+			if (cancelled())
+				break;
+
+			size_t first = static_cast<size_t>(InterlockedExchangeAdd(
+				&nextHash, static_cast<LONG>(MD5::Lanes)));
+			if (first >= assets.size())
+				break;
+			size_t last = (assets.size() - first < MD5::Lanes) ?
+				assets.size() : first + MD5::Lanes;
+
+			vector<string> localPaths;
+			for (size_t index = first; index < last; ++index) {
+				string localPath = localRoot + "\\" + assets[index].Path;
+				StringUtil::SearchAndReplace(localPath, "/", "\\");
+				localPaths.push_back(localPath);
+			}
+
+			// A missing file simply gets an empty hash
+			vector<string> localChecksums;
+			if (hashCache != nullptr)
+				hashCache->FileHashes(localPaths, hashAlgorithm,
+					localChecksums);
+			else
+				CryptUtil::FileHashes(localPaths, hashAlgorithm,
+					localChecksums);
+
+			for (size_t index = first; index < last; ++index) {
+				const string &localChecksum = localChecksums[index - first];
+				bool upToDate = !localChecksum.empty() && localChecksum ==
+					assets[index].Checksum;
+
+				EnterCriticalSection(&progressLock);
+				++progress.Checked;
+				if (!upToDate)
+					++progress.Queued;
+				LeaveCriticalSection(&progressLock);
+
+				if (!upToDate) {
+					EnterCriticalSection(&queueLock);
+					downloads.push(index);
+					LeaveCriticalSection(&queueLock);
+
+					ReleaseSemaphore(queueSemaphore, 1, nullptr);
+				}
+
+				reportProgress();
+			}
+		}
+
+		// The last hasher wakes every download thread once more, a thread
+		// that then finds the queue empty knows no more work will come
+		if (InterlockedDecrement(&runningHashers) == 0) {
+			timings.Hashing = now() - startTime;
+			ReleaseSemaphore(queueSemaphore, static_cast<LONG>(
+				downloadWorkers), nullptr);
+		}
+
+		workerDone();
+	}
+
+	void AssetSync::downloadThread() {
+		for (;;) {
+			WaitForSingleObject(queueSemaphore, INFINITE);
+
+			EnterCriticalSection(&queueLock);
+			if (downloads.empty()) {
+				LeaveCriticalSection(&queueLock);
+				break;
+			}
+			size_t index = downloads.front();
+			downloads.pop();
+			LeaveCriticalSection(&queueLock);
+
+			// Queued files are still drained after a cancel, they count as
+			// failed
+			uint64_t downloadStart = now();
+			bool succeeded = !cancelled() && download(assets[index]);
+			uint64_t downloadEnd = now();
+
+			EnterCriticalSection(&progressLock);
+			if (succeeded) {
+				++progress.Downloaded;
+				downloaded.push_back(assets[index].Path);
+			} else
+				++progress.Failed;
+
+			if (firstDownloadTime == 0 || downloadStart < firstDownloadTime)
+				firstDownloadTime = downloadStart;
+			if (downloadEnd > lastDownloadTime)
+				lastDownloadTime = downloadEnd;
+			LeaveCriticalSection(&progressLock);
+
+			reportProgress();
+		}
+
+		workerDone();
+	}
+
+	bool AssetSync::download(const Asset &asset) {
+		string localPath = localRoot + "\\" + asset.Path;
+		StringUtil::SearchAndReplace(localPath, "/", "\\");
+		string remoteURL = remoteRoot + "/" + asset.Path;
+		StringUtil::SearchAndReplace(remoteURL, "\\", "/");
+
+		string localDir = localPath.substr(0, localPath.find_last_of("\\"));
+		CreateDirectory(localDir.c_str(), nullptr);
+
+		// Nothing but a complete download matching its checksum may replace
+		// the local copy, the checksum is taken while the data is written
+		string tempPath = localPath + ".download";
+		{
+			ofstream tempStream;
+			tempStream.open(tempPath, ios::out | ios::binary | ios::trunc);
+			if (!tempStream.is_open())
+				return false;
+
+			ChecksumStreamBuf checksumBuf(tempStream.rdbuf(), hashAlgorithm);
+			ostream checksumStream(&checksumBuf);
+			try {
+				HTTP::Get(remoteURL, &checksumStream);
+			} catch (...) {
+				tempStream.close();
+				DeleteFile(tempPath.c_str());
+				return false;
+			}
+
+			tempStream.close();
+			if (tempStream.fail() || checksumStream.fail() ||
+				checksumBuf.Final() != asset.Checksum) {
+
+				DeleteFile(tempPath.c_str());
+				return false;
+			}
+		}
+
+		if (MoveFileEx(tempPath.c_str(), localPath.c_str(),
+			MOVEFILE_REPLACE_EXISTING) == 0) {
+
+			DeleteFile(tempPath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void AssetSync::workerDone() {
+		if (InterlockedDecrement(&runningWorkers) == 0)
+			SetEvent(doneEvent);
+	}
+
+	void AssetSync::reportProgress() {
+		if (!progressCallback)
+			return;
+
+		EnterCriticalSection(&progressLock);
+		progressCallback(progress);
+		LeaveCriticalSection(&progressLock);
+	}
+
+	bool AssetSync::cancelled() const {
+		return cancel != nullptr && *cancel != 0;
+	}
+}
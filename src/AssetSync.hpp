@@ -0,0 +1,123 @@
+#ifndef INETR_ASSETSYNC_HPP
+#define INETR_ASSETSYNC_HPP
+
+#include <cstdint>
+
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "CryptUtil.hpp"
+#include "FileHashCache.hpp"
+
+namespace inetr {
+	struct AssetSyncProgress {
+		size_t Total;
+		size_t Checked;
+		size_t Queued;
+		size_t Downloaded;
+		size_t Failed;
+	};
+
+	// Wall times in milliseconds, Downloading runs from the start of the first
+	// download to the end of the last one and overlaps Hashing
+	struct AssetSyncTimings {
+		uint64_t Hashing;
+		uint64_t Downloading;
+		uint64_t Total;
+	};
+
+	// Brings a directory in line with a checksum manifest. Local copies are
+	// hashed on one thread per processor, every missing or outdated file is
+	// handed to a fixed number of download threads as soon as it is found,
+	// and downloads are written to a temporary file that replaces the local
+	// copy only once complete and matching its checksum.
+	class AssetSync {
+	public:
+		AssetSync(const std::string &localRoot, const std::string &remoteRoot,
+			unsigned int downloadWorkers = 4, unsigned int hashWorkers = 0);
+		~AssetSync();
+
+		void Add(const std::string &path, const std::string &checksum);
+		// The algorithm all checksums were made with, MD5 by default
+		inline void SetHashAlgorithm(HashAlgorithm hashAlgorithm) {
+			this->hashAlgorithm = hashAlgorithm;
+		}
+		// Local copies are checked through the cache when one is set
+		inline void SetHashCache(FileHashCache *hashCache) {
+			this->hashCache = hashCache;
+		}
+		// Run stops checking and downloading once the flag is set non-zero
+		inline void SetCancelFlag(const volatile LONG *cancel) {
+			this->cancel = cancel;
+		}
+		// Called from the worker threads whenever a file has been checked
+		// or downloaded
+		inline void SetProgressCallback(
+			std::function<void (const AssetSyncProgress&)> callback) {
+
+			progressCallback = callback;
+		}
+
+		// Blocks until every file is checked and downloaded, returns false if
+		// any download failed or the run was cancelled
+		bool Run();
+
+		AssetSyncProgress GetProgress() const;
+		// The paths of the files the last Run replaced, as they were added
+		inline const std::vector<std::string> &GetDownloaded() const {
+			return downloaded;
+		}
+		inline const AssetSyncTimings &GetTimings() const { return timings; }
+	private:
+		struct Asset {
+			std::string Path;
+			std::string Checksum;
+		};
+
+		static void __cdecl staticHashThread(void *param);
+		static void __cdecl staticDownloadThread(void *param);
+
+		static uint64_t now();
+
+		void hashThread();
+		void downloadThread();
+		bool download(const Asset &asset);
+		void workerDone();
+		void reportProgress();
+		bool cancelled() const;
+
+		std::string localRoot;
+		std::string remoteRoot;
+		unsigned int downloadWorkers;
+		unsigned int hashWorkers;
+		HashAlgorithm hashAlgorithm;
+		FileHashCache *hashCache;
+		const volatile LONG *cancel;
+
+		std::vector<Asset> assets;
+		volatile LONG nextHash;
+		volatile LONG runningHashers;
+		volatile LONG runningWorkers;
+
+		CRITICAL_SECTION queueLock;
+		HANDLE queueSemaphore;
+		HANDLE doneEvent;
+		std::queue<size_t> downloads;
+
+		mutable CRITICAL_SECTION progressLock;
+		AssetSyncProgress progress;
+		std::vector<std::string> downloaded;
+		std::function<void (const AssetSyncProgress&)> progressCallback;
+
+		uint64_t startTime;
+		uint64_t firstDownloadTime;
+		uint64_t lastDownloadTime;
+		AssetSyncTimings timings;
+	};
+}
+
+#endif  // !INETR_ASSETSYNC_HPP
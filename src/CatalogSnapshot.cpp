@@ -0,0 +1,391 @@
+#include "CatalogSnapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+#include "FileHashCache.hpp"
+#include "MappedFile.hpp"
+#include "StringUtil.hpp"
+#include "XXH64.hpp"
+
+using std::ios;
+using std::list;
+using std::make_shared;
+using std::map;
+using std::ofstream;
+using std::pair;
+using std::sort;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace inetr {
+	namespace {
+		template<typename T>
+		void appendRecords(string &out, const vector<T> &records) {
+			if (!records.empty())
+				out.append(reinterpret_cast<const char*>(&records[0]),
+					records.size() * sizeof(T));
+		}
+	}
+
+	const char CatalogSnapshot::magic[4] = { 'I', 'R', 'S', 'C' };
+
+	CatalogSnapshot::CatalogSnapshot(const string &path) :
+		file(make_shared<MappedFile>(path)) {
+
+		header = nullptr;
+		stationRecords = nullptr;
+		sourceRecords = nullptr;
+		parameterRecords = nullptr;
+		prototypeNames = nullptr;
+		strings = nullptr;
+
+		intact = validate();
+	}
+
+	bool CatalogSnapshot::IsValid(const FileHashCache::Stamp &source,
+		const uint16_t appVersion[4], uint64_t prototypesHash) const {
+
+		return intact && header->SourceSize == source.Size &&
+			header->SourceLastWrite == source.LastWrite &&
+			header->SourceFileIndex == source.FileIndex &&
+			header->SourceVolume == source.Volume &&
+			memcmp(header->AppVersion, appVersion,
+			sizeof(header->AppVersion)) == 0 &&
+			header->PrototypesHash == prototypesHash;
+	}
+
+	void CatalogSnapshot::GetMinVersion(uint16_t *minVersion) const {
+		memcpy(minVersion, header->MinVersion, sizeof(header->MinVersion));
+	}
+
+	bool CatalogSnapshot::Read(const unordered_map<string,
+		MetaSourcePrototype*> &prototypes, list<Station> &out) const {
+
+		if (!intact)
+			return false;
+
+		vector<MetaSourcePrototype*> resolved(header->PrototypeCount);
+		for (uint32_t i = 0; i < header->PrototypeCount; ++i) {
+			unordered_map<string, MetaSourcePrototype*>::const_iterator it =
+				prototypes.find(getString(prototypeNames[i]).ToString());
+			if (it == prototypes.end())
+				return false;
+
+			resolved[i] = it->second;
+		}
+
+		list<Station> loadedStations;
+		for (uint32_t i = 0; i < header->StationCount; ++i) {
+			const StationRecord &station = stationRecords[i];
+
+			vector<MetaSource> metaSources;
+			metaSources.reserve(station.SourceCount);
+			for (uint32_t j = 0; j < station.SourceCount; ++j) {
+				const SourceRecord &source =
+					sourceRecords[station.FirstSource + j];
+
+				map<string, string> parameters;
+				for (uint32_t k = 0; k < source.ParameterCount; ++k) {
+					const ParameterRecord &parameter =
+						parameterRecords[source.FirstParameter + k];
+					parameters.insert(pair<string, string>(
+						getString(parameter.Key).ToString(),
+						getString(parameter.Value).ToString()));
+				}
+
+				metaSources.push_back(MetaSource(resolved[source.Prototype],
+					std::move(parameters)));
+			}
+
+			loadedStations.push_back(Station(getString(station.Identifier),
+				getString(station.Name), getString(station.StreamURL),
+				getString(station.ImagePath), std::move(metaSources),
+				getString(station.MetaOut), file));
+		}
+
+		out.splice(out.end(), loadedStations);
+
+		return true;
+	}
+
+	bool CatalogSnapshot::Write(const string &path,
+		const FileHashCache::Stamp &source, const uint16_t appVersion[4],
+		uint64_t prototypesHash, const uint16_t minVersion[4],
+		const list<Station> &stations) {
+
+		string stringTable;
+		unordered_map<string, StringEntry> stringOffsets;
+		vector<StationRecord> stationRecords;
+		vector<SourceRecord> sourceRecords;
+		vector<ParameterRecord> parameterRecords;
+		vector<StringEntry> prototypeNames;
+		map<MetaSourcePrototype*, uint32_t> prototypeIds;
+
+		stationRecords.reserve(stations.size());
+		for (list<Station>::const_iterator it = stations.begin();
+			it != stations.end(); ++it) {
+
+			StationRecord station;
+			station.Identifier = addString(stringTable, stringOffsets,
+				it->GetIdentifier());
+			station.Name = addString(stringTable, stringOffsets,
+				it->GetName());
+			station.StreamURL = addString(stringTable, stringOffsets,
+				it->GetStreamURL());
+			station.ImagePath = addString(stringTable, stringOffsets,
+				it->GetImagePath());
+			station.MetaOut = addString(stringTable, stringOffsets,
+				it->GetMetaOut());
+			station.FirstSource = static_cast<uint32_t>(sourceRecords.size());
+			station.SourceCount = static_cast<uint32_t>(
+				it->GetMetaSources().size());
+			stationRecords.push_back(station);
+
+			for (vector<MetaSource>::const_iterator srcIt =
+				it->GetMetaSources().begin(); srcIt !=
+				it->GetMetaSources().end(); ++srcIt) {
+
+				map<MetaSourcePrototype*, uint32_t>::const_iterator protIt =
+					prototypeIds.find(srcIt->MetaSourceProto);
+				if (protIt == prototypeIds.end()) {
+					protIt = prototypeIds.insert(
+						pair<MetaSourcePrototype*, uint32_t>(
+						srcIt->MetaSourceProto, static_cast<uint32_t>(
+						prototypeNames.size()))).first;
+					prototypeNames.push_back(addString(stringTable,
+						stringOffsets, srcIt->MetaSourceProto->GetIdentifer()));
+				}
+
+				SourceRecord source;
+				source.Prototype = protIt->second;
+				source.FirstParameter = static_cast<uint32_t>(
+					parameterRecords.size());
+				source.ParameterCount = static_cast<uint32_t>(
+					srcIt->Parameters.size());
+				sourceRecords.push_back(source);
+
+				for (map<string, string>::const_iterator paramIt =
+					srcIt->Parameters.begin(); paramIt !=
+					srcIt->Parameters.end(); ++paramIt) {
+
+					ParameterRecord parameter;
+					parameter.Key = addString(stringTable, stringOffsets,
+						paramIt->first);
+					parameter.Value = addString(stringTable, stringOffsets,
+						paramIt->second);
+					parameterRecords.push_back(parameter);
+				}
+			}
+		}
+
+		string payload;
+		appendRecords(payload, stationRecords);
+		appendRecords(payload, sourceRecords);
+		appendRecords(payload, parameterRecords);
+		appendRecords(payload, prototypeNames);
+		payload.append(stringTable);
+
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.Magic, magic, sizeof(magic));
+		header.Version = formatVersion;
+		header.SourceSize = source.Size;
+		header.SourceLastWrite = source.LastWrite;
+		header.SourceFileIndex = source.FileIndex;
+		header.SourceVolume = source.Volume;
+		header.StationCount = static_cast<uint32_t>(stationRecords.size());
+		header.SourceCount = static_cast<uint32_t>(sourceRecords.size());
+		header.ParameterCount = static_cast<uint32_t>(
+			parameterRecords.size());
+		header.PrototypeCount = static_cast<uint32_t>(prototypeNames.size());
+		header.StringBytes = static_cast<uint32_t>(stringTable.size());
+		memcpy(header.MinVersion, minVersion, sizeof(header.MinVersion));
+		memcpy(header.AppVersion, appVersion, sizeof(header.AppVersion));
+		header.PrototypesHash = prototypesHash;
+		XXH64 payloadHash;
+		payloadHash.Update(payload.data(), payload.size());
+		header.PayloadHash = payloadHash.Final();
+		header.HeaderHash = Hash(reinterpret_cast<const char*>(&header),
+			offsetof(Header, HeaderHash));
+
+		// Write next to the old snapshot and swap, so a reader never maps a
+		// half written file
+		string tempPath = path + ".tmp";
+		{
+			ofstream file;
+			file.open(tempPath, ios::out | ios::binary | ios::trunc);
+			if (!file.is_open())
+				return false;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(payload.data(), payload.size());
+			if (file.fail())
+				return false;
+		}
+
+		// Stations read from the old snapshot may still map it, which keeps
+		// it from being replaced but not from being renamed
+		string oldPath = path + ".old";
+		DeleteFile(oldPath.c_str());
+		MoveFileEx(path.c_str(), oldPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+
+		return MoveFileEx(tempPath.c_str(), path.c_str(),
+			MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
+	uint64_t CatalogSnapshot::Hash(const char *data, size_t length) {
+		// 64 bit FNV-1a
+		uint64_t hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < length; ++i) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	uint64_t CatalogSnapshot::HashPrototypes(const unordered_map<string,
+		MetaSourcePrototype*> &prototypes) {
+
+		vector<string> identifiers;
+		identifiers.reserve(prototypes.size());
+		for (unordered_map<string, MetaSourcePrototype*>::const_iterator it =
+			prototypes.begin(); it != prototypes.end(); ++it)
+			identifiers.push_back(it->first);
+		sort(identifiers.begin(), identifiers.end());
+
+		// Terminators keep {"ab", "c"} and {"a", "bc"} apart
+		XXH64 hash;
+		for (vector<string>::const_iterator it = identifiers.begin();
+			it != identifiers.end(); ++it)
+			hash.Update(it->c_str(), it->length() + 1);
+
+		return hash.Final();
+	}
+
+	CatalogSnapshot::StringEntry CatalogSnapshot::addString(string &table,
+		unordered_map<string, StringEntry> &offsets, StringRef str) {
+
+		string key = str.ToString();
+		unordered_map<string, StringEntry>::const_iterator it =
+			offsets.find(key);
+		if (it != offsets.end())
+			return it->second;
+
+		StringEntry entry;
+		entry.Offset = static_cast<uint32_t>(table.size());
+		entry.Length = static_cast<uint32_t>(key.length());
+		offsets.insert(pair<string, StringEntry>(key, entry));
+		table.append(key);
+		table.push_back('\0');
+
+		return entry;
+	}
+
+	bool CatalogSnapshot::validate() {
+		if (!file->IsOpen() || file->GetSize() < sizeof(Header))
+			return false;
+
+		const Header *fileHeader = reinterpret_cast<const Header*>(
+			file->GetData());
+		if (memcmp(fileHeader->Magic, magic, sizeof(magic)) != 0 ||
+			fileHeader->Version != formatVersion || Hash(file->GetData(),
+			offsetof(Header, HeaderHash)) != fileHeader->HeaderHash)
+			return false;
+
+		uint64_t expectedSize = sizeof(Header) +
+			static_cast<uint64_t>(fileHeader->StationCount) *
+			sizeof(StationRecord) +
+			static_cast<uint64_t>(fileHeader->SourceCount) *
+			sizeof(SourceRecord) +
+			static_cast<uint64_t>(fileHeader->ParameterCount) *
+			sizeof(ParameterRecord) +
+			static_cast<uint64_t>(fileHeader->PrototypeCount) *
+			sizeof(StringEntry) + fileHeader->StringBytes;
+		if (expectedSize != file->GetSize())
+			return false;
+
+		// The payload is hashed before anything in it is trusted. XXH64
+		// runs at memory speed, so this costs about as much as the page
+		// faults Read takes on the same bytes anyway.
+		const char *payload = file->GetData() + sizeof(Header);
+		XXH64 payloadHash;
+		payloadHash.Update(payload, file->GetSize() - sizeof(Header));
+		if (payloadHash.Final() != fileHeader->PayloadHash)
+			return false;
+
+
+		header = fileHeader;
+		stationRecords = reinterpret_cast<const StationRecord*>(payload);
+		sourceRecords = reinterpret_cast<const SourceRecord*>(
+			stationRecords + header->StationCount);
+		parameterRecords = reinterpret_cast<const ParameterRecord*>(
+			sourceRecords + header->SourceCount);
+		prototypeNames = reinterpret_cast<const StringEntry*>(
+			parameterRecords + header->ParameterCount);
+		strings = reinterpret_cast<const char*>(prototypeNames +
+			header->PrototypeCount);
+
+		// Bounds are still checked, so Read can index without checks even
+		// if a damaged payload happens to match its hash. Every string needs room for its terminator and the table has to
+		// end in one, so even a damaged string ends inside the table.
+		uint32_t stringBytes = header->StringBytes;
+		if (stringBytes == 0 || strings[stringBytes - 1] != '\0')
+			return false;
+
+		auto stringInRange = [stringBytes](const StringEntry &entry) -> bool {
+			return entry.Offset < stringBytes && entry.Length < stringBytes -
+				entry.Offset;
+		};
+
+		for (uint32_t i = 0; i < header->PrototypeCount; ++i) {
+			if (!stringInRange(prototypeNames[i]))
+				return false;
+		}
+
+		for (uint32_t i = 0; i < header->ParameterCount; ++i) {
+			if (!stringInRange(parameterRecords[i].Key) ||
+				!stringInRange(parameterRecords[i].Value))
+				return false;
+		}
+
+		for (uint32_t i = 0; i < header->SourceCount; ++i) {
+			const SourceRecord &source = sourceRecords[i];
+			if (source.Prototype >= header->PrototypeCount ||
+				source.FirstParameter > header->ParameterCount ||
+				source.ParameterCount > header->ParameterCount -
+				source.FirstParameter)
+				return false;
+		}
+
+		for (uint32_t i = 0; i < header->StationCount; ++i) {
+			const StationRecord &station = stationRecords[i];
+			if (!stringInRange(station.Identifier) ||
+				!stringInRange(station.Name) ||
+				!stringInRange(station.StreamURL) ||
+				!stringInRange(station.ImagePath) ||
+				!stringInRange(station.MetaOut) ||
+				station.FirstSource > header->SourceCount ||
+				station.SourceCount > header->SourceCount -
+				station.FirstSource)
+				return false;
+		}
+
+		return true;
+	}
+}
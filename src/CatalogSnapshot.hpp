@@ -0,0 +1,123 @@
+#ifndef INETR_CATALOGSNAPSHOT_HPP
+#define INETR_CATALOGSNAPSHOT_HPP
+
+#include <cstdint>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "FileHashCache.hpp"
+#include "MappedFile.hpp"
+#include "MetaSourcePrototype.hpp"
+#include "Station.hpp"
+#include "StringUtil.hpp"
+
+namespace inetr {
+	// Binary image of a parsed station catalog. Strings are stored once in a
+	// shared table and referenced by offset, stations, meta sources and their
+	// parameters are flat records indexing into each other, and meta source
+	// prototypes are named once so they are resolved once per load. The
+	// snapshot is keyed by the size, write time and file ID of the JSON it
+	// was built from, so checking it doesn't read the JSON, and by the
+	// application version and the registered prototypes, since both decide
+	// how the JSON parses. Stations read from it reference the mapped
+	// strings and keep the mapping alive.
+	class CatalogSnapshot {
+	public:
+		CatalogSnapshot(const std::string &path);
+
+		// True if the mapped snapshot is intact and was built from a source
+		// with the given stamp by the given version with the same prototypes
+		bool IsValid(const FileHashCache::Stamp &source,
+			const uint16_t appVersion[4], uint64_t prototypesHash) const;
+		// Only meaningful if the snapshot is valid
+		void GetMinVersion(uint16_t *minVersion) const;
+
+		bool Read(const std::unordered_map<std::string, MetaSourcePrototype*>
+			&prototypes, std::list<Station> &out) const;
+
+		static bool Write(const std::string &path,
+			const FileHashCache::Stamp &source, const uint16_t appVersion[4],
+			uint64_t prototypesHash, const uint16_t minVersion[4],
+			const std::list<Station> &stations);
+		static uint64_t Hash(const char *data, size_t length);
+		// Independent of the order the prototypes were registered in
+		static uint64_t HashPrototypes(const std::unordered_map<std::string,
+			MetaSourcePrototype*> &prototypes);
+	private:
+		struct StringEntry {
+			uint32_t Offset;
+			uint32_t Length;
+		};
+
+		struct Header {
+			char Magic[4];
+			uint32_t Version;
+			uint64_t SourceSize;
+			uint64_t SourceLastWrite;
+			uint64_t SourceFileIndex;
+			uint32_t SourceVolume;
+			uint32_t StationCount;
+			uint32_t SourceCount;
+			uint32_t ParameterCount;
+			uint32_t PrototypeCount;
+			uint32_t StringBytes;
+			uint16_t MinVersion[4];
+			uint16_t AppVersion[4];
+			uint64_t PrototypesHash;
+			// XXH64 of everything after the header
+			uint64_t PayloadHash;
+			// Hash of the fields above
+			uint64_t HeaderHash;
+		};
+
+		struct StationRecord {
+			StringEntry Identifier;
+			StringEntry Name;
+			StringEntry StreamURL;
+			StringEntry ImagePath;
+			StringEntry MetaOut;
+			uint32_t FirstSource;
+			uint32_t SourceCount;
+		};
+
+		struct SourceRecord {
+			uint32_t Prototype;
+			uint32_t FirstParameter;
+			uint32_t ParameterCount;
+		};
+
+		struct ParameterRecord {
+			StringEntry Key;
+			StringEntry Value;
+		};
+
+		static const char magic[4];
+		static const uint32_t formatVersion = 3;
+
+		// Strings are stored NUL-terminated so stations can hand them out
+		// as they are
+		static StringEntry addString(std::string &table,
+			std::unordered_map<std::string, StringEntry> &offsets,
+			StringRef str);
+
+		bool validate();
+		inline StringRef getString(const StringEntry &entry) const {
+			return StringRef(strings + entry.Offset, entry.Length);
+		}
+
+		std::shared_ptr<MappedFile> file;
+		bool intact;
+
+		const Header *header;
+		const StationRecord *stationRecords;
+		const SourceRecord *sourceRecords;
+		const ParameterRecord *parameterRecords;
+		const StringEntry *prototypeNames;
+		const char *strings;
+	};
+}
+
+#endif  // !INETR_CATALOGSNAPSHOT_HPP
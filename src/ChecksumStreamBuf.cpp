@@ -0,0 +1,54 @@
+#include "ChecksumStreamBuf.hpp"
+
+#include <streambuf>
+#include <string>
+
+#include "CryptUtil.hpp"
+#include "MD5.hpp"
+#include "XXH64.hpp"
+
+using std::streambuf;
+using std::streamsize;
+using std::string;
+
+namespace inetr {
+	ChecksumStreamBuf::ChecksumStreamBuf(streambuf *target,
+		HashAlgorithm algorithm /* = INETR_HA_MD5 */) {
+
+		this->target = target;
+		this->algorithm = algorithm;
+	}
+
+	string ChecksumStreamBuf::Final() {
+		if (algorithm == INETR_HA_XXH64)
+			return XXH64::ToHex(xxh64Hash.Final());
+
+		unsigned char digest[MD5::DigestSize];
+		md5Hash.Final(digest);
+
+		return MD5::ToHex(digest);
+	}
+
+	ChecksumStreamBuf::int_type ChecksumStreamBuf::overflow(int_type c) {
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+			return traits_type::not_eof(c);
+
+		char ch = traits_type::to_char_type(c);
+		return (xsputn(&ch, 1) == 1) ? c : traits_type::eof();
+	}
+
+	streamsize ChecksumStreamBuf::xsputn(const char *s, streamsize count) {
+		// Only what actually reached the target is hashed
+		streamsize written = target->sputn(s, count);
+		if (written > 0 && algorithm == INETR_HA_XXH64)
+			xxh64Hash.Update(s, static_cast<size_t>(written));
+		else if (written > 0)
+			md5Hash.Update(s, static_cast<size_t>(written));
+
+		return written;
+	}
+
+	int ChecksumStreamBuf::sync() {
+		return target->pubsync();
+	}
+}
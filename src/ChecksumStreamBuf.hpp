@@ -0,0 +1,36 @@
+#ifndef INETR_CHECKSUMSTREAMBUF_HPP
+#define INETR_CHECKSUMSTREAMBUF_HPP
+
+#include <streambuf>
+#include <string>
+
+#include "CryptUtil.hpp"
+#include "MD5.hpp"
+#include "XXH64.hpp"
+
+namespace inetr {
+	// Passes everything written on to another stream buffer and hashes it
+	// on the way, so a download can be verified without reading it back
+	class ChecksumStreamBuf : public std::streambuf {
+	public:
+		ChecksumStreamBuf(std::streambuf *target,
+			HashAlgorithm algorithm = INETR_HA_MD5);
+
+		// Checksum of everything written so far, may only be called once
+		std::string Final();
+	protected:
+		virtual int_type overflow(int_type c);
+		virtual std::streamsize xsputn(const char *s, std::streamsize count);
+		virtual int sync();
+	private:
+		ChecksumStreamBuf(const ChecksumStreamBuf &original);
+		ChecksumStreamBuf& operator=(const ChecksumStreamBuf &original);
+
+		std::streambuf *target;
+		HashAlgorithm algorithm;
+		MD5 md5Hash;
+		XXH64 xxh64Hash;
+	};
+}
+
+#endif  // !INETR_CHECKSUMSTREAMBUF_HPP
@@ -1,99 +1,146 @@
 #include "CryptUtil.hpp"
 
 #include <fstream>
-#include <sstream>
+#include <memory>
 #include <string>
-
-#include <Windows.h>
-#include <WinCrypt.h>
+#include <vector>
 
 #include "INETRException.hpp"
+#include "MappedFile.hpp"
+#include "MD5.hpp"
+#include "XXH64.hpp"
 
 using std::ifstream;
 using std::ios;
 using std::string;
-using std::stringstream;
+using std::unique_ptr;
+using std::vector;
 
 namespace inetr {
-	HCRYPTPROV CryptUtil::hCryptProv;
-
-	BOOL CryptUtil::CryptStartup() {
-		if (CryptAcquireContext(&hCryptProv, nullptr, MS_ENHANCED_PROV,
-			PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) == 0) {
-
-				if (GetLastError() == NTE_EXISTS) {
-					if (CryptAcquireContext(&hCryptProv, nullptr, MS_ENHANCED_PROV,
-						PROV_RSA_FULL, 0) == 0)
-						return FALSE;
-				} else {
-					return FALSE;
-				}
-		}
-		return TRUE;
-	}
+	bool CryptUtil::HashAlgorithmFromName(const string &name,
+		HashAlgorithm &algorithm) {
 
-	void CryptUtil::CryptCleanup() {
-		if (hCryptProv)
-			CryptReleaseContext(hCryptProv, 0);
-		hCryptProv = 0;
+		if (name == "md5")
+			algorithm = INETR_HA_MD5;
+		else if (name == "xxh64")
+			algorithm = INETR_HA_XXH64;
+		else
+			return false;
+
+		return true;
 	}
 
-	void CryptUtil::MD5Init(MD5Context *context) {
-		CryptCreateHash(hCryptProv, CALG_MD5, 0, 0, &context->Hash);
+	const char *CryptUtil::HashAlgorithmName(HashAlgorithm algorithm) {
+		return (algorithm == INETR_HA_XXH64) ? "xxh64" : "md5";
 	}
 
-	void CryptUtil::MD5Update(MD5Context *context, unsigned char const *buf,
-		unsigned int length) {
+	bool CryptUtil::StripAlgorithmTag(string &checksums,
+		HashAlgorithm &algorithm) {
 
-			CryptHashData(context->Hash, buf, length, 0);
-	}
+		algorithm = INETR_HA_MD5;
+
+		const string tag = "algorithm ";
+		if (checksums.compare(0, tag.length(), tag) != 0)
+			return true;
 
-	void CryptUtil::MD5Final(MD5Context *context) {
-		DWORD dwCount = 16;
-		CryptGetHashParam(context->Hash, HP_HASHVAL, context->Digest, &dwCount,
-			0);
-		if (context->Hash)
-			CryptDestroyHash(context->Hash);
-		context->Hash = 0;
+		size_t lineEnd = checksums.find_first_of("\r\n");
+		string name = checksums.substr(tag.length(), (lineEnd ==
+			string::npos) ? string::npos : lineEnd - tag.length());
+		checksums.erase(0, (lineEnd == string::npos) ? string::npos :
+			lineEnd);
+
+		return HashAlgorithmFromName(name, algorithm);
 	}
 
-	string CryptUtil::FileMD5Hash(string path) {
-		if (!CryptStartup())
-			throw INETRException("[cryptStartErr]");
+	string CryptUtil::FileHash(const string &path,
+		HashAlgorithm algorithm /* = INETR_HA_MD5 */) {
 
-		ifstream fInput;
-		fInput.open(path, ios::in | ios::binary);
-		if (!fInput.good())
+		vector<string> paths(1, path), hashes;
+		FileHashes(paths, algorithm, hashes);
+		if (hashes[0].empty())
 			throw INETRException("[openFileErr]");
 
-		MD5Context md5Hash;
-		memset(&md5Hash, 0, sizeof(MD5Context));
-		MD5Init(&md5Hash);
+		return hashes[0];
+	}
 
-		unsigned char bBuffer[4096];
-		while(!fInput.eof()) {
-			fInput.read(reinterpret_cast<char*>(bBuffer), 4096);
-			MD5Update(&md5Hash, bBuffer, (unsigned int)fInput.gcount());
-		}
+	void CryptUtil::FileHashes(const vector<string> &paths,
+		HashAlgorithm algorithm, vector<string> &hashes) {
+
+		hashes.assign(paths.size(), string());
+
+		// Files are mapped a batch at a time so large updates don't take up
+		// the whole address space
+		for (size_t first = 0; first < paths.size(); first += MD5::Lanes) {
+			size_t last = (paths.size() - first < MD5::Lanes) ?
+				paths.size() : first + MD5::Lanes;
+
+			vector<unique_ptr<MappedFile>> files;
+			vector<const unsigned char*> data;
+			vector<size_t> lengths, indices;
+			for (size_t i = first; i < last; ++i) {
+				unique_ptr<MappedFile> file(new MappedFile(paths[i]));
+				if (!file->IsOpen()) {
+					streamHash(paths[i], algorithm, hashes[i]);
+					continue;
+				}
 
-		MD5Final(&md5Hash);
+				data.push_back(reinterpret_cast<const unsigned char*>(
+					file->GetData()));
+				lengths.push_back(file->GetSize());
+				indices.push_back(i);
+				files.push_back(std::move(file));
+			}
 
-		fInput.close();
+			if (indices.empty())
+				continue;
 
-		stringstream out;
-		for (int i = 0; i < 16; ++i) {
-			unsigned char b = md5Hash.Digest[i];
-			for (int j = 4; j >= 0; j -= 4) {
-				char c = (static_cast<char>(b >> j) & 0x0F);
-				if (c < 10)
-					c += '0';
-				else
-					c = ('a' + (c - 10));
-				out << c;
+			if (algorithm == INETR_HA_XXH64) {
+				for (size_t i = 0; i < indices.size(); ++i) {
+					XXH64 hash;
+					hash.Update(data[i], lengths[i]);
+					hashes[indices[i]] = XXH64::ToHex(hash.Final());
+				}
+				continue;
 			}
+
+			vector<unsigned char> digests(indices.size() * MD5::DigestSize);
+			MD5::HashMany(&data[0], &lengths[0], indices.size(),
+				&digests[0]);
+			for (size_t i = 0; i < indices.size(); ++i)
+				hashes[indices[i]] = MD5::ToHex(&digests[i * MD5::DigestSize]);
+		}
+	}
+
+	bool CryptUtil::streamHash(const string &path, HashAlgorithm algorithm,
+		string &hash) {
+
+		ifstream fInput;
+		fInput.open(path, ios::in | ios::binary);
+		if (!fInput.good())
+			return false;
+
+		MD5 md5Hash;
+		XXH64 xxh64Hash;
+		vector<char> buffer(64 * 1024);
+		while (fInput.good()) {
+			fInput.read(&buffer[0], buffer.size());
+			size_t length = static_cast<size_t>(fInput.gcount());
+			if (algorithm == INETR_HA_XXH64)
+				xxh64Hash.Update(&buffer[0], length);
+			else
+				md5Hash.Update(&buffer[0], length);
+		}
+		if (fInput.bad())
+			return false;
+
+		if (algorithm == INETR_HA_XXH64) {
+			hash = XXH64::ToHex(xxh64Hash.Final());
+		} else {
+			unsigned char digest[MD5::DigestSize];
+			md5Hash.Final(digest);
+			hash = MD5::ToHex(digest);
 		}
-		CryptCleanup();
 
-		return out.str();
+		return true;
 	}
 }
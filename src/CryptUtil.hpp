@@ -2,29 +2,32 @@
 #define INETR_CRYPTUTIL_HPP
 
 #include <string>
-
-#include <Windows.h>
-#include <WinCrypt.h>
+#include <vector>
 
 namespace inetr {
-	struct MD5Context {
-		unsigned char Digest[16];
-		HCRYPTHASH Hash;
-	};
+	enum HashAlgorithm { INETR_HA_MD5, INETR_HA_XXH64 };
 
 	class CryptUtil {
 	public:
-		static std::string FileMD5Hash(std::string path);
-	private:
-		static BOOL CryptStartup();
-		static void CryptCleanup();
+		static bool HashAlgorithmFromName(const std::string &name,
+			HashAlgorithm &algorithm);
+		static const char *HashAlgorithmName(HashAlgorithm algorithm);
+		// Checksum lists may start with an "algorithm <name>" line, which is
+		// removed; lists without one are MD5. Returns false for algorithms
+		// that are not supported.
+		static bool StripAlgorithmTag(std::string &checksums,
+			HashAlgorithm &algorithm);
 
-		static void MD5Init(MD5Context *context);
-		static void MD5Update(MD5Context *context, unsigned char const *buf,
-			unsigned int length);
-		static void MD5Final(MD5Context *context);
-
-		static HCRYPTPROV hCryptProv;
+		static std::string FileHash(const std::string &path,
+			HashAlgorithm algorithm = INETR_HA_MD5);
+		// A file that cannot be read gets an empty hash. MD5 runs up to
+		// MD5::Lanes files at a time side by side.
+		static void FileHashes(const std::vector<std::string> &paths,
+			HashAlgorithm algorithm, std::vector<std::string> &hashes);
+	private:
+		// For files that cannot be mapped, such as empty ones
+		static bool streamHash(const std::string &path,
+			HashAlgorithm algorithm, std::string &hash);
 	};
 }
 
@@ -0,0 +1,34 @@
+#ifndef INETR_EXTRACTORSTREAMBUF_HPP
+#define INETR_EXTRACTORSTREAMBUF_HPP
+
+#include <streambuf>
+
+namespace inetr {
+	// Feeds everything written to it straight into a streaming extractor
+	// (any type with bool Feed(const char*, size_t)) and reports a write
+	// failure once the extractor needs no more input, which makes HTTP::Get
+	// stop receiving
+	template<class Extractor>
+	class ExtractorStreamBuf : public std::streambuf {
+	public:
+		ExtractorStreamBuf(Extractor &extractor) : extractor(extractor) { }
+	protected:
+		int_type overflow(int_type c) {
+			if (traits_type::eq_int_type(c, traits_type::eof()))
+				return traits_type::not_eof(c);
+
+			char ch = traits_type::to_char_type(c);
+			return extractor.Feed(&ch, 1) ? c : traits_type::eof();
+		}
+
+		std::streamsize xsputn(const char *s, std::streamsize n) {
+			return extractor.Feed(s, static_cast<size_t>(n)) ? n : 0;
+		}
+	private:
+		ExtractorStreamBuf &operator=(const ExtractorStreamBuf &);
+
+		Extractor &extractor;
+	};
+}
+
+#endif  // !INETR_EXTRACTORSTREAMBUF_HPP
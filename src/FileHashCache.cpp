@@ -0,0 +1,228 @@
+#include "FileHashCache.hpp"
+
+#include <cstdint>
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+#include "CryptUtil.hpp"
+
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace inetr {
+	FileHashCache::FileHashCache(const string &path) {
+		this->path = path;
+		changed = false;
+
+		InitializeCriticalSection(&lock);
+
+		load();
+	}
+
+	FileHashCache::~FileHashCache() {
+		DeleteCriticalSection(&lock);
+	}
+
+	void FileHashCache::FileHashes(const vector<string> &paths,
+		HashAlgorithm algorithm, vector<string> &hashes) {
+
+		hashes.assign(paths.size(), string());
+
+		uint64_t hashStart = now();
+		vector<size_t> staleIndices;
+		vector<string> stalePaths, staleKeys;
+		vector<Stamp> staleStamps;
+
+		for (size_t i = 0; i < paths.size(); ++i) {
+			Stamp fileStamp;
+			if (!GetStamp(paths[i], fileStamp))
+				continue;
+
+			string key = fullPath(paths[i]);
+			EnterCriticalSection(&lock);
+			unordered_map<string, Entry>::const_iterator it =
+				entries.find(key);
+			bool hit = it != entries.end() &&
+				it->second.Algorithm == algorithm &&
+				it->second.FileStamp == fileStamp;
+			if (hit)
+				hashes[i] = it->second.Hash;
+			LeaveCriticalSection(&lock);
+
+			if (!hit) {
+				staleIndices.push_back(i);
+				stalePaths.push_back(paths[i]);
+				staleKeys.push_back(key);
+				staleStamps.push_back(fileStamp);
+			}
+		}
+
+		if (stalePaths.empty())
+			return;
+
+		vector<string> staleHashes;
+		CryptUtil::FileHashes(stalePaths, algorithm, staleHashes);
+
+		EnterCriticalSection(&lock);
+		for (size_t i = 0; i < staleIndices.size(); ++i) {
+			hashes[staleIndices[i]] = staleHashes[i];
+			if (!staleHashes[i].empty())
+				store(staleKeys[i], staleStamps[i], algorithm, staleHashes[i],
+					hashStart);
+		}
+		LeaveCriticalSection(&lock);
+	}
+
+	bool FileHashCache::Save() {
+		EnterCriticalSection(&lock);
+
+		for (unordered_map<string, Entry>::iterator it = entries.begin();
+			it != entries.end();) {
+
+			if (GetFileAttributes(it->first.c_str()) ==
+				INVALID_FILE_ATTRIBUTES) {
+
+				it = entries.erase(it);
+				changed = true;
+			} else {
+				++it;
+			}
+		}
+
+		if (!changed) {
+			LeaveCriticalSection(&lock);
+			return true;
+		}
+
+		string tempPath = path + ".tmp";
+		bool written = false;
+		{
+			ofstream tempFile;
+			tempFile.open(tempPath, ios::out | ios::trunc);
+			if (tempFile.is_open()) {
+				tempFile << "hashes " << formatVersion << "\n";
+				for (unordered_map<string, Entry>::const_iterator it =
+					entries.begin(); it != entries.end(); ++it) {
+
+					const Stamp &fileStamp = it->second.FileStamp;
+					tempFile << fileStamp.Size << " " << fileStamp.LastWrite <<
+						" " << fileStamp.FileIndex << " " << fileStamp.Volume <<
+						" " << CryptUtil::HashAlgorithmName(
+						it->second.Algorithm) << " " << it->second.Hash << " " <<
+						it->first << "\n";
+				}
+
+				written = !tempFile.fail();
+			}
+		}
+
+		if (written) {
+			written = MoveFileEx(tempPath.c_str(), path.c_str(),
+				MOVEFILE_REPLACE_EXISTING) != 0;
+			if (written)
+				changed = false;
+		}
+		if (!written)
+			DeleteFile(tempPath.c_str());
+
+		LeaveCriticalSection(&lock);
+
+		return written;
+	}
+
+	bool FileHashCache::GetStamp(const string &path, Stamp &out) {
+		// Opening for attributes only doesn't read any data
+		HANDLE file = CreateFile(path.c_str(), FILE_READ_ATTRIBUTES,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		BY_HANDLE_FILE_INFORMATION info;
+		bool succeeded = GetFileInformationByHandle(file, &info) != 0;
+		CloseHandle(file);
+		if (!succeeded || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			return false;
+
+		out.Size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) |
+			info.nFileSizeLow;
+		out.LastWrite = (static_cast<uint64_t>(
+			info.ftLastWriteTime.dwHighDateTime) << 32) |
+			info.ftLastWriteTime.dwLowDateTime;
+		out.FileIndex = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) |
+			info.nFileIndexLow;
+		out.Volume = info.dwVolumeSerialNumber;
+
+		return true;
+	}
+
+	string FileHashCache::fullPath(const string &path) {
+		char fullPath[MAX_PATH];
+		DWORD length = GetFullPathName(path.c_str(), MAX_PATH, fullPath,
+			nullptr);
+		if (length == 0 || length >= MAX_PATH)
+			return path;
+
+		return string(fullPath, length);
+	}
+
+	uint64_t FileHashCache::now() {
+		FILETIME time;
+		GetSystemTimeAsFileTime(&time);
+
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+			time.dwLowDateTime;
+	}
+
+	void FileHashCache::load() {
+		ifstream cacheFile(path);
+		string keyword;
+		int version = 0;
+		if (!(cacheFile >> keyword >> version) || keyword != "hashes" ||
+			version != formatVersion)
+			return;
+
+		Entry entry;
+		string algorithmName, entryPath;
+		while (cacheFile >> entry.FileStamp.Size >> entry.FileStamp.LastWrite
+			>> entry.FileStamp.FileIndex >> entry.FileStamp.Volume >>
+			algorithmName >> entry.Hash) {
+
+			cacheFile.get();
+			if (!getline(cacheFile, entryPath) || entryPath.empty())
+				break;
+
+			if (CryptUtil::HashAlgorithmFromName(algorithmName,
+				entry.Algorithm))
+				entries[entryPath] = entry;
+		}
+	}
+
+	void FileHashCache::store(const string &key, const Stamp &fileStamp,
+		HashAlgorithm algorithm, const string &hash, uint64_t hashStart) {
+
+		if (fileStamp.LastWrite + racyWindow >= hashStart) {
+			// Might be stale next time without the stamp telling, so
+			// whatever was stored before is no good either
+			changed = entries.erase(key) > 0 || changed;
+			return;
+		}
+
+		Entry &entry = entries[key];
+		entry.FileStamp = fileStamp;
+		entry.Algorithm = algorithm;
+		entry.Hash = hash;
+		changed = true;
+	}
+}
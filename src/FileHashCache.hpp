@@ -0,0 +1,77 @@
+#ifndef INETR_FILEHASHCACHE_HPP
+#define INETR_FILEHASHCACHE_HPP
+
+#include <cstdint>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+
+#include "CryptUtil.hpp"
+
+namespace inetr {
+	// Remembers file hashes on disk together with each file's size, last
+	// write time and file ID. A file whose metadata still matches is not
+	// read again.
+	class FileHashCache {
+	public:
+		struct Stamp {
+			uint64_t Size;
+			uint64_t LastWrite;
+			uint64_t FileIndex;
+			uint32_t Volume;
+
+			inline bool operator==(const Stamp &other) const {
+				return Size == other.Size && LastWrite == other.LastWrite &&
+					FileIndex == other.FileIndex && Volume == other.Volume;
+			}
+		};
+
+		// Reads a file's stamp without opening it for reading
+		static bool GetStamp(const std::string &path, Stamp &out);
+
+		FileHashCache(const std::string &path);
+		~FileHashCache();
+
+		// Like CryptUtil::FileHashes, but only changed files are hashed.
+		// May be called from several threads at once.
+		void FileHashes(const std::vector<std::string> &paths,
+			HashAlgorithm algorithm, std::vector<std::string> &hashes);
+
+		// Writes the cache if anything changed, entries of files that no
+		// longer exist are dropped
+		bool Save();
+	private:
+		struct Entry {
+			Stamp FileStamp;
+			HashAlgorithm Algorithm;
+			std::string Hash;
+		};
+
+		FileHashCache(const FileHashCache &original);
+		FileHashCache& operator=(const FileHashCache &original);
+
+		static const int formatVersion = 2;
+		// FAT keeps write times to two seconds, a file written this shortly
+		// before it was hashed might change again without its time changing
+		static const uint64_t racyWindow = 2 * 10000000;
+
+		static std::string fullPath(const std::string &path);
+		static uint64_t now();
+
+		void load();
+		void store(const std::string &key, const Stamp &fileStamp,
+			HashAlgorithm algorithm, const std::string &hash,
+			uint64_t hashStart);
+
+		std::string path;
+		std::unordered_map<std::string, Entry> entries;
+		bool changed;
+
+		CRITICAL_SECTION lock;
+	};
+}
+
+#endif  // !INETR_FILEHASHCACHE_HPP
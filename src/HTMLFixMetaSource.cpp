@@ -46,8 +46,11 @@ namespace inetr {
 		if (it == parameters.end())
 			return false;
 
-		string meta = StringUtil::DetokenizeVectorToPattern(
-			precedingMetaSources, it->second);
+		string meta;
+		if (!StringUtil::DetokenizeVectorToPattern(precedingMetaSources,
+			it->second, meta))
+			return false;
+
 		const char* const metaStr = meta.c_str();
 		char* const newStr = new char[strlen(metaStr) + 1];
 
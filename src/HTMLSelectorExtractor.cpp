@@ -0,0 +1,489 @@
+#include "HTMLSelectorExtractor.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace inetr {
+	const size_t HTMLSelectorExtractor::notCapturing = static_cast<size_t>(-1);
+
+	HTMLSelectorExtractor::HTMLSelectorExtractor() {
+		Reset();
+	}
+
+	bool HTMLSelectorExtractor::AddSelector(const string &selector) {
+		vector<Compound> compounds;
+
+		size_t pos = 0;
+		const size_t length = selector.length();
+		while (true) {
+			while (pos < length && isWhitespace(selector[pos]))
+				++pos;
+			if (pos >= length)
+				break;
+
+			Compound compound;
+			compound.NthChild = 0;
+
+			size_t start = pos;
+			while (pos < length && (isalnum(static_cast<unsigned char>(
+				selector[pos])) || selector[pos] == '-' || selector[pos] ==
+				'*'))
+				++pos;
+
+			for (size_t i = start; i < pos; ++i)
+				compound.Tag += static_cast<char>(tolower(
+					static_cast<unsigned char>(selector[i])));
+			if (compound.Tag == "*")
+				compound.Tag.clear();
+
+			while (pos < length && !isWhitespace(selector[pos])) {
+				char kind = selector[pos++];
+
+				if (kind == '.' || kind == '#') {
+					start = pos;
+					while (pos < length && (isalnum(static_cast<unsigned char>(
+						selector[pos])) || selector[pos] == '-' ||
+						selector[pos] == '_'))
+						++pos;
+					if (pos == start)
+						return false;
+
+					if (kind == '.')
+						compound.Classes.push_back(selector.substr(start,
+							pos - start));
+					else
+						compound.Id = selector.substr(start, pos - start);
+				} else if (kind == ':') {
+					if (selector.compare(pos, 10, "nth-child(") != 0)
+						return false;
+					pos += 10;
+
+					start = pos;
+					while (pos < length && isdigit(static_cast<unsigned char>(
+						selector[pos])))
+						++pos;
+					if (pos == start || pos >= length || selector[pos] != ')')
+						return false;
+
+					compound.NthChild = static_cast<size_t>(strtoul(
+						selector.c_str() + start, nullptr, 10));
+					if (compound.NthChild == 0)
+						return false;
+					++pos;
+				} else {
+					return false;
+				}
+			}
+
+			compounds.push_back(compound);
+		}
+
+		if (compounds.empty())
+			return false;
+
+		selectors.push_back(compounds);
+		results.push_back(string());
+		found.push_back(0);
+		captureDepth.push_back(notCapturing);
+
+		return true;
+	}
+
+	void HTMLSelectorExtractor::Reset() {
+		for (size_t i = 0; i < selectors.size(); ++i) {
+			results[i].clear();
+			found[i] = 0;
+			captureDepth[i] = notCapturing;
+		}
+		foundCount = 0;
+		captureCount = 0;
+
+		state = INETR_HSES_Text;
+		depth = 0;
+		rootChildCount = 0;
+
+		tagBuffer.clear();
+		quoteChar = '\0';
+		commentDashes = 0;
+		rawTextEnd.clear();
+		rawTextMatched = 0;
+	}
+
+	bool HTMLSelectorExtractor::Feed(const char *data, size_t length) {
+		if (IsComplete())
+			state = INETR_HSES_Done;
+
+		const char *end = data + length;
+		while (data < end) {
+			switch (state) {
+			case INETR_HSES_Text: {
+				const char *tagOpen = static_cast<const char*>(memchr(data,
+					'<', static_cast<size_t>(end - data)));
+				const char *textEnd = (tagOpen != nullptr) ? tagOpen : end;
+
+				if (captureCount > 0)
+					appendText(data, static_cast<size_t>(textEnd - data));
+
+				data = textEnd;
+				if (tagOpen != nullptr) {
+					tagBuffer.clear();
+					state = INETR_HSES_Tag;
+					++data;
+				}
+				break;
+			}
+			case INETR_HSES_Tag: {
+				char c = *data;
+
+				if (tagBuffer.empty() && !isalpha(static_cast<unsigned char>(
+					c)) && c != '/' && c != '!' && c != '?') {
+
+					// A lone '<' in text, hand it back to the text state
+					if (captureCount > 0)
+						appendText("<", 1);
+					state = INETR_HSES_Text;
+					break;
+				}
+
+				++data;
+
+				if (c == '>') {
+					processTag();
+					break;
+				}
+
+				if (c == '"' || c == '\'') {
+					size_t lastNonSpace = tagBuffer.find_last_not_of(
+						" \t\r\n");
+					if (lastNonSpace != string::npos && tagBuffer[lastNonSpace]
+						== '=') {
+
+						quoteChar = c;
+						state = INETR_HSES_TagQuote;
+					}
+				}
+
+				tagBuffer += c;
+
+				if (tagBuffer.length() == 3 && tagBuffer == "!--") {
+					commentDashes = 0;
+					state = INETR_HSES_Comment;
+				}
+				break;
+			}
+			case INETR_HSES_TagQuote: {
+				const char *quoteEnd = static_cast<const char*>(memchr(data,
+					quoteChar, static_cast<size_t>(end - data)));
+				const char *valueEnd = (quoteEnd != nullptr) ? quoteEnd + 1 :
+					end;
+
+				tagBuffer.append(data, valueEnd);
+				data = valueEnd;
+
+				if (quoteEnd != nullptr)
+					state = INETR_HSES_Tag;
+				break;
+			}
+			case INETR_HSES_Comment: {
+				char c = *data++;
+
+				if (c == '-') {
+					++commentDashes;
+				} else {
+					if (c == '>' && commentDashes >= 2)
+						state = INETR_HSES_Text;
+					commentDashes = 0;
+				}
+				break;
+			}
+			case INETR_HSES_RawText: {
+				char c = static_cast<char>(tolower(static_cast<unsigned char>(
+					*data++)));
+
+				if (c == rawTextEnd[rawTextMatched]) {
+					if (++rawTextMatched == rawTextEnd.length()) {
+						tagBuffer = rawTextEnd.substr(1);
+						state = INETR_HSES_Tag;
+					}
+				} else {
+					rawTextMatched = (c == rawTextEnd[0]) ? 1 : 0;
+				}
+				break;
+			}
+			case INETR_HSES_Done:
+				return false;
+			}
+		}
+
+		return (state != INETR_HSES_Done);
+	}
+
+	bool HTMLSelectorExtractor::isWhitespace(char c) {
+		return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f');
+	}
+
+	bool HTMLSelectorExtractor::isVoidElement(const string &name) {
+		static const char* const voidElements[] = { "area", "base", "br",
+			"col", "embed", "hr", "img", "input", "link", "meta", "param",
+			"source", "track", "wbr" };
+
+		for (size_t i = 0; i < sizeof(voidElements) / sizeof(voidElements[0]);
+			++i) {
+
+			if (name == voidElements[i])
+				return true;
+		}
+
+		return false;
+	}
+
+	bool HTMLSelectorExtractor::isImplicitlyClosedBySibling(
+		const string &name) {
+
+		static const char* const elements[] = { "dd", "dt", "li", "option",
+			"p", "td", "th", "tr" };
+
+		for (size_t i = 0; i < sizeof(elements) / sizeof(elements[0]); ++i) {
+			if (name == elements[i])
+				return true;
+		}
+
+		return false;
+	}
+
+	bool HTMLSelectorExtractor::matches(const Compound &compound,
+		const string &name, const string &id, const string &classes,
+		size_t position) {
+
+		if (!compound.Tag.empty() && compound.Tag != name)
+			return false;
+		if (!compound.Id.empty() && compound.Id != id)
+			return false;
+		if (compound.NthChild != 0 && compound.NthChild != position)
+			return false;
+
+		for (vector<string>::const_iterator it = compound.Classes.begin();
+			it != compound.Classes.end(); ++it) {
+
+			size_t pos = 0;
+			bool classFound = false;
+			while ((pos = classes.find(*it, pos)) != string::npos) {
+				size_t after = pos + it->length();
+				if ((pos == 0 || isWhitespace(classes[pos - 1])) && (after ==
+					classes.length() || isWhitespace(classes[after]))) {
+
+					classFound = true;
+					break;
+				}
+				pos = after;
+			}
+
+			if (!classFound)
+				return false;
+		}
+
+		return true;
+	}
+
+	void HTMLSelectorExtractor::processTag() {
+		state = INETR_HSES_Text;
+
+		if (tagBuffer.empty() || tagBuffer[0] == '!' || tagBuffer[0] == '?')
+			return;
+
+		const size_t length = tagBuffer.length();
+		bool isEndTag = (tagBuffer[0] == '/');
+
+		size_t pos = isEndTag ? 1 : 0;
+		string name;
+		while (pos < length && (isalnum(static_cast<unsigned char>(
+			tagBuffer[pos])) || tagBuffer[pos] == '-' || tagBuffer[pos] ==
+			':')) {
+
+			name += static_cast<char>(tolower(static_cast<unsigned char>(
+				tagBuffer[pos])));
+			++pos;
+		}
+
+		if (name.empty())
+			return;
+
+		if (isEndTag) {
+			closeElement(name);
+			return;
+		}
+
+		bool selfClosing = (tagBuffer[length - 1] == '/');
+
+		string id, classes;
+		while (pos < length) {
+			if (isWhitespace(tagBuffer[pos]) || tagBuffer[pos] == '/') {
+				++pos;
+				continue;
+			}
+
+			size_t attrStart = pos;
+			while (pos < length && !isWhitespace(tagBuffer[pos]) &&
+				tagBuffer[pos] != '=' && tagBuffer[pos] != '/')
+				++pos;
+
+			string attrName;
+			for (size_t i = attrStart; i < pos; ++i)
+				attrName += static_cast<char>(tolower(
+					static_cast<unsigned char>(tagBuffer[i])));
+
+			while (pos < length && isWhitespace(tagBuffer[pos]))
+				++pos;
+			if (pos >= length || tagBuffer[pos] != '=') {
+				if (pos == attrStart)
+					++pos;
+				continue;
+			}
+			++pos;
+			while (pos < length && isWhitespace(tagBuffer[pos]))
+				++pos;
+
+			size_t valueStart, valueEnd;
+			if (pos < length && (tagBuffer[pos] == '"' || tagBuffer[pos] ==
+				'\'')) {
+
+				char quote = tagBuffer[pos];
+				valueStart = ++pos;
+				valueEnd = tagBuffer.find(quote, pos);
+				if (valueEnd == string::npos)
+					valueEnd = length;
+				pos = valueEnd + 1;
+			} else {
+				valueStart = pos;
+				while (pos < length && !isWhitespace(tagBuffer[pos]))
+					++pos;
+				valueEnd = pos;
+			}
+
+			if (attrName == "id")
+				id = tagBuffer.substr(valueStart, valueEnd - valueStart);
+			else if (attrName == "class")
+				classes = tagBuffer.substr(valueStart, valueEnd - valueStart);
+		}
+
+		bool isVoid = selfClosing || isVoidElement(name);
+		openElement(name, id, classes, isVoid);
+
+		if (!isVoid && state != INETR_HSES_Done && (name == "script" ||
+			name == "style")) {
+
+			rawTextEnd = "</" + name;
+			rawTextMatched = 0;
+			state = INETR_HSES_RawText;
+		}
+	}
+
+	void HTMLSelectorExtractor::openElement(const string &name,
+		const string &id, const string &classes, bool isVoid) {
+
+		if (depth > 0 && frames[depth - 1].Name == name &&
+			isImplicitlyClosedBySibling(name))
+			popFrame();
+
+		size_t position = (depth == 0) ? ++rootChildCount :
+			++frames[depth - 1].ChildCount;
+
+		if (depth == frames.size())
+			frames.push_back(Frame());
+
+		Frame &frame = frames[depth];
+		frame.Name = name;
+		frame.ChildCount = 0;
+		frame.Matched.resize(selectors.size());
+
+		for (size_t s = 0; s < selectors.size(); ++s) {
+			const vector<Compound> &compounds = selectors[s];
+
+			size_t matched = (depth == 0) ? 0 : frames[depth - 1].Matched[s];
+			bool isTarget = false;
+			if (matched < compounds.size() && matches(compounds[matched], name,
+				id, classes, position)) {
+
+				++matched;
+				isTarget = (matched == compounds.size());
+			}
+			frame.Matched[s] = matched;
+
+			if (isTarget && !found[s] && captureDepth[s] == notCapturing) {
+				captureDepth[s] = depth;
+				results[s].clear();
+				++captureCount;
+			}
+		}
+
+		if (isVoid) {
+			for (size_t s = 0; s < selectors.size(); ++s) {
+				if (captureDepth[s] == depth)
+					finishCapture(s);
+			}
+			return;
+		}
+
+		++depth;
+	}
+
+	void HTMLSelectorExtractor::closeElement(const string &name) {
+		size_t i = depth;
+		while (i > 0 && frames[i - 1].Name != name)
+			--i;
+
+		if (i == 0)
+			return;
+
+		while (depth >= i)
+			popFrame();
+	}
+
+	void HTMLSelectorExtractor::popFrame() {
+		--depth;
+
+		if (captureCount == 0)
+			return;
+
+		for (size_t s = 0; s < selectors.size(); ++s) {
+			if (captureDepth[s] == depth)
+				finishCapture(s);
+		}
+	}
+
+	void HTMLSelectorExtractor::finishCapture(size_t selector) {
+		string &result = results[selector];
+		if (!result.empty() && result[result.length() - 1] == ' ')
+			result.erase(result.length() - 1);
+
+		found[selector] = 1;
+		++foundCount;
+		captureDepth[selector] = notCapturing;
+		--captureCount;
+
+		if (IsComplete())
+			state = INETR_HSES_Done;
+	}
+
+	void HTMLSelectorExtractor::appendText(const char *data, size_t length) {
+		for (size_t s = 0; s < selectors.size(); ++s) {
+			if (captureDepth[s] == notCapturing)
+				continue;
+
+			string &result = results[s];
+			for (size_t i = 0; i < length; ++i) {
+				if (!isWhitespace(data[i]))
+					result += data[i];
+				else if (!result.empty() && result[result.length() - 1] != ' ')
+					result += ' ';
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef INETR_HTMLSELECTOREXTRACTOR_HPP
+#define INETR_HTMLSELECTOREXTRACTOR_HPP
+
+#include <string>
+#include <vector>
+
+namespace inetr {
+	enum HTMLSelectorExtractorState { INETR_HSES_Text, INETR_HSES_Tag,
+		INETR_HSES_TagQuote, INETR_HSES_Comment, INETR_HSES_RawText,
+		INETR_HSES_Done };
+
+	// Evaluates a set of CSS selectors (subset: tag, .class, #id,
+	// :nth-child(n), descendant combinator) against an HTML document that
+	// is fed in arbitrary chunks and collects the text content of the first
+	// element matching each selector. Only the stack of currently open
+	// elements is kept, no document tree is built, and parsing stops as
+	// soon as every selector has been satisfied.
+	class HTMLSelectorExtractor {
+	public:
+		HTMLSelectorExtractor();
+
+		bool AddSelector(const std::string &selector);
+
+		// Returns false once all selectors have been satisfied
+		bool Feed(const char *data, size_t length);
+		void Reset();
+
+		inline bool IsComplete() const {
+			return foundCount == selectors.size();
+		}
+		inline size_t GetSelectorCount() const { return selectors.size(); }
+		inline bool IsFound(size_t selector) const {
+			return found[selector] != 0;
+		}
+		inline const std::vector<std::string> &GetResults() const {
+			return results;
+		}
+	private:
+		struct Compound {
+			std::string Tag;
+			std::string Id;
+			std::vector<std::string> Classes;
+			size_t NthChild;
+		};
+
+		struct Frame {
+			std::string Name;
+			size_t ChildCount;
+			std::vector<size_t> Matched;
+		};
+
+		static const size_t notCapturing;
+
+		static bool isWhitespace(char c);
+		static bool isVoidElement(const std::string &name);
+		static bool isImplicitlyClosedBySibling(const std::string &name);
+		static bool matches(const Compound &compound, const std::string &name,
+			const std::string &id, const std::string &classes,
+			size_t position);
+
+		void processTag();
+		void openElement(const std::string &name, const std::string &id,
+			const std::string &classes, bool isVoid);
+		void closeElement(const std::string &name);
+		void popFrame();
+		void finishCapture(size_t selector);
+		void appendText(const char *data, size_t length);
+
+		std::vector<std::vector<Compound> > selectors;
+
+		std::vector<std::string> results;
+		std::vector<char> found;
+		std::vector<size_t> captureDepth;
+		size_t foundCount;
+		size_t captureCount;
+
+		HTMLSelectorExtractorState state;
+		std::vector<Frame> frames;
+		size_t depth;
+		size_t rootChildCount;
+
+		std::string tagBuffer;
+		char quoteChar;
+		int commentDashes;
+		std::string rawTextEnd;
+		size_t rawTextMatched;
+	};
+}
+
+#endif  // !INETR_HTMLSELECTOREXTRACTOR_HPP
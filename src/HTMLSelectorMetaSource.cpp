@@ -0,0 +1,64 @@
+#include "HTMLSelectorMetaSource.hpp"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ExtractorStreamBuf.hpp"
+#include "HTMLSelectorExtractor.hpp"
+#include "HTTP.hpp"
+#include "StringUtil.hpp"
+
+using std::map;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace inetr {
+	bool HTMLSelectorMetaSource::Get(const map<string, string> &parameters,
+		vector<string> &precedingMetaSources, string &out) const {
+
+		map<string, string>::const_iterator itSIn = parameters.find("sIn"),
+			itSURL = parameters.find("sURL"),
+			itSSelector = parameters.find("sSelector"),
+			itSOut = parameters.find("sOut");
+
+		if ((itSIn == parameters.end() && itSURL == parameters.end()) ||
+			itSSelector == parameters.end() || itSOut == parameters.end())
+			return false;
+
+		HTMLSelectorExtractor extractor;
+
+		StringTokenizer selectors(itSSelector->second, "|");
+		StringRef selector;
+		while (selectors.Next(selector)) {
+			if (!extractor.AddSelector(selector.Trim().ToString()))
+				return false;
+		}
+
+		if (itSURL != parameters.end()) {
+			ExtractorStreamBuf<HTMLSelectorExtractor> extractorBuf(extractor);
+			ostream extractorStream(&extractorBuf);
+
+			try {
+				HTTP::Get(itSURL->second, &extractorStream);
+			} catch(...) {
+				if (!extractor.IsComplete())
+					return false;
+			}
+		} else {
+			string in;
+			if (!StringUtil::DetokenizeVectorToPattern(precedingMetaSources,
+				itSIn->second, in))
+				return false;
+
+			extractor.Feed(in.data(), in.size());
+		}
+
+		vector<string> lRes(extractor.GetResults());
+
+		return StringUtil::DetokenizeVectorToPattern(lRes, itSOut->second,
+			out);
+	}
+}
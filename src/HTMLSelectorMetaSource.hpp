@@ -0,0 +1,22 @@
+#ifndef INETR_HTMLSELECTORMETASOURCE_HPP
+#define INETR_HTMLSELECTORMETASOURCE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MetaSourcePrototype.hpp"
+
+namespace inetr {
+	class HTMLSelectorMetaSource : public MetaSourcePrototype {
+	public:
+		HTMLSelectorMetaSource() : MetaSourcePrototype("html") { }
+		~HTMLSelectorMetaSource() { }
+
+		bool Get(const std::map<std::string, std::string> &parameters,
+			std::vector<std::string> &precedingMetaSources, std::string &out)
+			const;
+	};
+}
+
+#endif  // !INETR_HTMLSELECTORMETASOURCE_HPP
@@ -1,5 +1,8 @@
 #include "HTTP.hpp"
 
+#include <algorithm>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
 
@@ -8,13 +11,113 @@
 #include "INETRException.hpp"
 #include "ssize_t.h"
 
+using std::map;
 using std::ostream;
+using std::set;
 using std::streamsize;
 using std::string;
 using std::stringstream;
 
 namespace inetr {
+	namespace {
+		__declspec(thread) HTTPAbortGroup *threadAbortGroup = nullptr;
+	}
+
+	struct HTTPAbortGroup::State {
+		CRITICAL_SECTION Lock;
+		set<size_t> Sockets;
+		bool Aborted;
+	};
+
+	HTTPAbortGroup::Scope::Scope(HTTPAbortGroup &group) {
+		previous = threadAbortGroup;
+		threadAbortGroup = &group;
+	}
+
+	HTTPAbortGroup::Scope::~Scope() {
+		threadAbortGroup = previous;
+	}
+
+	HTTPAbortGroup::HTTPAbortGroup() {
+		state = new State();
+		InitializeCriticalSection(&state->Lock);
+		state->Aborted = false;
+	}
+
+	HTTPAbortGroup::~HTTPAbortGroup() {
+		DeleteCriticalSection(&state->Lock);
+		delete state;
+	}
+
+	void HTTPAbortGroup::Abort() {
+		EnterCriticalSection(&state->Lock);
+		state->Aborted = true;
+
+		// Blocked receives return at once, the requests then fail and
+		// close their sockets themselves
+		for (set<size_t>::const_iterator it = state->Sockets.begin();
+			it != state->Sockets.end(); ++it) {
+
+			shutdown(static_cast<SOCKET>(*it), SD_BOTH);
+		}
+		LeaveCriticalSection(&state->Lock);
+	}
+
+	void HTTPAbortGroup::Reset() {
+		EnterCriticalSection(&state->Lock);
+		state->Aborted = false;
+		LeaveCriticalSection(&state->Lock);
+	}
+
+	HTTPAbortGroup *HTTPAbortGroup::current() {
+		return threadAbortGroup;
+	}
+
+	bool HTTPAbortGroup::add(size_t socket) {
+		EnterCriticalSection(&state->Lock);
+		bool aborted = state->Aborted;
+		if (!aborted)
+			state->Sockets.insert(socket);
+		LeaveCriticalSection(&state->Lock);
+
+		return !aborted;
+	}
+
+	void HTTPAbortGroup::remove(size_t socket) {
+		EnterCriticalSection(&state->Lock);
+		state->Sockets.erase(socket);
+		LeaveCriticalSection(&state->Lock);
+	}
+
+	HTTP::Connection::Connection(size_t socket) {
+		this->socket = socket;
+		group = HTTPAbortGroup::current();
+		aborted = group != nullptr && !group->add(socket);
+		open = true;
+	}
+
+	HTTP::Connection::~Connection() {
+		Close();
+	}
+
+	void HTTP::Connection::Close() {
+		if (!open)
+			return;
+		open = false;
+
+		// The socket leaves the group before its handle can be reused
+		if (group != nullptr && !aborted)
+			group->remove(socket);
+		closesocket(static_cast<SOCKET>(socket));
+	}
+
 	void HTTP::Get(string url, ostream *stream) {
+		Get(url, stream, map<string, string>(), nullptr);
+	}
+
+	void HTTP::Get(string url, ostream *stream, const map<string, string>
+		&requestHeaders, map<string, string> *responseHeaders) {
+
 		if (url == "")
 			throw INETRException("[emptyURL]");
 
@@ -72,11 +175,27 @@ namespace inetr {
 		if (ptr == nullptr)
 			throw INETRException("[connFailedErr]");
 
+		Connection connection(sock);
+		if (connection.IsAborted())
+			throw INETRException("[connFailedErr]");
+
+		DWORD timeout = socketTimeout;
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
+			reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+		setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO,
+			reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
 		string request = "GET "
 			+ filePath
 			+ " HTTP/1.1\r\nHost: "
 			+ hostname
-			+ "\r\nConnection: close\r\n\r\n";
+			+ "\r\nConnection: close\r\n";
+		for (map<string, string>::const_iterator it = requestHeaders.begin();
+			it != requestHeaders.end(); ++it) {
+
+			request += it->first + ": " + it->second + "\r\n";
+		}
+		request += "\r\n";
 
 		sendAll(sock, request.c_str(), request.size());
 
@@ -109,7 +228,9 @@ namespace inetr {
 					if (left == "Location:") {
 						string newurl;
 						sstream >> newurl;
-						return Get(newurl, stream);
+						connection.Close();
+						return Get(newurl, stream, requestHeaders,
+							responseHeaders);
 					}
 				}
 			}
@@ -131,13 +252,22 @@ namespace inetr {
 			sstream >> left;
 			sstream.ignore();
 
+			string value;
+			getline(sstream, value);
+			if (!value.empty() && value[value.length() - 1] == '\r')
+				value.erase(value.length() - 1);
+
+			if (responseHeaders != nullptr && left.length() > 1) {
+				string name = left.substr(0, left.length() - 1);
+				transform(name.begin(), name.end(), name.begin(), ::tolower);
+				(*responseHeaders)[name] = value;
+			}
+
 			if (left == "Content-Length:")
-				sstream >> size;
+				stringstream(value) >> size;
 
 			if (left == "Transfer-Encoding:") {
-				string transferEncoding;
-				sstream >> transferEncoding;
-				if (transferEncoding == "chunked")
+				if (value.find("chunked") != string::npos)
 					chunked = true;
 			}
 		}
@@ -153,6 +283,8 @@ namespace inetr {
 
 				recvSize += (size_t)bytesRecv;
 				stream->write(buf, (streamsize)bytesRecv);
+				if (stream->fail())
+					break;
 			}
 		} else {
 			if (!chunked) {
@@ -162,6 +294,8 @@ namespace inetr {
 						throw INETRException("[recvErr]");
 
 					stream->write(buf, (streamsize)bytesRecv);
+					if (stream->fail())
+						break;
 				}
 			} else {
 				while (true) {
@@ -184,8 +318,13 @@ namespace inetr {
 
 						recvSize += (size_t)bytesRecv;
 						stream->write(buf, (streamsize)bytesRecv);
+						if (stream->fail())
+							break;
 					}
 
+					if (stream->fail())
+						break;
+
 					for (unsigned char i = 0; i < 2; ++i) {
 						char tmp;
 						recv(sock, &tmp, 1, 0);
@@ -194,14 +333,18 @@ namespace inetr {
 			}
 		}
 
-		closesocket(sock);
+		connection.Close();
 	}
 
 	void HTTP::getLine(size_t socket, std::stringstream &out) {
+		// A timed out, aborted or closed connection mustn't look like an
+		// empty line, header loops would never end
 		for (char c; recv(socket, &c, 1, 0) > 0; out << c) {
 			if (c == '\n')
 				return;
 		}
+
+		throw INETRException("[recvErr]");
 	}
 
 	void HTTP::sendAll(size_t socket, const char* const buf,
@@ -1,14 +1,80 @@
 #ifndef INTERNETRADIO_HTTP_HPP
 #define INTERNETRADIO_HTTP_HPP
 
+#include <map>
 #include <ostream>
+#include <sstream>
 #include <string>
 
 namespace inetr {
+	// Lets one thread abort the requests of others. A thread takes part in
+	// a group while a Scope for it exists; Abort shuts down the sockets of
+	// the group's running requests and makes new ones fail until Reset.
+	class HTTPAbortGroup {
+	public:
+		class Scope {
+		public:
+			Scope(HTTPAbortGroup &group);
+			~Scope();
+		private:
+			Scope(const Scope &original);
+			Scope& operator=(const Scope &original);
+
+			HTTPAbortGroup *previous;
+		};
+
+		HTTPAbortGroup();
+		~HTTPAbortGroup();
+
+		void Abort();
+		void Reset();
+	private:
+		friend class HTTP;
+
+		struct State;
+
+		HTTPAbortGroup(const HTTPAbortGroup &original);
+		HTTPAbortGroup& operator=(const HTTPAbortGroup &original);
+
+		// The group of the calling thread, or nullptr
+		static HTTPAbortGroup *current();
+
+		// Returns false if the group has been aborted
+		bool add(size_t socket);
+		void remove(size_t socket);
+
+		State *state;
+	};
+
 	class HTTP {
 	public:
 		static void Get(std::string url, std::ostream *stream);
+		// Response header names are stored in lower case
+		static void Get(std::string url, std::ostream *stream,
+			const std::map<std::string, std::string> &requestHeaders,
+			std::map<std::string, std::string> *responseHeaders);
 	private:
+		// Closes its socket on every way out of Get and keeps the calling
+		// thread's abort group informed
+		class Connection {
+		public:
+			Connection(size_t socket);
+			~Connection();
+
+			inline bool IsAborted() const { return aborted; }
+			void Close();
+		private:
+			Connection(const Connection &original);
+			Connection& operator=(const Connection &original);
+
+			size_t socket;
+			HTTPAbortGroup *group;
+			bool aborted;
+			bool open;
+		};
+
+		static const int socketTimeout = 10000;
+
 		static void getLine(size_t socket, std::stringstream &out);
 		static void sendAll(size_t socket, const char* const buf, const size_t size);
 	};
@@ -0,0 +1,224 @@
+#include "IcyDemuxer.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::string;
+
+namespace inetr {
+	IcyDemuxer::IcyDemuxer(IcyDemuxerListener *listener) {
+		this->listener = listener;
+		this->readHeaders = true;
+		this->metaInterval = 0;
+
+		Reset();
+	}
+
+	IcyDemuxer::IcyDemuxer(IcyDemuxerListener *listener, size_t metaInterval) {
+		this->listener = listener;
+		this->readHeaders = false;
+		this->metaInterval = metaInterval;
+
+		Reset();
+	}
+
+	void IcyDemuxer::Reset() {
+		state = readHeaders ? INETR_IDS_Headers : INETR_IDS_Audio;
+		if (readHeaders)
+			metaInterval = 0;
+		audioBytesLeft = metaInterval;
+		metaBytesLeft = 0;
+
+		headerBuffer.clear();
+		metaBuffer.clear();
+
+		currentMetadata = IcyMetadata();
+	}
+
+	void IcyDemuxer::Feed(const char *data, size_t length) {
+		while (length > 0) {
+			size_t consumed = 0;
+
+			switch (state) {
+			case INETR_IDS_Headers:
+				consumed = feedHeaders(data, length);
+				break;
+			case INETR_IDS_Audio:
+				if (metaInterval == 0) {
+					consumed = length;
+				} else {
+					consumed = min(length, audioBytesLeft);
+					audioBytesLeft -= consumed;
+					if (audioBytesLeft == 0)
+						state = INETR_IDS_MetaLength;
+				}
+
+				if (consumed > 0)
+					listener->OnAudioData(data, consumed);
+				break;
+			case INETR_IDS_MetaLength:
+				consumed = 1;
+				metaBytesLeft = static_cast<size_t>(
+					static_cast<unsigned char>(*data)) * 16;
+
+				if (metaBytesLeft == 0) {
+					audioBytesLeft = metaInterval;
+					state = INETR_IDS_Audio;
+				} else {
+					metaBuffer.clear();
+					state = INETR_IDS_Metadata;
+				}
+				break;
+			case INETR_IDS_Metadata:
+				consumed = min(length, metaBytesLeft);
+
+				if (metaBuffer.empty() && consumed == metaBytesLeft) {
+					metadataBlockComplete(data, consumed);
+				} else {
+					metaBuffer.append(data, consumed);
+					if (consumed == metaBytesLeft)
+						metadataBlockComplete(metaBuffer.data(),
+							metaBuffer.size());
+				}
+
+				metaBytesLeft -= consumed;
+				if (metaBytesLeft == 0) {
+					audioBytesLeft = metaInterval;
+					state = INETR_IDS_Audio;
+				}
+				break;
+			case INETR_IDS_Error:
+				return;
+			}
+
+			data += consumed;
+			length -= consumed;
+		}
+	}
+
+	size_t IcyDemuxer::feedHeaders(const char *data, size_t length) {
+		const char *lineEnd = static_cast<const char*>(memchr(data, '\n',
+			length));
+		size_t consumed = (lineEnd == nullptr) ? length :
+			static_cast<size_t>(lineEnd - data) + 1;
+
+		headerBuffer.append(data, consumed);
+		if (headerBuffer.size() > maxHeaderSize) {
+			state = INETR_IDS_Error;
+			return consumed;
+		}
+
+		if (lineEnd == nullptr)
+			return consumed;
+
+		string line;
+		line.swap(headerBuffer);
+		while (!line.empty() && (line[line.size() - 1] == '\n' ||
+			line[line.size() - 1] == '\r'))
+			line.erase(line.size() - 1);
+
+		if (line.empty()) {
+			audioBytesLeft = metaInterval;
+			state = INETR_IDS_Audio;
+		} else {
+			parseHeaderLine(line);
+		}
+
+		return consumed;
+	}
+
+	void IcyDemuxer::parseHeaderLine(const string &line) {
+		size_t colonPos = line.find(':');
+		if (colonPos == string::npos)
+			return;
+
+		string name = line.substr(0, colonPos);
+		for (string::iterator it = name.begin(); it != name.end(); ++it)
+			*it = static_cast<char>(tolower(static_cast<unsigned char>(*it)));
+
+		if (name != "icy-metaint")
+			return;
+
+		metaInterval = static_cast<size_t>(strtoul(line.c_str() + colonPos +
+			1, nullptr, 10));
+	}
+
+	void IcyDemuxer::metadataBlockComplete(const char *block, size_t length) {
+		IcyMetadata metadata;
+		if (!ParseMetadata(block, length, metadata))
+			return;
+
+		currentMetadata = metadata;
+		listener->OnMetadata(currentMetadata);
+	}
+
+	bool IcyDemuxer::ParseMetadata(const char *block, size_t length,
+		IcyMetadata &out) {
+
+		const char *nulPos = static_cast<const char*>(memchr(block, '\0',
+			length));
+		if (nulPos != nullptr)
+			length = static_cast<size_t>(nulPos - block);
+
+		const char *ptr = block;
+		const char *end = block + length;
+		bool found = false;
+
+		while (ptr < end) {
+			const char *keyEnd = ptr;
+			while (keyEnd + 1 < end && !(keyEnd[0] == '=' && keyEnd[1] ==
+				'\''))
+				++keyEnd;
+			if (keyEnd + 1 >= end)
+				break;
+
+			const char *valueBegin = keyEnd + 2;
+
+			// Values may contain quotes themselves ("Guns N' Roses"), so a
+			// value only ends at a quote followed by ';' and either the next
+			// key or the end of the block
+			const char *valueEnd = nullptr;
+			for (const char *it = valueBegin; it < end; ++it) {
+				if (*it != '\'')
+					continue;
+				if (it + 1 == end) {
+					valueEnd = it;
+					break;
+				}
+				if (it[1] != ';')
+					continue;
+
+				const char *next = it + 2;
+				while (next < end && *next != ';' && *next != '=' &&
+					*next != '\'')
+					++next;
+				if (next + 1 >= end || (next[0] == '=' && next[1] == '\'')) {
+					valueEnd = it;
+					break;
+				}
+			}
+			if (valueEnd == nullptr)
+				break;
+
+			string key(ptr, keyEnd);
+			if (key == "StreamTitle") {
+				out.StreamTitle.assign(valueBegin, valueEnd);
+				found = true;
+			} else if (key == "StreamUrl") {
+				out.StreamUrl.assign(valueBegin, valueEnd);
+				found = true;
+			}
+
+			ptr = valueEnd + 1;
+			if (ptr < end && *ptr == ';')
+				++ptr;
+		}
+
+		return found;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef INETR_ICYDEMUXER_HPP
+#define INETR_ICYDEMUXER_HPP
+
+#include <string>
+
+namespace inetr {
+	struct IcyMetadata {
+		std::string StreamTitle;
+		std::string StreamUrl;
+	};
+
+	class IcyDemuxerListener {
+	public:
+		virtual ~IcyDemuxerListener() { }
+
+		virtual void OnAudioData(const char *data, size_t length) = 0;
+		virtual void OnMetadata(const IcyMetadata &metadata) = 0;
+	};
+
+	enum IcyDemuxerState { INETR_IDS_Headers, INETR_IDS_Audio,
+		INETR_IDS_MetaLength, INETR_IDS_Metadata, INETR_IDS_Error };
+
+	// Splits an ICY ("Icy-MetaData: 1") byte stream into audio data and
+	// metadata blocks. Audio is handed to the listener as pointers into the
+	// buffer passed to Feed, it is never copied.
+	class IcyDemuxer {
+	public:
+		// Starts by consuming the HTTP/ICY response headers and takes the
+		// metadata interval from the icy-metaint header
+		IcyDemuxer(IcyDemuxerListener *listener);
+		// Starts directly at the audio data with a known metadata interval,
+		// an interval of 0 means the stream carries no metadata
+		IcyDemuxer(IcyDemuxerListener *listener, size_t metaInterval);
+
+		void Feed(const char *data, size_t length);
+		void Reset();
+
+		inline IcyDemuxerState GetState() const { return state; }
+		inline size_t GetMetaInterval() const { return metaInterval; }
+		inline const IcyMetadata &GetCurrentMetadata() const {
+			return currentMetadata;
+		}
+
+		static bool ParseMetadata(const char *block, size_t length,
+			IcyMetadata &out);
+	private:
+		static const size_t maxHeaderSize = 16384;
+
+		size_t feedHeaders(const char *data, size_t length);
+		void parseHeaderLine(const std::string &line);
+		void metadataBlockComplete(const char *block, size_t length);
+
+		IcyDemuxerListener *listener;
+
+		IcyDemuxerState state;
+		bool readHeaders;
+
+		size_t metaInterval;
+		size_t audioBytesLeft;
+		size_t metaBytesLeft;
+
+		std::string headerBuffer;
+		std::string metaBuffer;
+
+		IcyMetadata currentMetadata;
+	};
+}
+
+#endif  // !INETR_ICYDEMUXER_HPP
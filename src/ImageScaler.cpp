@@ -0,0 +1,250 @@
+#include "ImageScaler.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+	defined(__SSE2__)
+#define INETR_IMAGESCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+using std::max;
+using std::min;
+using std::vector;
+
+namespace inetr {
+	void ImageScaler::Scale(const PixelImage &source, uint32_t width,
+		uint32_t height, ScaleFilter filter, PixelImage &out) {
+
+		out.Width = width;
+		out.Height = height;
+		out.Pixels.assign(static_cast<size_t>(width) * height, 0);
+		if (width == 0 || height == 0 || source.Width == 0 ||
+			source.Height == 0)
+			return;
+
+		WeightTable rowWeights, columnWeights;
+		buildWeights(source.Width, width, filter, rowWeights);
+		buildWeights(source.Height, height, filter, columnWeights);
+
+		vector<float> rows;
+		scaleRows(source, rowWeights, rows);
+		scaleColumns(rows, width, columnWeights, &out.Pixels[0], width);
+	}
+
+	void ImageScaler::Letterbox(const PixelImage &source, uint32_t size,
+		ScaleFilter filter, PixelImage &out) {
+
+		out.Width = size;
+		out.Height = size;
+		out.Pixels.assign(static_cast<size_t>(size) * size, 0);
+		if (size == 0 || source.Width == 0 || source.Height == 0)
+			return;
+
+		uint32_t width, height;
+		if (source.Width >= source.Height) {
+			width = min(source.Width, size);
+			height = max<uint32_t>(1, static_cast<uint32_t>(
+				static_cast<uint64_t>(width) * source.Height / source.Width));
+		} else {
+			height = min(source.Height, size);
+			width = max<uint32_t>(1, static_cast<uint32_t>(
+				static_cast<uint64_t>(height) * source.Width / source.Height));
+		}
+
+		WeightTable rowWeights, columnWeights;
+		buildWeights(source.Width, width, filter, rowWeights);
+		buildWeights(source.Height, height, filter, columnWeights);
+
+		vector<float> rows;
+		scaleRows(source, rowWeights, rows);
+
+		uint32_t x = (size - width) / 2;
+		uint32_t y = (size - height) / 2;
+		scaleColumns(rows, width, columnWeights, &out.Pixels[0] +
+			static_cast<size_t>(y) * size + x, size);
+	}
+
+	double ImageScaler::filterWeight(ScaleFilter filter, double pixel,
+		double center, double scale) {
+
+		if (filter == INETR_SF_Area) {
+			// Share of the source pixel covered by the output pixel
+			double left = center - 0.5 * scale;
+			double right = center + 0.5 * scale;
+			return max(0.0, min(pixel + 1.0, right) - max(pixel, left));
+		}
+
+		const double pi = 3.14159265358979323846;
+		double x = (pixel + 0.5 - center) / scale;
+		if (x == 0.0)
+			return 1.0;
+		if (x <= -lanczosLobes || x >= lanczosLobes)
+			return 0.0;
+
+		return lanczosLobes * sin(pi * x) * sin(pi * x / lanczosLobes) /
+			(pi * pi * x * x);
+	}
+
+	void ImageScaler::buildWeights(uint32_t sourceLength, uint32_t length,
+		ScaleFilter filter, WeightTable &out) {
+
+		// When shrinking the filter is widened to cover every source pixel
+		double ratio = static_cast<double>(sourceLength) / length;
+		double scale = max(1.0, ratio);
+		double support = (filter == INETR_SF_Area) ? 0.5 * scale :
+			lanczosLobes * scale;
+
+		out.Stride = static_cast<uint32_t>(ceil(2.0 * support)) + 3;
+		out.First.resize(length);
+		out.Count.resize(length);
+		out.Weights.assign(static_cast<size_t>(length) * out.Stride, 0.0f);
+
+		vector<double> weights(out.Stride);
+		for (uint32_t i = 0; i < length; ++i) {
+			double center = (i + 0.5) * ratio;
+			int64_t first = max<int64_t>(0, static_cast<int64_t>(
+				floor(center - support)));
+			int64_t last = min<int64_t>(sourceLength - 1,
+				static_cast<int64_t>(ceil(center + support)));
+
+			uint32_t count = 0;
+			double sum = 0.0;
+			for (int64_t j = first; j <= last && count < out.Stride; ++j) {
+				double weight = filterWeight(filter, static_cast<double>(j),
+					center, scale);
+				if (count == 0 && weight == 0.0) {
+					++first;
+					continue;
+				}
+
+				weights[count++] = weight;
+				sum += weight;
+			}
+			while (count > 0 && weights[count - 1] == 0.0)
+				--count;
+
+			if (count == 0 || sum == 0.0) {
+				first = min<int64_t>(sourceLength - 1, static_cast<int64_t>(
+					center));
+				weights[0] = 1.0;
+				count = 1;
+				sum = 1.0;
+			}
+
+			out.First[i] = static_cast<uint32_t>(first);
+			out.Count[i] = count;
+			float *row = &out.Weights[static_cast<size_t>(i) * out.Stride];
+			for (uint32_t k = 0; k < count; ++k)
+				row[k] = static_cast<float>(weights[k] / sum);
+		}
+	}
+
+	void ImageScaler::scaleRows(const PixelImage &source,
+		const WeightTable &weights, vector<float> &out) {
+
+		uint32_t width = static_cast<uint32_t>(weights.First.size());
+		out.resize(static_cast<size_t>(source.Height) * width * 4);
+
+		for (uint32_t y = 0; y < source.Height; ++y) {
+			const uint32_t *sourceRow = &source.Pixels[0] +
+				static_cast<size_t>(y) * source.Width;
+			float *row = &out[0] + static_cast<size_t>(y) * width * 4;
+
+			for (uint32_t x = 0; x < width; ++x) {
+				const uint32_t *pixels = sourceRow + weights.First[x];
+				const float *pixelWeights = &weights.Weights[0] +
+					static_cast<size_t>(x) * weights.Stride;
+				uint32_t count = weights.Count[x];
+
+#ifdef INETR_IMAGESCALER_SSE2
+				__m128i zero = _mm_setzero_si128();
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t k = 0; k < count; ++k) {
+					__m128i pixel = _mm_cvtsi32_si128(static_cast<int>(
+						pixels[k]));
+					pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel, zero),
+						zero);
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(pixel),
+						_mm_set1_ps(pixelWeights[k])));
+				}
+				_mm_storeu_ps(row + x * 4, sum);
+#else
+				float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t k = 0; k < count; ++k) {
+					uint32_t pixel = pixels[k];
+					for (int c = 0; c < 4; ++c)
+						sum[c] += static_cast<float>((pixel >> (c * 8)) &
+							0xFF) * pixelWeights[k];
+				}
+				memcpy(row + x * 4, sum, sizeof(sum));
+#endif
+			}
+		}
+	}
+
+	void ImageScaler::scaleColumns(const vector<float> &rows, uint32_t width,
+		const WeightTable &weights, uint32_t *out, uint32_t outStride) {
+
+		uint32_t height = static_cast<uint32_t>(weights.First.size());
+		size_t rowLength = static_cast<size_t>(width) * 4;
+		vector<float> sums(rowLength);
+
+		// Whole rows are accumulated so the intermediate image is read in
+		// order
+		for (uint32_t y = 0; y < height; ++y) {
+			std::fill(sums.begin(), sums.end(), 0.0f);
+
+			for (uint32_t k = 0; k < weights.Count[y]; ++k) {
+				const float *row = &rows[0] + (weights.First[y] + k) *
+					rowLength;
+				float weight = weights.Weights[static_cast<size_t>(y) *
+					weights.Stride + k];
+
+#ifdef INETR_IMAGESCALER_SSE2
+				__m128 weight4 = _mm_set1_ps(weight);
+				for (size_t i = 0; i < rowLength; i += 4)
+					_mm_storeu_ps(&sums[i], _mm_add_ps(_mm_loadu_ps(&sums[i]),
+						_mm_mul_ps(_mm_loadu_ps(row + i), weight4)));
+#else
+				for (size_t i = 0; i < rowLength; ++i)
+					sums[i] += row[i] * weight;
+#endif
+			}
+
+			// Lanczos overshoots, colors are clamped to [0, alpha] so the
+			// pixels stay valid premultiplied values
+			uint32_t *outRow = out + static_cast<size_t>(y) * outStride;
+			for (uint32_t x = 0; x < width; ++x) {
+#ifdef INETR_IMAGESCALER_SSE2
+				__m128i pixel = _mm_cvtps_epi32(_mm_loadu_ps(&sums[x * 4]));
+				pixel = _mm_packs_epi32(pixel, pixel);
+				pixel = _mm_max_epi16(pixel, _mm_setzero_si128());
+				pixel = _mm_min_epi16(pixel, _mm_set1_epi16(255));
+				pixel = _mm_min_epi16(pixel, _mm_shufflelo_epi16(pixel,
+					0xFF));
+				outRow[x] = static_cast<uint32_t>(_mm_cvtsi128_si32(
+					_mm_packus_epi16(pixel, pixel)));
+#else
+				int channels[4];
+				for (int c = 0; c < 4; ++c) {
+					float value = sums[x * 4 + c] + 0.5f;
+					channels[c] = (value <= 0.0f) ? 0 : (value >= 255.0f) ?
+						255 : static_cast<int>(value);
+				}
+
+				uint32_t pixel = static_cast<uint32_t>(channels[3]) << 24;
+				for (int c = 0; c < 3; ++c)
+					pixel |= static_cast<uint32_t>(min(channels[c],
+						channels[3])) << (c * 8);
+				outRow[x] = pixel;
+#endif
+			}
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef INETR_IMAGESCALER_HPP
+#define INETR_IMAGESCALER_HPP
+
+#include <cstdint>
+
+#include <vector>
+
+namespace inetr {
+	// Premultiplied BGRA pixels, rows top to bottom without padding
+	struct PixelImage {
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint32_t> Pixels;
+	};
+
+	enum ScaleFilter { INETR_SF_Area, INETR_SF_Lanczos };
+
+	// Separable resampling of PixelImages. Both filters are turned into
+	// per-pixel weight tables that are applied first along rows and then
+	// along columns, one pixel's four channels at a time where SSE2 is
+	// available.
+	class ImageScaler {
+	public:
+		static void Scale(const PixelImage &source, uint32_t width,
+			uint32_t height, ScaleFilter filter, PixelImage &out);
+		// Scales source to fit a size x size square without changing its
+		// aspect ratio or enlarging it, the rest of the square is transparent
+		static void Letterbox(const PixelImage &source, uint32_t size,
+			ScaleFilter filter, PixelImage &out);
+	private:
+		// Output pixel i is the sum of Weights[i * Stride + k] times source
+		// pixel First[i] + k for k < Count[i]
+		struct WeightTable {
+			std::vector<uint32_t> First;
+			std::vector<uint32_t> Count;
+			std::vector<float> Weights;
+			uint32_t Stride;
+		};
+
+		static const int lanczosLobes = 3;
+
+		static double filterWeight(ScaleFilter filter, double pixel,
+			double center, double scale);
+		static void buildWeights(uint32_t sourceLength, uint32_t length,
+			ScaleFilter filter, WeightTable &out);
+		static void scaleRows(const PixelImage &source,
+			const WeightTable &weights, std::vector<float> &out);
+		static void scaleColumns(const std::vector<float> &rows,
+			uint32_t width, const WeightTable &weights, uint32_t *out,
+			uint32_t outStride);
+	};
+}
+
+#endif  // !INETR_IMAGESCALER_HPP
@@ -1,5 +1,8 @@
 #include "ImageUtil.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 #include <string>
 
 #include <Shlwapi.h>
@@ -11,7 +14,7 @@
 using std::string;
 
 namespace inetr {
-	HBITMAP ImageUtil::LoadImage(string path) {
+	void ImageUtil::LoadPixels(const string &path, PixelImage &out) {
 		size_t pathFileExtDot = path.find_last_of('.');
 		if (pathFileExtDot == string::npos || pathFileExtDot + 1 >=
 			path.length())
@@ -31,49 +34,68 @@ namespace inetr {
 		if (decoderCLSID == nullptr)
 			throw INETRException("[unsupportedImg]: " + ext);
 
-		IStream *pngFileStream;
+		IStream *fileStream = nullptr;
 		if (FAILED(SHCreateStreamOnFile(path.c_str(), STGM_READ,
-			&pngFileStream)))
+			&fileStream)))
 			throw INETRException("[imgLoadFailed]:\n" + path);
 
+		// Every step only runs if the ones before succeeded, whatever was
+		// created is released in one place below
 		IWICBitmapDecoder *bmpDecoder = nullptr;
-		if (FAILED(CoCreateInstance(*decoderCLSID, nullptr,
-			CLSCTX_INPROC_SERVER, __uuidof(bmpDecoder),
-			reinterpret_cast<void**>(&bmpDecoder))))
-			throw INETRException("[imgDecFailed]");
-
-		if (FAILED(bmpDecoder->Initialize(pngFileStream,
-			WICDecodeMetadataCacheOnLoad))) {
+		IWICBitmapFrameDecode *bmpFrame = nullptr;
+		IWICBitmapSource *bmpSource = nullptr;
 
-			bmpDecoder->Release();
-			throw INETRException("[imgDecFailed]");
-		}
+		HRESULT result = CoCreateInstance(*decoderCLSID, nullptr,
+			CLSCTX_INPROC_SERVER, __uuidof(bmpDecoder),
+			reinterpret_cast<void**>(&bmpDecoder));
+		if (SUCCEEDED(result))
+			result = bmpDecoder->Initialize(fileStream,
+				WICDecodeMetadataCacheOnLoad);
 
+		// Animated images show their first frame
 		UINT bmpFrameCount = 0;
-		if (FAILED(bmpDecoder->GetFrameCount(&bmpFrameCount)) && bmpFrameCount
-			!= 1) {
+		if (SUCCEEDED(result))
+			result = bmpDecoder->GetFrameCount(&bmpFrameCount);
+		if (SUCCEEDED(result) && bmpFrameCount == 0)
+			result = E_FAIL;
 
-			bmpDecoder->Release();
-			throw INETRException("[imgDecFailed]");
-		}
+		if (SUCCEEDED(result))
+			result = bmpDecoder->GetFrame(0, &bmpFrame);
+		if (SUCCEEDED(result))
+			result = WICConvertBitmapSource(GUID_WICPixelFormat32bppPBGRA,
+				bmpFrame, &bmpSource);
 
-		IWICBitmapFrameDecode *bmpFrame = nullptr;
-		if (FAILED(bmpDecoder->GetFrame(0, &bmpFrame))) {
-			bmpDecoder->Release();
-			throw INETRException("[imgDecFailed]");
+		UINT width = 0, height = 0;
+		if (SUCCEEDED(result))
+			result = bmpSource->GetSize(&width, &height);
+		if (SUCCEEDED(result) && (width == 0 || height == 0))
+			result = E_FAIL;
+
+		if (SUCCEEDED(result)) {
+			out.Width = width;
+			out.Height = height;
+			out.Pixels.resize(static_cast<size_t>(width) * height);
+
+			const UINT bmpStride = width * 4;
+			const UINT bmpSize = bmpStride * height;
+			result = bmpSource->CopyPixels(nullptr, bmpStride, bmpSize,
+				reinterpret_cast<BYTE*>(&out.Pixels[0]));
 		}
 
-		IWICBitmapSource *bmpSource = nullptr;
-		WICConvertBitmapSource(GUID_WICPixelFormat32bppPBGRA, bmpFrame,
-			&bmpSource);
-
-		bmpFrame->Release();
-		bmpDecoder->Release();
+		if (bmpSource != nullptr)
+			bmpSource->Release();
+		if (bmpFrame != nullptr)
+			bmpFrame->Release();
+		if (bmpDecoder != nullptr)
+			bmpDecoder->Release();
+		fileStream->Release();
 
-		UINT width = 0, height = 0;
-		if (FAILED(bmpSource->GetSize(&width, &height)) || width == 0 || height
-			== 0)
+		if (FAILED(result))
 			throw INETRException("[imgDecFailed]");
+	}
+
+	HBITMAP ImageUtil::CreateBitmap(uint32_t width, uint32_t height,
+		const uint32_t *pixels) {
 
 		BITMAPINFO bmInfo;
 		ZeroMemory(&bmInfo, sizeof(bmInfo));
@@ -84,27 +106,16 @@ namespace inetr {
 		bmInfo.bmiHeader.biBitCount = 32;
 		bmInfo.bmiHeader.biCompression = BI_RGB;
 
-		HBITMAP hbmp = nullptr;
-
 		void *imageBits = nullptr;
 		HDC screenDC = GetDC(nullptr);
-		hbmp = CreateDIBSection(screenDC, &bmInfo, DIB_RGB_COLORS, &imageBits,
-			nullptr, 0);
+		HBITMAP hbmp = CreateDIBSection(screenDC, &bmInfo, DIB_RGB_COLORS,
+			&imageBits, nullptr, 0);
 		ReleaseDC(nullptr, screenDC);
 		if (hbmp == nullptr)
-			throw INETRException("[imgDecFailed]");
-
-		const UINT bmpStride = width * 4;
-		const UINT bmpSize = bmpStride * height;
-		if (FAILED(bmpSource->CopyPixels(nullptr, bmpStride, bmpSize,
-			static_cast<BYTE*>(imageBits)))) {
-
-			DeleteObject(hbmp);
-			hbmp = nullptr;
-			throw INETRException("[imgDecFailed]");
-		}
+			return nullptr;
 
-		bmpSource->Release();
+		memcpy(imageBits, pixels, static_cast<size_t>(width) * height *
+			sizeof(uint32_t));
 
 		return hbmp;
 	}
@@ -1,14 +1,23 @@
 #ifndef INETR_IMAGEUTIL_HPP
 #define INETR_IMAGEUTIL_HPP
 
+#include <cstdint>
+
 #include <string>
 
 #include <Windows.h>
 
+#include "ImageScaler.hpp"
+
 namespace inetr {
 	class ImageUtil {
 	public:
-		static HBITMAP LoadImage(std::string path);
+		// Decodes an image file into premultiplied BGRA pixels
+		static void LoadPixels(const std::string &path, PixelImage &out);
+		// Hands width x height pixels over to GDI as a top-down 32 bit DIB
+		// section
+		static HBITMAP CreateBitmap(uint32_t width, uint32_t height,
+			const uint32_t *pixels);
 	};
 }
 
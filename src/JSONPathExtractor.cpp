@@ -0,0 +1,486 @@
+#include "JSONPathExtractor.hpp"
+
+#include <cctype>
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include "TextCodec.hpp"
+
+using std::string;
+using std::vector;
+
+namespace inetr {
+	JSONPathExtractor::JSONPathExtractor() {
+		Reset();
+	}
+
+	bool JSONPathExtractor::AddPath(const string &path) {
+		string p = path;
+		if (p.empty() || (p[0] != '$' && p[0] != '.' && p[0] != '['))
+			p = "." + p;
+
+		vector<PathSegment> segments;
+
+		size_t pos = (p[0] == '$') ? 1 : 0;
+		while (pos < p.length()) {
+			PathSegment segment;
+			segment.IsIndex = false;
+			segment.Index = 0;
+
+			if (p[pos] == '.') {
+				size_t end = p.find_first_of(".[", ++pos);
+				if (end == string::npos)
+					end = p.length();
+				if (end == pos)
+					return false;
+
+				segment.Key = p.substr(pos, end - pos);
+				pos = end;
+			} else if (p[pos] == '[') {
+				if (++pos >= p.length())
+					return false;
+
+				if (p[pos] == '\'' || p[pos] == '"') {
+					char quote = p[pos];
+					size_t end = p.find(quote, ++pos);
+					if (end == string::npos || end + 1 >= p.length() ||
+						p[end + 1] != ']')
+						return false;
+
+					segment.Key = p.substr(pos, end - pos);
+					pos = end + 2;
+				} else {
+					size_t end = p.find(']', pos);
+					if (end == string::npos || end == pos)
+						return false;
+					for (size_t i = pos; i < end; ++i) {
+						if (!isdigit(static_cast<unsigned char>(p[i])))
+							return false;
+					}
+
+					segment.IsIndex = true;
+					segment.Index = static_cast<size_t>(strtoul(
+						p.c_str() + pos, nullptr, 10));
+					pos = end + 1;
+				}
+			} else {
+				return false;
+			}
+
+			segments.push_back(segment);
+		}
+
+		rootCandidates.push_back(paths.size());
+		paths.push_back(segments);
+		results.push_back(string());
+		found.push_back(0);
+
+		return true;
+	}
+
+	void JSONPathExtractor::Reset() {
+		for (size_t i = 0; i < paths.size(); ++i) {
+			results[i].clear();
+			found[i] = 0;
+		}
+		foundCount = 0;
+
+		state = INETR_JPES_Value;
+		depth = 0;
+		skipDepth = 0;
+
+		buffer.clear();
+		stringIsKey = false;
+		captureValue = false;
+		unicodeValue = 0;
+		highSurrogate = 0;
+		unicodeDigits = 0;
+	}
+
+	bool JSONPathExtractor::Feed(const char *data, size_t length) {
+		if (IsComplete())
+			state = INETR_JPES_Done;
+
+		const char *end = data + length;
+		while (data < end) {
+			if (state == INETR_JPES_Done || state == INETR_JPES_Error)
+				return false;
+
+			char c = *data;
+
+			switch (state) {
+			case INETR_JPES_Value:
+			case INETR_JPES_ValueOrArrayEnd:
+				if (isWhitespace(c))
+					break;
+
+				if (c == ']' && state == INETR_JPES_ValueOrArrayEnd) {
+					endContainer();
+				} else if (c == '{') {
+					beginContainer(false);
+				} else if (c == '[') {
+					beginContainer(true);
+				} else if (c == '"') {
+					stringIsKey = false;
+					captureValue = wantsScalar();
+					buffer.clear();
+					state = INETR_JPES_String;
+				} else if (c == '-' || (c >= '0' && c <= '9') || c == 't' ||
+					c == 'f' || c == 'n') {
+
+					captureValue = wantsScalar();
+					buffer.assign(1, c);
+					state = INETR_JPES_Literal;
+				} else {
+					state = INETR_JPES_Error;
+				}
+				break;
+			case INETR_JPES_KeyOrObjectEnd:
+			case INETR_JPES_Key:
+				if (isWhitespace(c))
+					break;
+
+				if (c == '}' && state == INETR_JPES_KeyOrObjectEnd) {
+					endContainer();
+				} else if (c == '"') {
+					stringIsKey = true;
+					captureValue = true;
+					buffer.clear();
+					state = INETR_JPES_String;
+				} else {
+					state = INETR_JPES_Error;
+				}
+				break;
+			case INETR_JPES_Colon:
+				if (isWhitespace(c))
+					break;
+
+				if (c == ':') {
+					updateChildCandidates();
+					state = INETR_JPES_Value;
+				} else {
+					state = INETR_JPES_Error;
+				}
+				break;
+			case INETR_JPES_CommaOrEnd: {
+				if (isWhitespace(c))
+					break;
+
+				Frame &frame = frames[depth - 1];
+				if (c == ',') {
+					if (frame.IsArray) {
+						++frame.Index;
+						updateChildCandidates();
+						state = INETR_JPES_Value;
+					} else {
+						state = INETR_JPES_Key;
+					}
+				} else if ((c == ']' && frame.IsArray) || (c == '}' &&
+					!frame.IsArray)) {
+
+					endContainer();
+				} else {
+					state = INETR_JPES_Error;
+				}
+				break;
+			}
+			case INETR_JPES_String: {
+				const char *runEnd = data;
+				while (runEnd < end && *runEnd != '"' && *runEnd != '\\')
+					++runEnd;
+
+				if (captureValue && runEnd != data) {
+					flushSurrogate();
+					buffer.append(data, runEnd);
+				}
+
+				data = runEnd;
+				if (data == end)
+					continue;
+
+				if (*data == '"')
+					stringComplete();
+				else
+					state = INETR_JPES_StringEscape;
+				break;
+			}
+			case INETR_JPES_StringEscape:
+				state = INETR_JPES_String;
+
+				switch (c) {
+				case '"':
+				case '\\':
+				case '/':
+					break;
+				case 'b':
+					c = '\b';
+					break;
+				case 'f':
+					c = '\f';
+					break;
+				case 'n':
+					c = '\n';
+					break;
+				case 'r':
+					c = '\r';
+					break;
+				case 't':
+					c = '\t';
+					break;
+				case 'u':
+					unicodeValue = 0;
+					unicodeDigits = 0;
+					state = INETR_JPES_StringUnicode;
+					break;
+				default:
+					state = INETR_JPES_Error;
+				}
+
+				if (state == INETR_JPES_String && captureValue) {
+					flushSurrogate();
+					buffer += c;
+				}
+				break;
+			case INETR_JPES_StringUnicode: {
+				int digit;
+				if (c >= '0' && c <= '9')
+					digit = c - '0';
+				else if (c >= 'a' && c <= 'f')
+					digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					digit = c - 'A' + 10;
+				else {
+					state = INETR_JPES_Error;
+					break;
+				}
+
+				unicodeValue = (unicodeValue << 4) | digit;
+				if (++unicodeDigits < 4)
+					break;
+
+				state = INETR_JPES_String;
+				if (!captureValue)
+					break;
+
+				// A high surrogate waits for its low half, lone surrogates
+				// become U+FFFD like in JSONPullParser
+				if (unicodeValue >= 0xDC00 && unicodeValue <= 0xDFFF &&
+					highSurrogate != 0) {
+
+					TextCodec::AppendUTF8(buffer, 0x10000 + ((highSurrogate -
+						0xD800) << 10) + (unicodeValue - 0xDC00));
+					highSurrogate = 0;
+				} else {
+					flushSurrogate();
+					if (unicodeValue >= 0xD800 && unicodeValue <= 0xDBFF)
+						highSurrogate = unicodeValue;
+					else
+						TextCodec::AppendUTF8(buffer, unicodeValue);
+				}
+				break;
+			}
+			case INETR_JPES_Literal:
+				if (isalnum(static_cast<unsigned char>(c)) || c == '+' ||
+					c == '-' || c == '.') {
+
+					buffer += c;
+					break;
+				}
+
+				literalComplete();
+				continue;
+			case INETR_JPES_Skip:
+			case INETR_JPES_SkipString:
+			case INETR_JPES_SkipStringEscape:
+				data += feedSkip(data, static_cast<size_t>(end - data));
+				continue;
+			default:
+				break;
+			}
+
+			++data;
+		}
+
+		return (state != INETR_JPES_Done && state != INETR_JPES_Error);
+	}
+
+	bool JSONPathExtractor::isWhitespace(char c) {
+		return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+	}
+
+	void JSONPathExtractor::flushSurrogate() {
+		if (highSurrogate == 0)
+			return;
+
+		TextCodec::AppendUTF8(buffer, highSurrogate);
+		highSurrogate = 0;
+	}
+
+	const vector<size_t> &JSONPathExtractor::valueCandidates() const {
+		return (depth == 0) ? rootCandidates : frames[depth -
+			1].ChildCandidates;
+	}
+
+	void JSONPathExtractor::updateChildCandidates() {
+		Frame &frame = frames[depth - 1];
+		size_t level = depth - 1;
+
+		frame.ChildCandidates.clear();
+		for (vector<size_t>::const_iterator it = frame.Candidates.begin();
+			it != frame.Candidates.end(); ++it) {
+
+			if (found[*it])
+				continue;
+
+			const PathSegment &segment = paths[*it][level];
+			if (frame.IsArray ? (segment.IsIndex && segment.Index ==
+				frame.Index) : (!segment.IsIndex && segment.Key == frame.Key))
+				frame.ChildCandidates.push_back(*it);
+		}
+	}
+
+	bool JSONPathExtractor::wantsScalar() const {
+		const vector<size_t> &candidates = valueCandidates();
+		for (vector<size_t>::const_iterator it = candidates.begin();
+			it != candidates.end(); ++it) {
+
+			if (!found[*it] && paths[*it].size() == depth)
+				return true;
+		}
+
+		return false;
+	}
+
+	void JSONPathExtractor::beginContainer(bool isArray) {
+		bool descend = false;
+		const vector<size_t> &parentCandidates = valueCandidates();
+		for (vector<size_t>::const_iterator it = parentCandidates.begin();
+			it != parentCandidates.end(); ++it) {
+
+			if (!found[*it] && paths[*it].size() > depth) {
+				descend = true;
+				break;
+			}
+		}
+
+		if (!descend) {
+			skipDepth = 1;
+			state = INETR_JPES_Skip;
+			return;
+		}
+
+		if (depth == frames.size())
+			frames.push_back(Frame());
+
+		const vector<size_t> &candidates = valueCandidates();
+		Frame &frame = frames[depth];
+
+		frame.IsArray = isArray;
+		frame.Index = 0;
+		frame.Key.clear();
+		frame.Candidates.clear();
+		for (vector<size_t>::const_iterator it = candidates.begin();
+			it != candidates.end(); ++it) {
+
+			if (!found[*it] && paths[*it].size() > depth)
+				frame.Candidates.push_back(*it);
+		}
+
+		++depth;
+
+		if (isArray) {
+			updateChildCandidates();
+			state = INETR_JPES_ValueOrArrayEnd;
+		} else {
+			state = INETR_JPES_KeyOrObjectEnd;
+		}
+	}
+
+	void JSONPathExtractor::endContainer() {
+		--depth;
+		valueComplete();
+	}
+
+	void JSONPathExtractor::valueComplete() {
+		state = (depth == 0) ? INETR_JPES_Done : INETR_JPES_CommaOrEnd;
+	}
+
+	void JSONPathExtractor::scalarComplete(const string &value) {
+		const vector<size_t> &candidates = valueCandidates();
+		for (vector<size_t>::const_iterator it = candidates.begin();
+			it != candidates.end(); ++it) {
+
+			if (found[*it] || paths[*it].size() != depth)
+				continue;
+
+			results[*it] = value;
+			found[*it] = 1;
+			++foundCount;
+		}
+
+		if (IsComplete())
+			state = INETR_JPES_Done;
+		else
+			valueComplete();
+	}
+
+	void JSONPathExtractor::literalComplete() {
+		if (buffer[0] == 't' || buffer[0] == 'f' || buffer[0] == 'n') {
+			if (buffer != "true" && buffer != "false" && buffer != "null") {
+				state = INETR_JPES_Error;
+				return;
+			}
+		}
+
+		if (!captureValue)
+			valueComplete();
+		else if (buffer == "null")
+			scalarComplete(string());
+		else
+			scalarComplete(buffer);
+	}
+
+	void JSONPathExtractor::stringComplete() {
+		flushSurrogate();
+
+		if (stringIsKey) {
+			frames[depth - 1].Key.swap(buffer);
+			state = INETR_JPES_Colon;
+		} else if (captureValue) {
+			scalarComplete(buffer);
+		} else {
+			valueComplete();
+		}
+	}
+
+	size_t JSONPathExtractor::feedSkip(const char *data, size_t length) {
+		const char *ptr = data;
+		const char *end = data + length;
+
+		while (ptr < end) {
+			char c = *ptr++;
+
+			if (state == INETR_JPES_SkipString) {
+				if (c == '\\')
+					state = INETR_JPES_SkipStringEscape;
+				else if (c == '"')
+					state = INETR_JPES_Skip;
+			} else if (state == INETR_JPES_SkipStringEscape) {
+				state = INETR_JPES_SkipString;
+			} else if (c == '"') {
+				state = INETR_JPES_SkipString;
+			} else if (c == '{' || c == '[') {
+				++skipDepth;
+			} else if (c == '}' || c == ']') {
+				if (--skipDepth == 0) {
+					valueComplete();
+					break;
+				}
+			}
+		}
+
+		return static_cast<size_t>(ptr - data);
+	}
+}
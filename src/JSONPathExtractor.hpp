@@ -0,0 +1,92 @@
+#ifndef INETR_JSONPATHEXTRACTOR_HPP
+#define INETR_JSONPATHEXTRACTOR_HPP
+
+#include <string>
+#include <vector>
+
+namespace inetr {
+	enum JSONPathExtractorState { INETR_JPES_Value, INETR_JPES_ValueOrArrayEnd,
+		INETR_JPES_KeyOrObjectEnd, INETR_JPES_Key, INETR_JPES_Colon,
+		INETR_JPES_CommaOrEnd, INETR_JPES_String, INETR_JPES_StringEscape,
+		INETR_JPES_StringUnicode, INETR_JPES_Literal, INETR_JPES_Skip,
+		INETR_JPES_SkipString, INETR_JPES_SkipStringEscape, INETR_JPES_Done,
+		INETR_JPES_Error };
+
+	// Evaluates a set of JSONPath expressions (subset: $, .name, ['name'],
+	// [index]) against a JSON document that is fed in arbitrary chunks.
+	// No document tree is built; subtrees no path can descend into are
+	// skipped by bracket counting and parsing stops as soon as every path
+	// has been resolved.
+	class JSONPathExtractor {
+	public:
+		JSONPathExtractor();
+
+		bool AddPath(const std::string &path);
+
+		// Returns false once no more input is needed, either because all
+		// paths have been resolved or because the document is malformed
+		bool Feed(const char *data, size_t length);
+		void Reset();
+
+		inline bool IsComplete() const { return foundCount == paths.size(); }
+		inline bool HasFailed() const { return state == INETR_JPES_Error; }
+		inline size_t GetPathCount() const { return paths.size(); }
+		inline bool IsFound(size_t path) const { return found[path] != 0; }
+		inline const std::vector<std::string> &GetResults() const {
+			return results;
+		}
+	private:
+		struct PathSegment {
+			bool IsIndex;
+			size_t Index;
+			std::string Key;
+		};
+
+		struct Frame {
+			bool IsArray;
+			size_t Index;
+			std::string Key;
+			std::vector<size_t> Candidates;
+			std::vector<size_t> ChildCandidates;
+		};
+
+		static bool isWhitespace(char c);
+
+		// Emits a high surrogate that found no low half as U+FFFD
+		void flushSurrogate();
+
+		const std::vector<size_t> &valueCandidates() const;
+		void updateChildCandidates();
+		bool wantsScalar() const;
+
+		void beginContainer(bool isArray);
+		void endContainer();
+		void valueComplete();
+		void scalarComplete(const std::string &value);
+		void literalComplete();
+		void stringComplete();
+
+		size_t feedSkip(const char *data, size_t length);
+
+		std::vector<std::vector<PathSegment> > paths;
+		std::vector<size_t> rootCandidates;
+
+		std::vector<std::string> results;
+		std::vector<char> found;
+		size_t foundCount;
+
+		JSONPathExtractorState state;
+		std::vector<Frame> frames;
+		size_t depth;
+		size_t skipDepth;
+
+		std::string buffer;
+		bool stringIsKey;
+		bool captureValue;
+		unsigned long unicodeValue;
+		unsigned long highSurrogate;
+		int unicodeDigits;
+	};
+}
+
+#endif  // !INETR_JSONPATHEXTRACTOR_HPP
@@ -0,0 +1,67 @@
+#include "JSONPathMetaSource.hpp"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ExtractorStreamBuf.hpp"
+#include "HTTP.hpp"
+#include "JSONPathExtractor.hpp"
+#include "StringUtil.hpp"
+
+using std::map;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace inetr {
+	bool JSONPathMetaSource::Get(const map<string, string> &parameters,
+		vector<string> &precedingMetaSources, string &out) const {
+
+		map<string, string>::const_iterator itSIn = parameters.find("sIn"),
+			itSURL = parameters.find("sURL"),
+			itSPath = parameters.find("sPath"),
+			itSOut = parameters.find("sOut");
+
+		if ((itSIn == parameters.end() && itSURL == parameters.end()) ||
+			itSPath == parameters.end() || itSOut == parameters.end())
+			return false;
+
+		JSONPathExtractor extractor;
+
+		StringTokenizer paths(itSPath->second, "|");
+		StringRef path;
+		while (paths.Next(path)) {
+			if (!extractor.AddPath(path.Trim().ToString()))
+				return false;
+		}
+
+		if (itSURL != parameters.end()) {
+			ExtractorStreamBuf<JSONPathExtractor> extractorBuf(extractor);
+			ostream extractorStream(&extractorBuf);
+
+			try {
+				HTTP::Get(itSURL->second, &extractorStream);
+			} catch(...) {
+				if (!extractor.IsComplete())
+					return false;
+			}
+		} else {
+			string in;
+			if (!StringUtil::DetokenizeVectorToPattern(precedingMetaSources,
+				itSIn->second, in))
+				return false;
+
+			extractor.Feed(in.data(), in.size());
+		}
+
+		if (!extractor.IsComplete() && extractor.HasFailed())
+			return false;
+
+		vector<string> lRes(extractor.GetResults());
+
+		return StringUtil::DetokenizeVectorToPattern(lRes, itSOut->second,
+			out);
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef INETR_JSONPATHMETASOURCE_HPP
+#define INETR_JSONPATHMETASOURCE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MetaSourcePrototype.hpp"
+
+namespace inetr {
+	class JSONPathMetaSource : public MetaSourcePrototype {
+	public:
+		JSONPathMetaSource() : MetaSourcePrototype("json") { }
+		~JSONPathMetaSource() { }
+
+		bool Get(const std::map<std::string, std::string> &parameters,
+			std::vector<std::string> &precedingMetaSources, std::string &out)
+			const;
+	};
+}
+
+#endif  // !INETR_JSONPATHMETASOURCE_HPP
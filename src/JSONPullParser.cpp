@@ -0,0 +1,340 @@
+#include "JSONPullParser.hpp"
+
+#include <cctype>
+#include <cstring>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TextCodec.hpp"
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace inetr {
+	JSONPullParser::JSONPullParser(const char *data, size_t length) {
+		this->data = data;
+		this->length = length;
+		pos = 0;
+		state = INETR_JPPS_Value;
+	}
+
+	JSONPullToken JSONPullParser::Next() {
+		for (;;) {
+			skipWhitespace();
+
+			if (state == INETR_JPPS_Error)
+				return INETR_JPT_Error;
+
+			if (state == INETR_JPPS_Done)
+				return (pos == length) ? INETR_JPT_End :
+					fail("Unexpected data after document");
+
+			if (pos == length)
+				return fail("Unexpected end of document");
+
+			char c = data[pos];
+
+			switch (state) {
+			case INETR_JPPS_CommaOrEnd:
+				if (c == ',') {
+					state = (containers.back() == '{') ? INETR_JPPS_Key :
+						INETR_JPPS_Value;
+					++pos;
+					continue;
+				}
+				return endContainer(c);
+			case INETR_JPPS_Colon:
+				if (c != ':')
+					return fail("Expected ':'");
+				state = INETR_JPPS_Value;
+				++pos;
+				continue;
+			case INETR_JPPS_KeyOrEnd:
+				if (c == '}')
+					return endContainer(c);
+				// Fall through
+			case INETR_JPPS_Key:
+				if (c != '"')
+					return fail("Expected object key");
+				if (!parseString())
+					return INETR_JPT_Error;
+				state = INETR_JPPS_Colon;
+				return INETR_JPT_Key;
+			case INETR_JPPS_ValueOrEnd:
+				if (c == ']')
+					return endContainer(c);
+				// Fall through
+			default:
+				break;
+			}
+
+			switch (c) {
+			case '{':
+				++pos;
+				containers.push_back('{');
+				state = INETR_JPPS_KeyOrEnd;
+				return INETR_JPT_ObjectBegin;
+			case '[':
+				++pos;
+				containers.push_back('[');
+				state = INETR_JPPS_ValueOrEnd;
+				return INETR_JPT_ArrayBegin;
+			case '"':
+				if (!parseString())
+					return INETR_JPT_Error;
+				valueDone();
+				return INETR_JPT_String;
+			case 't':
+				if (!parseLiteral("true"))
+					return INETR_JPT_Error;
+				valueDone();
+				return INETR_JPT_True;
+			case 'f':
+				if (!parseLiteral("false"))
+					return INETR_JPT_Error;
+				valueDone();
+				return INETR_JPT_False;
+			case 'n':
+				if (!parseLiteral("null"))
+					return INETR_JPT_Error;
+				valueDone();
+				return INETR_JPT_Null;
+			default:
+				if (!parseNumber())
+					return INETR_JPT_Error;
+				valueDone();
+				return INETR_JPT_Number;
+			}
+		}
+	}
+
+	bool JSONPullParser::Skip(JSONPullToken token) {
+		if (token == INETR_JPT_Error)
+			return false;
+		if (token != INETR_JPT_ObjectBegin && token != INETR_JPT_ArrayBegin)
+			return true;
+
+		size_t depth = containers.size();
+		while (containers.size() >= depth) {
+			if (Next() == INETR_JPT_Error)
+				return false;
+		}
+
+		return true;
+	}
+
+	void JSONPullParser::skipWhitespace() {
+		while (pos < length) {
+			char c = data[pos];
+
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+				++pos;
+			} else if (c == '/' && pos + 1 < length && data[pos + 1] == '/') {
+				while (pos < length && data[pos] != '\n')
+					++pos;
+			} else if (c == '/' && pos + 1 < length && data[pos + 1] == '*') {
+				const char *close = nullptr;
+				for (size_t i = pos + 2; i + 1 < length; ++i) {
+					if (data[i] == '*' && data[i + 1] == '/') {
+						close = data + i;
+						break;
+					}
+				}
+				if (close == nullptr) {
+					fail("Unterminated comment");
+					return;
+				}
+				pos = (close - data) + 2;
+			} else {
+				break;
+			}
+		}
+	}
+
+	bool JSONPullParser::parseString() {
+		text.clear();
+		++pos;
+
+		for (;;) {
+			size_t begin = pos;
+			while (pos < length && data[pos] != '"' && data[pos] != '\\')
+				++pos;
+			text.append(data + begin, pos - begin);
+
+			if (pos == length) {
+				fail("Unterminated string");
+				return false;
+			}
+
+			if (data[pos++] == '"')
+				return true;
+
+			if (pos == length) {
+				fail("Unterminated string");
+				return false;
+			}
+
+			char escaped = data[pos++];
+			switch (escaped) {
+			case '"': text += '"'; break;
+			case '\\': text += '\\'; break;
+			case '/': text += '/'; break;
+			case 'b': text += '\b'; break;
+			case 'f': text += '\f'; break;
+			case 'n': text += '\n'; break;
+			case 'r': text += '\r'; break;
+			case 't': text += '\t'; break;
+			case 'u': {
+				unsigned long codePoint = 0;
+				for (int i = 0; i < 4; ++i, ++pos) {
+					char c = (pos < length) ? data[pos] : '\0';
+					int digit;
+					if (c >= '0' && c <= '9')
+						digit = c - '0';
+					else if (c >= 'a' && c <= 'f')
+						digit = c - 'a' + 10;
+					else if (c >= 'A' && c <= 'F')
+						digit = c - 'A' + 10;
+					else {
+						fail("Invalid unicode escape");
+						return false;
+					}
+					codePoint = (codePoint << 4) | digit;
+				}
+
+				// Combine a surrogate pair into one code point
+				if (codePoint >= 0xD800 && codePoint <= 0xDBFF &&
+					pos + 6 <= length && data[pos] == '\\' &&
+					data[pos + 1] == 'u') {
+
+					unsigned long low = 0;
+					bool valid = true;
+					for (int i = 2; i < 6 && valid; ++i) {
+						char c = data[pos + i];
+						int digit = (c >= '0' && c <= '9') ? c - '0' :
+							(c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+							(c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+						valid = digit >= 0;
+						low = (low << 4) | digit;
+					}
+
+					if (valid && low >= 0xDC00 && low <= 0xDFFF) {
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) +
+							(low - 0xDC00);
+						pos += 6;
+					}
+				}
+
+				// Lone surrogates become U+FFFD
+				TextCodec::AppendUTF8(text, codePoint);
+				break;
+			}
+			default:
+				fail("Invalid escape sequence");
+				return false;
+			}
+		}
+	}
+
+	bool JSONPullParser::parseNumber() {
+		// -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+		size_t begin = pos;
+		if (pos < length && data[pos] == '-')
+			++pos;
+
+		if (pos < length && data[pos] == '0') {
+			++pos;
+		} else if (!skipDigits()) {
+			fail((pos == begin) ? "Unexpected character" : "Invalid number");
+			return false;
+		}
+
+		if (pos < length && data[pos] == '.') {
+			++pos;
+			if (!skipDigits()) {
+				fail("Invalid number");
+				return false;
+			}
+		}
+
+		if (pos < length && (data[pos] == 'e' || data[pos] == 'E')) {
+			++pos;
+			if (pos < length && (data[pos] == '+' || data[pos] == '-'))
+				++pos;
+			if (!skipDigits()) {
+				fail("Invalid number");
+				return false;
+			}
+		}
+
+		// Catches leading zeros and stray signs or dots
+		if (pos < length && (isdigit(static_cast<unsigned char>(data[pos]))
+			|| (data[pos] != '\0' && strchr("+-.eE", data[pos]) != nullptr))) {
+
+			fail("Invalid number");
+			return false;
+		}
+
+		text.assign(data + begin, pos - begin);
+		return true;
+	}
+
+	bool JSONPullParser::skipDigits() {
+		size_t begin = pos;
+		while (pos < length && isdigit(static_cast<unsigned char>(data[pos])))
+			++pos;
+
+		return pos > begin;
+	}
+
+	bool JSONPullParser::parseLiteral(const char *literal) {
+		size_t literalLength = strlen(literal);
+		if (length - pos < literalLength || memcmp(data + pos, literal,
+			literalLength) != 0) {
+
+			fail("Unexpected character");
+			return false;
+		}
+
+		pos += literalLength;
+		return true;
+	}
+
+	JSONPullToken JSONPullParser::endContainer(char close) {
+		char open = containers.back();
+		if ((open == '{' && close != '}') || (open == '[' && close != ']'))
+			return fail((open == '{') ? "Expected ',' or '}'" :
+				"Expected ',' or ']'");
+
+		++pos;
+		containers.pop_back();
+		valueDone();
+
+		return (close == '}') ? INETR_JPT_ObjectEnd : INETR_JPT_ArrayEnd;
+	}
+
+	JSONPullToken JSONPullParser::fail(const char *message) {
+		if (state != INETR_JPPS_Error) {
+			size_t line = 1;
+			for (size_t i = 0; i < pos && i < length; ++i) {
+				if (data[i] == '\n')
+					++line;
+			}
+
+			stringstream ssError;
+			ssError << "Line " << line << ": " << message;
+			error = ssError.str();
+
+			state = INETR_JPPS_Error;
+		}
+
+		return INETR_JPT_Error;
+	}
+
+	void JSONPullParser::valueDone() {
+		state = containers.empty() ? INETR_JPPS_Done : INETR_JPPS_CommaOrEnd;
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef INETR_JSONPULLPARSER_HPP
+#define INETR_JSONPULLPARSER_HPP
+
+#include <string>
+#include <vector>
+
+namespace inetr {
+	enum JSONPullToken { INETR_JPT_ObjectBegin, INETR_JPT_ObjectEnd,
+		INETR_JPT_ArrayBegin, INETR_JPT_ArrayEnd, INETR_JPT_Key,
+		INETR_JPT_String, INETR_JPT_Number, INETR_JPT_True, INETR_JPT_False,
+		INETR_JPT_Null, INETR_JPT_End, INETR_JPT_Error };
+
+	enum JSONPullParserState { INETR_JPPS_Value, INETR_JPPS_ValueOrEnd,
+		INETR_JPPS_Key, INETR_JPPS_KeyOrEnd, INETR_JPPS_Colon,
+		INETR_JPPS_CommaOrEnd, INETR_JPPS_Done, INETR_JPPS_Error };
+
+	// Validating pull parser that returns one token at a time from a JSON
+	// document in memory, so that callers can build their own records
+	// directly instead of going through a DOM. Comments are skipped like
+	// whitespace.
+	class JSONPullParser {
+	public:
+		JSONPullParser(const char *data, size_t length);
+
+		JSONPullToken Next();
+		// Skips the rest of the value that token started
+		bool Skip(JSONPullToken token);
+
+		// Decoded text of the last key, string or number
+		inline const std::string &GetString() const { return text; }
+		inline const std::string &GetError() const { return error; }
+		inline size_t GetOffset() const { return pos; }
+	private:
+		void skipWhitespace();
+		bool parseString();
+		bool parseNumber();
+		// Returns false if there was no digit
+		bool skipDigits();
+		bool parseLiteral(const char *literal);
+		JSONPullToken endContainer(char close);
+		JSONPullToken fail(const char *message);
+		void valueDone();
+
+		const char *data;
+		size_t length;
+		size_t pos;
+
+		JSONPullParserState state;
+		std::vector<char> containers;
+
+		std::string text;
+		std::string error;
+	};
+}
+
+#endif  // !INETR_JSONPULLPARSER_HPP
@@ -1,23 +1,21 @@
 #include "Languages.hpp"
 
-#include <algorithm>
 #include <fstream>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
-#include <vector>
 
 #include <json/json.h>
 
 #include "INETRException.hpp"
 
-using std::find_if;
 using std::ifstream;
 using std::ios;
 using std::map;
 using std::pair;
 using std::string;
-using std::vector;
+using std::unordered_map;
 using Json::Reader;
 using Json::Value;
 using Json::nullValue;
@@ -42,10 +40,12 @@ namespace inetr {
 
 		languageFile.close();
 
-		for (size_t i = 0; i < (size_t)rootValue.size(); ++i) {
-			string lngIdentifer = rootValue.getMemberNames().at(i);
+		for (Value::const_iterator lngIt = rootValue.begin();
+			lngIt != rootValue.end(); ++lngIt) {
 
-			Value lngValue = rootValue.get(lngIdentifer, Value(nullValue));
+			string lngIdentifer = lngIt.key().asString();
+
+			const Value &lngValue = *lngIt;
 			if (!lngValue.isObject()) {
 				MessageBox(nullptr, ("Unable to load language: " +
 					lngIdentifer).c_str(), "Error", MB_OK | MB_ICONERROR);
@@ -70,11 +70,12 @@ namespace inetr {
 
 			map<string, string> lngStrings;
 
-			for (size_t j = 0; j < (size_t)lngStringsValue.size(); ++j) {
-				string strKey = lngStringsValue.getMemberNames().at(j);
+			for (Value::const_iterator strIt = lngStringsValue.begin();
+				strIt != lngStringsValue.end(); ++strIt) {
+
+				string strKey = strIt.key().asString();
 
-				Value strValueValue = lngStringsValue.get(strKey,
-					Value(nullValue));
+				const Value &strValueValue = *strIt;
 				if (!strValueValue.isString()) {
 					MessageBox(nullptr, ("Unable to load language: " +
 						lngIdentifer + "\nCouldn't load string: "
@@ -87,6 +88,8 @@ namespace inetr {
 					strValueValue.asString()));
 			}
 
+			languageIndex.insert(pair<string, size_t>(lngIdentifer,
+				languages.size()));
 			languages.push_back(Language(lngIdentifer, lngNameValue.asString(),
 				std::move(lngStrings)));
 		}
@@ -100,25 +103,15 @@ namespace inetr {
 	}
 
 	bool Languages::IsLanguageLoaded(const string &identifier) const {
-		for (vector<Language>::const_iterator it = languages.begin();
-			it != languages.end(); ++it) {
-
-			if (it->Identifier == identifier)
-				return true;
-		}
-
-		return false;
+		return languageIndex.find(identifier) != languageIndex.end();
 	}
 
 	const Language &Languages::operator[](const string &identifier) const {
-		vector<Language>::const_iterator it = find_if(languages.begin(),
-			languages.end(), [&identifier](const Language &elem) {
-
-			return elem.Identifier == identifier;
-		});
+		unordered_map<string, size_t>::const_iterator it =
+			languageIndex.find(identifier);
 
-		if (it != languages.end())
-			return *it;
+		if (it != languageIndex.end())
+			return languages[it->second];
 
 		throw INETRException(string("Unknown Language: ") + identifier);
 	}
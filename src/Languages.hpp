@@ -2,6 +2,7 @@
 #define INETR_LANGUAGES_HPP
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Language.hpp"
@@ -29,6 +30,7 @@ namespace inetr {
 		static Language None;
 	private:
 		std::vector<Language> languages;
+		std::unordered_map<std::string, size_t> languageIndex;
 	};
 }
 
@@ -0,0 +1,389 @@
+#include "MD5.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+	defined(__SSE2__)
+#define INETR_MD5_SSE2
+#include <emmintrin.h>
+#endif
+
+using std::string;
+
+// The 64 steps of an MD5 block, shared by the single and the multi-buffer
+// transform: STEP(function, a, b, c, d, message word, constant, rotation)
+#define INETR_MD5_ROUNDS(STEP) \
+	STEP(F, a, b, c, d,  0, 0xd76aa478,  7) \
+	STEP(F, d, a, b, c,  1, 0xe8c7b756, 12) \
+	STEP(F, c, d, a, b,  2, 0x242070db, 17) \
+	STEP(F, b, c, d, a,  3, 0xc1bdceee, 22) \
+	STEP(F, a, b, c, d,  4, 0xf57c0faf,  7) \
+	STEP(F, d, a, b, c,  5, 0x4787c62a, 12) \
+	STEP(F, c, d, a, b,  6, 0xa8304613, 17) \
+	STEP(F, b, c, d, a,  7, 0xfd469501, 22) \
+	STEP(F, a, b, c, d,  8, 0x698098d8,  7) \
+	STEP(F, d, a, b, c,  9, 0x8b44f7af, 12) \
+	STEP(F, c, d, a, b, 10, 0xffff5bb1, 17) \
+	STEP(F, b, c, d, a, 11, 0x895cd7be, 22) \
+	STEP(F, a, b, c, d, 12, 0x6b901122,  7) \
+	STEP(F, d, a, b, c, 13, 0xfd987193, 12) \
+	STEP(F, c, d, a, b, 14, 0xa679438e, 17) \
+	STEP(F, b, c, d, a, 15, 0x49b40821, 22) \
+	STEP(G, a, b, c, d,  1, 0xf61e2562,  5) \
+	STEP(G, d, a, b, c,  6, 0xc040b340,  9) \
+	STEP(G, c, d, a, b, 11, 0x265e5a51, 14) \
+	STEP(G, b, c, d, a,  0, 0xe9b6c7aa, 20) \
+	STEP(G, a, b, c, d,  5, 0xd62f105d,  5) \
+	STEP(G, d, a, b, c, 10, 0x02441453,  9) \
+	STEP(G, c, d, a, b, 15, 0xd8a1e681, 14) \
+	STEP(G, b, c, d, a,  4, 0xe7d3fbc8, 20) \
+	STEP(G, a, b, c, d,  9, 0x21e1cde6,  5) \
+	STEP(G, d, a, b, c, 14, 0xc33707d6,  9) \
+	STEP(G, c, d, a, b,  3, 0xf4d50d87, 14) \
+	STEP(G, b, c, d, a,  8, 0x455a14ed, 20) \
+	STEP(G, a, b, c, d, 13, 0xa9e3e905,  5) \
+	STEP(G, d, a, b, c,  2, 0xfcefa3f8,  9) \
+	STEP(G, c, d, a, b,  7, 0x676f02d9, 14) \
+	STEP(G, b, c, d, a, 12, 0x8d2a4c8a, 20) \
+	STEP(H, a, b, c, d,  5, 0xfffa3942,  4) \
+	STEP(H, d, a, b, c,  8, 0x8771f681, 11) \
+	STEP(H, c, d, a, b, 11, 0x6d9d6122, 16) \
+	STEP(H, b, c, d, a, 14, 0xfde5380c, 23) \
+	STEP(H, a, b, c, d,  1, 0xa4beea44,  4) \
+	STEP(H, d, a, b, c,  4, 0x4bdecfa9, 11) \
+	STEP(H, c, d, a, b,  7, 0xf6bb4b60, 16) \
+	STEP(H, b, c, d, a, 10, 0xbebfbc70, 23) \
+	STEP(H, a, b, c, d, 13, 0x289b7ec6,  4) \
+	STEP(H, d, a, b, c,  0, 0xeaa127fa, 11) \
+	STEP(H, c, d, a, b,  3, 0xd4ef3085, 16) \
+	STEP(H, b, c, d, a,  6, 0x04881d05, 23) \
+	STEP(H, a, b, c, d,  9, 0xd9d4d039,  4) \
+	STEP(H, d, a, b, c, 12, 0xe6db99e5, 11) \
+	STEP(H, c, d, a, b, 15, 0x1fa27cf8, 16) \
+	STEP(H, b, c, d, a,  2, 0xc4ac5665, 23) \
+	STEP(I, a, b, c, d,  0, 0xf4292244,  6) \
+	STEP(I, d, a, b, c,  7, 0x432aff97, 10) \
+	STEP(I, c, d, a, b, 14, 0xab9423a7, 15) \
+	STEP(I, b, c, d, a,  5, 0xfc93a039, 21) \
+	STEP(I, a, b, c, d, 12, 0x655b59c3,  6) \
+	STEP(I, d, a, b, c,  3, 0x8f0ccc92, 10) \
+	STEP(I, c, d, a, b, 10, 0xffeff47d, 15) \
+	STEP(I, b, c, d, a,  1, 0x85845dd1, 21) \
+	STEP(I, a, b, c, d,  8, 0x6fa87e4f,  6) \
+	STEP(I, d, a, b, c, 15, 0xfe2ce6e0, 10) \
+	STEP(I, c, d, a, b,  6, 0xa3014314, 15) \
+	STEP(I, b, c, d, a, 13, 0x4e0811a1, 21) \
+	STEP(I, a, b, c, d,  4, 0xf7537e82,  6) \
+	STEP(I, d, a, b, c, 11, 0xbd3af235, 10) \
+	STEP(I, c, d, a, b,  2, 0x2ad7d2bb, 15) \
+	STEP(I, b, c, d, a,  9, 0xeb86d391, 21)
+#define INETR_MD5_F(x, y, z) ((((y) ^ (z)) & (x)) ^ (z))
+#define INETR_MD5_G(x, y, z) ((((x) ^ (y)) & (z)) ^ (y))
+#define INETR_MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define INETR_MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+#define INETR_MD5_STEP(f, a, b, c, d, k, t, s) \
+	a += INETR_MD5_##f(b, c, d) + x[k] + t; \
+	a = ((a << s) | (a >> (32 - s))) + b;
+
+#ifdef INETR_MD5_SSE2
+#define INETR_MD5_F4(x, y, z) \
+	_mm_xor_si128(_mm_and_si128(_mm_xor_si128(y, z), x), z)
+#define INETR_MD5_G4(x, y, z) \
+	_mm_xor_si128(_mm_and_si128(_mm_xor_si128(x, y), z), y)
+#define INETR_MD5_H4(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define INETR_MD5_I4(x, y, z) \
+	_mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, ones)))
+
+#define INETR_MD5_STEP4(f, a, b, c, d, k, t, s) \
+	a = _mm_add_epi32(_mm_add_epi32(a, INETR_MD5_##f##4(b, c, d)), \
+		_mm_add_epi32(x[k], _mm_set1_epi32(static_cast<int>(t)))); \
+	a = _mm_add_epi32(_mm_or_si128(_mm_slli_epi32(a, s), \
+		_mm_srli_epi32(a, 32 - s)), b);
+#endif
+
+namespace inetr {
+	namespace {
+#ifdef INETR_MD5_SSE2
+		// Runs count blocks of four messages at once, lane i reads its
+		// blocks from blocks[i] onwards in steps of strides[i]
+		void transformLanes(uint32_t *const *states,
+			const unsigned char *const *blocks, const size_t *strides,
+			size_t count) {
+
+			__m128i a = _mm_set_epi32(states[3][0], states[2][0],
+				states[1][0], states[0][0]);
+			__m128i b = _mm_set_epi32(states[3][1], states[2][1],
+				states[1][1], states[0][1]);
+			__m128i c = _mm_set_epi32(states[3][2], states[2][2],
+				states[1][2], states[0][2]);
+			__m128i d = _mm_set_epi32(states[3][3], states[2][3],
+				states[1][3], states[0][3]);
+			const __m128i ones = _mm_set1_epi32(-1);
+
+			for (size_t block = 0; block < count; ++block) {
+				// Transposes the four blocks so x[k] holds word k of every
+				// lane
+				__m128i x[16];
+				for (int group = 0; group < 4; ++group) {
+					__m128i row0 = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(blocks[0] + block *
+						strides[0]) + group);
+					__m128i row1 = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(blocks[1] + block *
+						strides[1]) + group);
+					__m128i row2 = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(blocks[2] + block *
+						strides[2]) + group);
+					__m128i row3 = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(blocks[3] + block *
+						strides[3]) + group);
+
+					__m128i low01 = _mm_unpacklo_epi32(row0, row1);
+					__m128i high01 = _mm_unpackhi_epi32(row0, row1);
+					__m128i low23 = _mm_unpacklo_epi32(row2, row3);
+					__m128i high23 = _mm_unpackhi_epi32(row2, row3);
+					x[group * 4] = _mm_unpacklo_epi64(low01, low23);
+					x[group * 4 + 1] = _mm_unpackhi_epi64(low01, low23);
+					x[group * 4 + 2] = _mm_unpacklo_epi64(high01, high23);
+					x[group * 4 + 3] = _mm_unpackhi_epi64(high01, high23);
+				}
+
+				__m128i oldA = a, oldB = b, oldC = c, oldD = d;
+				INETR_MD5_ROUNDS(INETR_MD5_STEP4)
+				a = _mm_add_epi32(a, oldA);
+				b = _mm_add_epi32(b, oldB);
+				c = _mm_add_epi32(c, oldC);
+				d = _mm_add_epi32(d, oldD);
+			}
+
+			uint32_t words[4][4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(words[0]), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(words[1]), b);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(words[2]), c);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(words[3]), d);
+			for (int lane = 0; lane < 4; ++lane)
+				for (int word = 0; word < 4; ++word)
+					states[lane][word] = words[word][lane];
+		}
+#endif
+
+		void writeDigest(const uint32_t state[4], unsigned char *digest) {
+			for (int i = 0; i < 16; ++i)
+				digest[i] = static_cast<unsigned char>(state[i / 4] >>
+					((i % 4) * 8));
+		}
+	}
+
+	const uint32_t MD5::initialState[4] = { 0x67452301, 0xefcdab89,
+		0x98badcfe, 0x10325476 };
+
+	MD5::MD5() {
+		memcpy(state, initialState, sizeof(state));
+		length = 0;
+		buffered = 0;
+	}
+
+	void MD5::Update(const void *data, size_t length) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		this->length += length;
+
+		if (buffered > 0) {
+			size_t taken = (length < 64 - buffered) ? length : 64 - buffered;
+			memcpy(buffer + buffered, bytes, taken);
+			buffered += taken;
+			bytes += taken;
+			length -= taken;
+
+			if (buffered < 64)
+				return;
+			transform(state, buffer, 1);
+			buffered = 0;
+		}
+
+		transform(state, bytes, length / 64);
+		bytes += length / 64 * 64;
+		length %= 64;
+
+		if (length > 0)
+			memcpy(buffer, bytes, length);
+		buffered = length;
+	}
+
+	void MD5::Final(unsigned char digest[DigestSize]) {
+		unsigned char tail[128];
+		size_t blocks = pad(buffer, buffered, length, tail);
+		transform(state, tail, blocks);
+
+		writeDigest(state, digest);
+	}
+
+	void MD5::HashMany(const unsigned char *const *data,
+		const size_t *lengths, size_t count, unsigned char *digests) {
+
+#ifdef INETR_MD5_SSE2
+		struct Lane {
+			size_t Message;
+			const unsigned char *Blocks;
+			size_t BlockCount;
+			unsigned char Tail[128];
+			size_t TailBlocks;
+			uint32_t State[4];
+		};
+
+		const size_t idle = static_cast<size_t>(-1);
+		size_t next = 0;
+
+		// A lane takes the next message once its current one is done, the
+		// whole blocks are read in place and only the padded end is copied
+		auto start = [&](Lane &lane) {
+			if (next >= count) {
+				lane.Message = idle;
+				return;
+			}
+
+			lane.Message = next++;
+			memcpy(lane.State, initialState, sizeof(lane.State));
+
+			size_t messageLength = lengths[lane.Message];
+			lane.Blocks = data[lane.Message];
+			lane.BlockCount = messageLength / 64;
+			lane.TailBlocks = pad(lane.Blocks + lane.BlockCount * 64,
+				messageLength % 64, messageLength, lane.Tail);
+			if (lane.BlockCount == 0) {
+				lane.Blocks = lane.Tail;
+				lane.BlockCount = lane.TailBlocks;
+				lane.TailBlocks = 0;
+			}
+		};
+
+		Lane lanes[Lanes];
+		for (size_t i = 0; i < Lanes; ++i)
+			start(lanes[i]);
+
+		unsigned char idleBlock[64];
+		memset(idleBlock, 0, sizeof(idleBlock));
+		uint32_t idleState[4];
+
+		for (;;) {
+			size_t active = 0, run = 0;
+			Lane *last = nullptr;
+			for (size_t i = 0; i < Lanes; ++i) {
+				if (lanes[i].Message == idle)
+					continue;
+
+				if (active == 0 || lanes[i].BlockCount < run)
+					run = lanes[i].BlockCount;
+				++active;
+				last = &lanes[i];
+			}
+
+			if (active == 0)
+				break;
+
+			// A single message is no faster in a vector than on its own
+			if (active == 1 && next >= count) {
+				transform(last->State, last->Blocks, last->BlockCount);
+				transform(last->State, last->Tail, last->TailBlocks);
+				writeDigest(last->State, digests + last->Message *
+					DigestSize);
+				break;
+			}
+
+			uint32_t *states[Lanes];
+			const unsigned char *blocks[Lanes];
+			size_t strides[Lanes];
+			for (size_t i = 0; i < Lanes; ++i) {
+				bool working = lanes[i].Message != idle;
+				states[i] = working ? lanes[i].State : idleState;
+				blocks[i] = working ? lanes[i].Blocks : idleBlock;
+				strides[i] = working ? 64 : 0;
+			}
+
+			transformLanes(states, blocks, strides, run);
+
+			for (size_t i = 0; i < Lanes; ++i) {
+				Lane &lane = lanes[i];
+				if (lane.Message == idle)
+					continue;
+
+				lane.Blocks += run * 64;
+				lane.BlockCount -= run;
+				if (lane.BlockCount > 0)
+					continue;
+
+				if (lane.TailBlocks > 0) {
+					lane.Blocks = lane.Tail;
+					lane.BlockCount = lane.TailBlocks;
+					lane.TailBlocks = 0;
+				} else {
+					writeDigest(lane.State, digests + lane.Message *
+						DigestSize);
+					start(lane);
+				}
+			}
+		}
+#else
+		for (size_t i = 0; i < count; ++i) {
+			MD5 hash;
+			hash.Update(data[i], lengths[i]);
+			hash.Final(digests + i * DigestSize);
+		}
+#endif
+	}
+
+	string MD5::ToHex(const unsigned char digest[DigestSize]) {
+		const char hexDigits[] = "0123456789abcdef";
+
+		string hex(DigestSize * 2, '0');
+		for (size_t i = 0; i < DigestSize; ++i) {
+			hex[i * 2] = hexDigits[digest[i] >> 4];
+			hex[i * 2 + 1] = hexDigits[digest[i] & 0x0F];
+		}
+
+		return hex;
+	}
+
+	void MD5::transform(uint32_t state[4], const unsigned char *blocks,
+		size_t count) {
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+		for (size_t block = 0; block < count; ++block) {
+			uint32_t x[16];
+			memcpy(x, blocks + block * 64, sizeof(x));
+
+			uint32_t oldA = a, oldB = b, oldC = c, oldD = d;
+			INETR_MD5_ROUNDS(INETR_MD5_STEP)
+			a += oldA;
+			b += oldB;
+			c += oldC;
+			d += oldD;
+		}
+
+		state[0] = a;
+		state[1] = b;
+		state[2] = c;
+		state[3] = d;
+	}
+
+	size_t MD5::pad(const unsigned char *rest, size_t restLength,
+		uint64_t length, unsigned char *tail) {
+
+		memset(tail, 0, 128);
+		if (restLength > 0)
+			memcpy(tail, rest, restLength);
+		tail[restLength] = 0x80;
+
+		size_t blocks = (restLength < 56) ? 1 : 2;
+		uint64_t bits = length * 8;
+		for (int i = 0; i < 8; ++i)
+			tail[blocks * 64 - 8 + i] = static_cast<unsigned char>(bits >>
+				(i * 8));
+
+		return blocks;
+	}
+}
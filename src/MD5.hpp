@@ -0,0 +1,47 @@
+#ifndef INETR_MD5_HPP
+#define INETR_MD5_HPP
+
+#include <cstdint>
+
+#include <string>
+
+namespace inetr {
+	// Portable MD5 (RFC 1321). Besides the usual incremental interface,
+	// HashMany runs independent buffers side by side in the lanes of SSE2
+	// registers where SSE2 is available, which makes up for MD5 being a
+	// single serial chain per message.
+	class MD5 {
+	public:
+		static const size_t DigestSize = 16;
+		// Buffers HashMany works on at once
+		static const size_t Lanes = 4;
+
+		MD5();
+
+		void Update(const void *data, size_t length);
+		// The hash can't be updated afterwards
+		void Final(unsigned char digest[DigestSize]);
+
+		// digests needs room for count * DigestSize bytes
+		static void HashMany(const unsigned char *const *data,
+			const size_t *lengths, size_t count, unsigned char *digests);
+
+		static std::string ToHex(const unsigned char digest[DigestSize]);
+	private:
+		static const uint32_t initialState[4];
+
+		static void transform(uint32_t state[4], const unsigned char *blocks,
+			size_t count);
+		// Pads the last partial block of a message of the given length into
+		// tail, which needs room for two blocks; returns the block count
+		static size_t pad(const unsigned char *rest, size_t restLength,
+			uint64_t length, unsigned char *tail);
+
+		uint32_t state[4];
+		uint64_t length;
+		unsigned char buffer[64];
+		size_t buffered;
+	};
+}
+
+#endif  // !INETR_MD5_HPP
@@ -1,8 +1,11 @@
 #include "MainWindow.hpp"
 
 #include <cstdint>
+#include <cstring>
+#include <ctime>
 
 #include <algorithm>
+#include <list>
 #include <map>
 #include <sstream>
 #include <string>
@@ -23,10 +26,13 @@
 #include "MUtil.hpp"
 #include "OSUtil.hpp"
 #include "StringUtil.hpp"
+#include "TextCodec.hpp"
 
 using std::for_each;
+using std::list;
 using std::map;
 using std::pair;
+using std::sort;
 using std::string;
 using std::stringstream;
 using std::vector;
@@ -41,8 +47,15 @@ namespace inetr {
 
 		initialized = false;
 
+		startupTime = GetTickCount();
+		stationsFresh = false;
+		refreshThread = nullptr;
+		pendingRefresh = nullptr;
+
 		isColorblindModeEnabled = false;
 
+		InitializeCriticalSection(&updateMetaLock);
+
 		currentStation = nullptr;
 		currentStream = 0;
 
@@ -60,6 +73,10 @@ namespace inetr {
 		taskbarBtnCreatedMsg = RegisterWindowMessage("TaskbarButtonCreated");
 	}
 
+	MainWindow::~MainWindow() {
+		DeleteCriticalSection(&updateMetaLock);
+	}
+
 	int MainWindow::Main(string commandLine, HINSTANCE instance, int showCmd) {
 		MainWindow::instance = instance;
 
@@ -68,20 +85,21 @@ namespace inetr {
 
 		bool performUpdateCheck = true;
 
-		vector<string> cmdLineArgs = StringUtil::Explode(commandLine, " ");
-		for_each(cmdLineArgs.begin(), cmdLineArgs.end(), [&](const string &a) {
-			if (a == "-noupdate") {
+		StringTokenizer cmdLineArgs(commandLine, " ");
+		StringRef arg;
+		while (cmdLineArgs.Next(arg)) {
+			if (arg == "-noupdate") {
 				performUpdateCheck = false;
-			} else if (a == "-cb") {
+			} else if (arg == "-cb") {
 				isColorblindModeEnabled = true;
 			}
-		});
+		}
 
 		CoInitialize(nullptr);
 
 		INITCOMMONCONTROLSEX iCCE;
 		iCCE.dwSize = sizeof(INITCOMMONCONTROLSEX);
-		iCCE.dwICC = ICC_PROGRESS_CLASS;
+		iCCE.dwICC = ICC_PROGRESS_CLASS | ICC_BAR_CLASSES;
 		InitCommonControlsEx(&iCCE);
 
 		if (performUpdateCheck)
@@ -100,6 +118,11 @@ namespace inetr {
 
 		initialized = true;
 
+		reportStartupTime("Interactive");
+
+		if (!stationsFresh)
+			refreshStations();
+
 		MSG msg;
 		while (GetMessage(&msg, nullptr, 0, 0) > 0) {
 			TranslateMessage(&msg);
@@ -180,6 +203,28 @@ namespace inetr {
 
 		SendMessage(statusLbl, WM_SETFONT, (WPARAM)defaultFont, (LPARAM)0);
 
+		// The label doesn't take mouse input, so the tool is a rectangle of
+		// the main window that moves along with it
+		historyTip = CreateWindowEx(WS_EX_TOPMOST, TOOLTIPS_CLASS, nullptr,
+			WS_POPUP | TTS_NOPREFIX | TTS_ALWAYSTIP, CW_USEDEFAULT,
+			CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, hwnd, nullptr,
+			instance, nullptr);
+
+		if (historyTip == nullptr)
+			throw INETRException("[ctlCreFailed]: historyTip");
+
+		TOOLINFO historyTool;
+		memset(&historyTool, 0, sizeof(historyTool));
+		historyTool.cbSize = TTTOOLINFO_V1_SIZE;
+		historyTool.uFlags = TTF_SUBCLASS;
+		historyTool.hwnd = hwnd;
+		historyTool.uId = statusLblId;
+		historyTool.rect = controlPositions["statusLbl"];
+		historyTool.lpszText = LPSTR_TEXTCALLBACK;
+		SendMessage(historyTip, TTM_ADDTOOL, (WPARAM)0,
+			(LPARAM)&historyTool);
+		SendMessage(historyTip, TTM_SETMAXTIPWIDTH, (WPARAM)0, (LPARAM)400);
+
 		stationImg = CreateWindow("STATIC", "", WS_CHILD |
 			SS_BITMAP,
 			controlPositions["stationImg"].left,
@@ -192,8 +237,21 @@ namespace inetr {
 		if (stationImg == nullptr)
 			throw INETRException("[ctlCreFailed]: stationImg");
 
+		searchEd = CreateWindowEx(WS_EX_CLIENTEDGE, "EDIT", "", WS_CHILD |
+			ES_AUTOHSCROLL | WS_TABSTOP,
+			controlPositions["searchEd"].left,
+			controlPositions["searchEd"].top,
+			RWIDTH(controlPositions["searchEd"]),
+			RHEIGHT(controlPositions["searchEd"]),
+			hwnd, (HMENU)searchEdId, instance, nullptr);
+
+		if (searchEd == nullptr)
+			throw INETRException("[ctlCreFailed]: searchEd");
+
+		SendMessage(searchEd, WM_SETFONT, (WPARAM)defaultFont, (LPARAM)0);
+
 		allStationsLbox = CreateWindowEx(WS_EX_CLIENTEDGE, "LISTBOX", "",
-			WS_CHILD | LBS_STANDARD | LBS_SORT | WS_VSCROLL | WS_TABSTOP,
+			WS_CHILD | WS_BORDER | LBS_NOTIFY | WS_VSCROLL | WS_TABSTOP,
 			controlPositions["allStationsLbox"].left,
 			controlPositions["allStationsLbox"].top,
 			RWIDTH(controlPositions["allStationsLbox"]),
@@ -322,21 +380,114 @@ namespace inetr {
 	}
 
 	void MainWindow::initialize() {
-		if (!stations.Load())
-			return;
+		// Start with the catalog on disk and refresh it once the window is
+		// up, only the very first start has to wait for the server
+		if (!stations.Load()) {
+			list<Station> fresh;
+			if (!stations.Refresh(fresh))
+				return;
+
+			stations.Merge(fresh);
+			stationsFresh = true;
+		}
+
+		indexStations();
 
 		userConfig.Load();
+
+		metadataHistory.Load();
+
+		nowPlayingMonitor.SetStations(userConfig.FavoriteStations);
+		nowPlayingMonitor.Start();
 	}
 
 	void MainWindow::uninitialize() {
+		// The refresh uses the stations, it has to end before they go away
+		if (refreshThread != nullptr) {
+			stations.Cancel();
+			WaitForSingleObject(refreshThread, INFINITE);
+			CloseHandle(refreshThread);
+			refreshThread = nullptr;
+		}
+
+		// A refresh that was posted but never handled
+		delete pendingRefresh;
+		pendingRefresh = nullptr;
+
+		nowPlayingMonitor.Stop();
+
+		metadataHistory.Save();
 		userConfig.Save();
 	}
 
+	void MainWindow::refreshStations() {
+		refreshThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0,
+			staticRefreshStationsThread, reinterpret_cast<void*>(this), 0,
+			nullptr));
+	}
+
+	void MainWindow::refreshStationsThread() {
+		StationsRefresh *refresh = new StationsRefresh();
+		if (!stations.Refresh(refresh->Fresh, false, &refresh->ChangedFiles)
+			&& refresh->ChangedFiles.empty()) {
+
+			delete refresh;
+			reportStartupTime("Catalog unchanged");
+			return;
+		}
+
+		// The stations belong to the UI thread, they are merged there. The
+		// refresh is handed over through a member rather than the message,
+		// messages still queued when the window goes away are lost.
+		pendingRefresh = refresh;
+		PostMessage(window, stationsRefreshedMsg, (WPARAM)0, (LPARAM)0);
+	}
+
+	void MainWindow::stationsRefreshed() {
+		StationsRefresh *refresh = pendingRefresh;
+		pendingRefresh = nullptr;
+		if (refresh == nullptr)
+			return;
+
+		// The monitor and the metadata thread keep running, they work on
+		// copies of the stations they poll
+		stations.Merge(refresh->Fresh);
+
+		// Only stations whose name changed are reindexed, the list shows the
+		// refreshed stations for whatever is typed into the search box
+		indexStations();
+		searchEdit_Change();
+		populateFavoriteStationsListbox();
+
+		// Only images whose files the synchronization replaced are decoded
+		// again
+		stationImages.Invalidate(refresh->ChangedFiles);
+		delete refresh;
+
+		if (currentStation != nullptr)
+			SendMessage(stationImg, STM_SETIMAGE, IMAGE_BITMAP,
+				(LPARAM)stationImages.Get(currentStation));
+		prefetchStationImages();
+
+		stationsFresh = true;
+		reportStartupTime("Catalog refreshed");
+	}
+
+	void MainWindow::reportStartupTime(const char *milestone) {
+		stringstream ssMessage;
+		ssMessage << milestone << " " << (GetTickCount() - startupTime) <<
+			" ms after start\n";
+		OutputDebugString(ssMessage.str().c_str());
+	}
+
 	void MainWindow::initializeWindow(HWND hwnd) {
 		populateFavoriteStationsListbox();
 		populateAllStationsListbox();
 		populateLanguageComboBox();
 
+		// The lists have to be filled to know which stations are shown
+		prefetchStationImages();
+
 		updateControlLanguageStrings();
 
 		BASS_Init(-1, 44100, 0, hwnd, nullptr);
@@ -355,6 +506,7 @@ namespace inetr {
 		const int sLboxWidth = 100;
 		const int sImgDim = 200;
 		const int lngCboxHeight = 20;
+		const int searchEdHeight = 20;
 		const int noStaInfoLblHeight = 40;
 		const int sLineLblHeight = 15;
 		const int updateBtnWidth = 80;
@@ -397,9 +549,15 @@ namespace inetr {
 		allStationsLboxRect.left = 10;
 		allStationsLboxRect.right = allStationsLboxRect.left +
 			(leftPanelSlideProgress - 10);
-		allStationsLboxRect.top = 10;
+		allStationsLboxRect.top = 10 + searchEdHeight + 5;
 		allStationsLboxRect.bottom = languageCboxRect.top - 5;
 
+		RECT searchEdRect;
+		searchEdRect.left = 10;
+		searchEdRect.right = searchEdRect.left + (leftPanelSlideProgress - 10);
+		searchEdRect.top = 10;
+		searchEdRect.bottom = searchEdRect.top + searchEdHeight;
+
 		RECT noStationsInfoLblRect;
 		noStationsInfoLblRect.left = stationLboxRect.right + 10;
 		noStationsInfoLblRect.right = clientArea.right - 10;
@@ -455,6 +613,8 @@ namespace inetr {
 			statusLblRect));
 		controlPositions.insert(pair<string, RECT>("stationImg",
 			stationImgRect));
+		controlPositions.insert(pair<string, RECT>("searchEd",
+			searchEdRect));
 		controlPositions.insert(pair<string, RECT>("allStationsLbox",
 			allStationsLboxRect));
 		controlPositions.insert(pair<string, RECT>("languageCbox",
@@ -533,8 +693,10 @@ namespace inetr {
 		for_each(userConfig.FavoriteStations.begin(),
 			userConfig.FavoriteStations.end(), [&](const Station* &elem) {
 
-			SendMessage(stationsLbox, LB_ADDSTRING, (WPARAM)0,
-				(LPARAM)elem->Name.c_str());
+			LRESULT i = SendMessage(stationsLbox, LB_ADDSTRING, (WPARAM)0,
+				(LPARAM)elem->GetName().Data());
+			SendMessage(stationsLbox, LB_SETITEMDATA, (WPARAM)i,
+				(LPARAM)elem);
 		});
 
 		if (userConfig.FavoriteStations.empty())
@@ -544,9 +706,75 @@ namespace inetr {
 	}
 
 	void MainWindow::populateAllStationsListbox() {
+		// The list box doesn't sort so that search results keep their rank,
+		// the whole catalog is shown by name
+		vector<const Station*> sorted;
 		for_each(stations.begin(), stations.end(), [&](const Station &elem) {
-			SendMessage(allStationsLbox, LB_ADDSTRING, (WPARAM)0,
-				(LPARAM)elem.Name.c_str());
+			sorted.push_back(&elem);
+		});
+		sort(sorted.begin(), sorted.end(), [](const Station *a,
+			const Station *b) {
+
+			return lstrcmpi(a->GetName().Data(), b->GetName().Data()) < 0;
+		});
+
+		for (vector<const Station*>::const_iterator it = sorted.begin();
+			it != sorted.end(); ++it) {
+
+			LRESULT i = SendMessage(allStationsLbox, LB_ADDSTRING, (WPARAM)0,
+				(LPARAM)(*it)->GetName().Data());
+			SendMessage(allStationsLbox, LB_SETITEMDATA, (WPARAM)i,
+				(LPARAM)*it);
+		}
+	}
+
+	const Station *MainWindow::selectedStation(HWND listBox) const {
+		// Every item carries its station, names need not be unique
+		LRESULT index = SendMessage(listBox, LB_GETCURSEL, (WPARAM)0,
+			(LPARAM)0);
+		if (index == LB_ERR)
+			return nullptr;
+
+		LRESULT data = SendMessage(listBox, LB_GETITEMDATA, (WPARAM)index,
+			(LPARAM)0);
+		if (data == LB_ERR)
+			return nullptr;
+
+		return reinterpret_cast<const Station*>(data);
+	}
+
+	void MainWindow::prefetchStationImages() {
+		// Favorites are the ones most likely to be shown, then whatever the
+		// station list currently shows
+		list<const Station*> wanted;
+		if (currentStation != nullptr)
+			wanted.push_back(currentStation);
+		wanted.insert(wanted.end(), userConfig.FavoriteStations.begin(),
+			userConfig.FavoriteStations.end());
+
+		LRESULT count = SendMessage(allStationsLbox, LB_GETCOUNT, (WPARAM)0,
+			(LPARAM)0);
+		LRESULT top = SendMessage(allStationsLbox, LB_GETTOPINDEX, (WPARAM)0,
+			(LPARAM)0);
+		LRESULT itemHeight = SendMessage(allStationsLbox, LB_GETITEMHEIGHT,
+			(WPARAM)0, (LPARAM)0);
+		RECT lboxRect = controlPositions["allStationsLbox"];
+		if (count > 0 && top >= 0 && itemHeight > 0) {
+			LRESULT end = top + RHEIGHT(lboxRect) / itemHeight + 1;
+			for (LRESULT i = top; i < end && i < count; ++i) {
+				LRESULT data = SendMessage(allStationsLbox, LB_GETITEMDATA,
+					(WPARAM)i, (LPARAM)0);
+				if (data != LB_ERR && data != 0)
+					wanted.push_back(reinterpret_cast<const Station*>(data));
+			}
+		}
+
+		stationImages.Prefetch(wanted);
+	}
+
+	void MainWindow::indexStations() {
+		for_each(stations.begin(), stations.end(), [&](const Station &elem) {
+			stationSearchIndex.Update(&elem);
 		});
 	}
 
@@ -580,60 +808,49 @@ namespace inetr {
 	}
 
 	void MainWindow::updateMetaThread() {
-		static CRITICAL_SECTION mutex;
-		static bool mutexInitialized = false;
-		if (!mutexInitialized) {
-			InitializeCriticalSection(&mutex);
-			mutexInitialized = true;
-		}
-
 		map<string, string> metaAdParam;
 
 		metaAdParam.insert(pair<string, string>("rStream",
 			StringUtil::PointerToString(reinterpret_cast<void*>(
 			&currentStream))));
 
-		vector<string> metaSrcOut;
-		bool failed = false;
-		EnterCriticalSection(&mutex);
-		for_each(currentStation->MetaSources.begin(),
-			currentStation->MetaSources.end(),
-			[&metaSrcOut, &metaAdParam, &failed](const MetaSource &elem) {
-
-			if (failed)
-				return;
+		// A refresh may update the station meanwhile, the copy keeps the
+		// record it was taken with
+		Station station(*currentStation);
+
+		string meta;
+		EnterCriticalSection(&updateMetaLock);
+		if (station.FetchMeta(meta, metaAdParam)) {
+			meta = TextCodec::ToUTF8(meta);
+			metadataHistory.Add(station.GetIdentifier().ToString(), meta,
+				static_cast<uint32_t>(time(nullptr)));
+		} else {
+			meta = "ERROR";
+		}
+		LeaveCriticalSection(&updateMetaLock);
 
-			string cMetaSrcOut;
-			if (elem.Get(metaSrcOut, cMetaSrcOut, metaAdParam)) {
-				metaSrcOut.push_back(cMetaSrcOut);
-			} else {
-				failed = true;
-			}
-		});
-		LeaveCriticalSection(&mutex);
-
-		string meta = failed ? string("ERROR") :
-			StringUtil::DetokenizeVectorToPattern(metaSrcOut,
-			currentStation->MetaOut);
-
-		meta = StringUtil::Trim(meta);
-		StringUtil::SearchAndReplace(meta, "\t", "");
-
-		const char* metaStr = meta.c_str();
-		int length = MultiByteToWideChar(CP_UTF8, 0, metaStr,
-			static_cast<int>(strlen(metaStr)), nullptr, 0);
-		wchar_t *wide = new wchar_t[size_t(length + 1)];
-		MultiByteToWideChar(CP_UTF8, 0, metaStr, -1, wide, length + 1);
-		char *ansi = new char[size_t(length + 1)];
-		WideCharToMultiByte(CP_ACP, 0, wide, -1, ansi, length + 1, nullptr, 0);
-		delete[] wide;
-		meta = string(ansi);
-		delete[] ansi;
-
-		radioStatus_currentMetadata = meta;
+		radioStatus_currentMetadata = toDisplayText(meta);
 		updateStatusLabel();
 	}
 
+	string MainWindow::toDisplayText(const string &utf8) {
+		// ASCII is the same in every ANSI code page
+		if (TextCodec::IsASCII(utf8.c_str(), utf8.length()))
+			return utf8;
+
+		vector<wchar_t> wide(utf8.length() + 1);
+		int wideLength = static_cast<int>(TextCodec::UTF8ToUTF16(
+			utf8.c_str(), utf8.length(), &wide[0]));
+
+		int ansiLength = WideCharToMultiByte(CP_ACP, 0, &wide[0],
+			wideLength, nullptr, 0, nullptr, nullptr);
+		vector<char> ansi(size_t(ansiLength + 1));
+		WideCharToMultiByte(CP_ACP, 0, &wide[0], wideLength, &ansi[0],
+			ansiLength, nullptr, nullptr);
+
+		return string(&ansi[0], size_t(ansiLength));
+	}
+
 	void MainWindow::updateStatusLabel() {
 		string statusText = "";
 
@@ -673,7 +890,7 @@ namespace inetr {
 		statusText =
 			userConfig.CurrentLanguage.LocalizeStringTokens(statusText);
 
-		StringUtil::SearchAndReplace(statusText, string("&"), string("&&"));
+		labelEscaper.Replace(statusText);
 		SetWindowText(statusLbl, statusText.c_str());
 
 		if (radioStatus == INTER_RS_Connected && radioStatus_currentMetadata
@@ -773,6 +990,13 @@ namespace inetr {
 					break;
 				}
 				break;
+			case searchEdId:
+				switch (HIWORD(wParam)) {
+				case EN_CHANGE:
+					searchEdit_Change();
+					break;
+				}
+				break;
 			case languageCboxId:
 				switch (HIWORD(wParam)) {
 				case CBN_SELCHANGE:
@@ -811,6 +1035,11 @@ namespace inetr {
 			}
 			initializeWindow(hwnd);
 			break;
+		case WM_NOTIFY:
+			if (reinterpret_cast<NMHDR*>(lParam)->hwndFrom == historyTip &&
+				reinterpret_cast<NMHDR*>(lParam)->code == TTN_GETDISPINFO)
+				historyTip_GetDispInfo(reinterpret_cast<NMHDR*>(lParam));
+			break;
 		case WM_CTLCOLORSTATIC:
 			return (INT_PTR)GetStockObject(WHITE_BRUSH);
 			break;
@@ -835,6 +1064,9 @@ namespace inetr {
 		case WM_DESTROY:
 			PostQuitMessage(0);
 			break;
+		case stationsRefreshedMsg:
+			stationsRefreshed();
+			break;
 		}
 
 		if (uMsg == taskbarBtnCreatedMsg) {
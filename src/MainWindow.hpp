@@ -3,16 +3,23 @@
 
 #include <cstdint>
 
+#include <list>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <Windows.h>
 
 #include <bass.h>
 
 #include "Languages.hpp"
+#include "MetadataHistory.hpp"
+#include "NowPlayingMonitor.hpp"
 #include "Station.hpp"
+#include "StationImageCache.hpp"
+#include "StationSearchIndex.hpp"
 #include "Stations.hpp"
+#include "StringReplacer.hpp"
 #include "Updater.hpp"
 #include "UserConfig.hpp"
 
@@ -26,10 +33,17 @@ namespace inetr {
 	class MainWindow {
 	public:
 		MainWindow();
+		~MainWindow();
 
 		int Main(std::string commandLine, HINSTANCE instance, int showCmd);
 
 	private:
+		// Handed from the refresh thread to the UI thread
+		struct StationsRefresh {
+			std::list<Station> Fresh;
+			std::vector<std::string> ChangedFiles;
+		};
+
 		static LRESULT CALLBACK staticWndProc(HWND hwnd, UINT uMsg, WPARAM
 			wParam, LPARAM lParam);
 
@@ -44,6 +58,9 @@ namespace inetr {
 
 		static void __cdecl staticDownloadUpdatesThread(void *param);
 
+		static unsigned int __stdcall staticRefreshStationsThread(
+			void *param);
+
 		static void CALLBACK staticMetaSync(HSYNC handle, DWORD channel,
 			DWORD data, void *user);
 
@@ -61,6 +78,10 @@ namespace inetr {
 
 		void initialize();
 		void uninitialize();
+		void refreshStations();
+		void refreshStationsThread();
+		void stationsRefreshed();
+		void reportStartupTime(const char *milestone);
 		void initializeWindow(HWND hwnd);
 		void uninitializeWindow(HWND hwnd);
 
@@ -70,6 +91,9 @@ namespace inetr {
 
 		void populateFavoriteStationsListbox();
 		void populateAllStationsListbox();
+		const Station *selectedStation(HWND listBox) const;
+		void indexStations();
+		void prefetchStationImages();
 		void populateLanguageComboBox();
 
 		void expandLeftPanel();
@@ -88,11 +112,13 @@ namespace inetr {
 		void stationsListBox_SelChange();
 		void stationsListBox_DblClick();
 		void moreStationsListBox_DblClick();
+		void searchEdit_Change();
 		void languageComboBox_SelChange();
 		void updateButton_Click();
 		void dontUpdateButton_Click();
 
 		void mouseScroll(int16_t delta);
+		void historyTip_GetDispInfo(NMHDR *header);
 
 
 		void radioOpenURL(std::string url);
@@ -105,10 +131,15 @@ namespace inetr {
 
 		void updateMeta();
 		void updateMetaThread();
+		// Converts UTF-8 metadata to the ANSI code page the controls use
+		static std::string toDisplayText(const std::string &utf8);
 
 
 		static const char* const windowClassName;
 
+		static const char* const labelEscapes[][2];
+		static const StringReplacer labelEscaper;
+
 		static const int windowWidth = 350;
 		static const int windowHeight = 292;
 
@@ -124,9 +155,15 @@ namespace inetr {
 		static const int updatingLblId = 110;
 		static const int volumePbarId = 111;
 		static const int updateInfoEdId = 112;
+		static const int searchEdId = 113;
 
 		static const int thumbBarMuteBtnId = 201;
 
+		static const size_t maxSearchResults = 500;
+		static const size_t historyTipEntries = 10;
+
+		static const UINT stationsRefreshedMsg = WM_APP + 1;
+
 		static const int bufferTimerId = 1;
 		static const int slideTimerId = 2;
 		static const int metaTimerId = 3;
@@ -145,6 +182,13 @@ namespace inetr {
 
 		bool initialized;
 
+		DWORD startupTime;
+		bool stationsFresh;
+		HANDLE refreshThread;
+		// Written by the refresh thread before it posts
+		// stationsRefreshedMsg, taken by the UI thread
+		StationsRefresh *pendingRefresh;
+
 		bool isColorblindModeEnabled;
 
 		HINSTANCE instance;
@@ -153,6 +197,7 @@ namespace inetr {
 		HWND statusLbl;
 		HWND stationImg;
 		HWND noStationsInfoLbl;
+		HWND searchEd;
 		HWND allStationsLbox;
 		HWND languageCbox;
 		HWND updateInfoLbl;
@@ -161,6 +206,7 @@ namespace inetr {
 		HWND volumePbar;
 		HWND updateInfoEd;
 		HWND updatingLbl;
+		HWND historyTip;
 
 		UINT taskbarBtnCreatedMsg;
 
@@ -178,13 +224,24 @@ namespace inetr {
 		Languages languages;
 
 		Stations stations;
+		StationSearchIndex stationSearchIndex;
+		StationImageCache stationImages;
 
 		UserConfig userConfig;
 
+		NowPlayingMonitor nowPlayingMonitor;
+
+		MetadataHistory metadataHistory;
+
 		RadioStatus radioStatus;
 		std::string radioStatus_currentMetadata;
 		QWORD radioStatus_bufferingProgress;
 
+		// Backs the history tooltip's text until it asks again
+		std::string historyTipText;
+
+		CRITICAL_SECTION updateMetaLock;
+
 		const Station* currentStation;
 		std::string currentStreamURL;
 		HSTREAM currentStream;
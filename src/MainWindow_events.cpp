@@ -1,12 +1,15 @@
 #include "MainWindow.hpp"
 
 #include <cstdint>
+#include <cstring>
+#include <ctime>
 
 #include <algorithm>
 #include <list>
 #include <string>
 #include <vector>
 
+#include <CommCtrl.h>
 #include <ShObjIdl.h>
 #include <Windows.h>
 
@@ -140,6 +143,15 @@ namespace inetr {
 		SetWindowPos(statusLbl, nullptr, controlPositions["statusLbl"].left,
 			controlPositions["statusLbl"].top, 0, 0, SWP_NOSIZE);
 
+		TOOLINFO historyTool;
+		memset(&historyTool, 0, sizeof(historyTool));
+		historyTool.cbSize = TTTOOLINFO_V1_SIZE;
+		historyTool.hwnd = window;
+		historyTool.uId = statusLblId;
+		historyTool.rect = controlPositions["statusLbl"];
+		SendMessage(historyTip, TTM_NEWTOOLRECT, (WPARAM)0,
+			(LPARAM)&historyTool);
+
 		SetWindowPos(stationImg, nullptr, controlPositions["stationImg"].left,
 			controlPositions["stationImg"].top, 0, 0, SWP_NOSIZE);
 
@@ -166,12 +178,18 @@ namespace inetr {
 			controlPositions["updatingLbl"].top, 0, 0, SWP_NOSIZE);
 
 		if (RWIDTH(controlPositions["allStationsLbox"]) <= 0) {
+			ShowWindow(searchEd, SW_HIDE);
 			ShowWindow(allStationsLbox, SW_HIDE);
 			ShowWindow(languageCbox, SW_HIDE);
 		} else {
+			ShowWindow(searchEd, SW_SHOW);
 			ShowWindow(allStationsLbox, SW_SHOW);
 			ShowWindow(languageCbox, SW_SHOW);
 
+			SetWindowPos(searchEd, nullptr, 0, 0,
+				RWIDTH(controlPositions["searchEd"]),
+				RHEIGHT(controlPositions["searchEd"]),
+				SWP_NOMOVE);
 			SetWindowPos(allStationsLbox, nullptr, 0, 0,
 				RWIDTH(controlPositions["allStationsLbox"]),
 				RHEIGHT(controlPositions["allStationsLbox"]),
@@ -219,50 +237,33 @@ namespace inetr {
 		if (leftPanelSlideStatus != INETR_WSS_Retracted)
 			return;
 
-		LRESULT index = SendMessage(stationsLbox, LB_GETCURSEL, (WPARAM)0,
-			(LPARAM)0);
-		LRESULT textLength = SendMessage(stationsLbox, LB_GETTEXTLEN,
-			(WPARAM)index, (LPARAM)0);
-		char* cText = new char[size_t(textLength + 1)];
-		SendMessage(stationsLbox, LB_GETTEXT, (WPARAM)index, (LPARAM)cText);
-		string text(cText);
-		delete[] cText;
-
-		list<Station>::const_iterator it = find_if(stations.begin(),
-			stations.end(), [&text](const Station &elem) {
-
-			return elem.Name == text;
-		});
+		const Station *station = selectedStation(stationsLbox);
+		if (station == nullptr)
+			return;
 
-		if (it == stations.end() || &*it == currentStation) {
+		if (station == currentStation) {
 			if (radioStatus == INETR_RS_ConnectionError)
-				radioOpenURL(it->StreamURL);
+				radioOpenURL(station->GetStreamURL().ToString());
 			return;
 		}
 
-		currentStation = &*it;
+		currentStation = station;
 		ShowWindow(stationImg, SW_SHOW);
 		SendMessage(stationImg, STM_SETIMAGE, IMAGE_BITMAP,
-			(LPARAM)currentStation->Image);
-		radioOpenURL(it->StreamURL);
+			(LPARAM)stationImages.Get(currentStation));
+		radioOpenURL(station->GetStreamURL().ToString());
 	}
 
 	void MainWindow::stationsListBox_DblClick() {
 		if (leftPanelSlideStatus != INETR_WSS_Expanded)
 			return;
 
-		LRESULT index = SendMessage(stationsLbox, LB_GETCURSEL, (WPARAM)0,
-			(LPARAM)0);
-		LRESULT textLength = SendMessage(stationsLbox, LB_GETTEXTLEN,
-			(WPARAM)index, (LPARAM)0);
-		char* cText = new char[size_t(textLength + 1)];
-		SendMessage(stationsLbox, LB_GETTEXT, (WPARAM)index, (LPARAM)cText);
-		string text(cText);
-		delete[] cText;
+		const Station *station = selectedStation(stationsLbox);
+		if (station == nullptr)
+			return;
 
-		userConfig.FavoriteStations.remove_if([&text](const Station* &elem) {
-			return elem->Name == text;
-		});
+		userConfig.FavoriteStations.remove(station);
+		nowPlayingMonitor.SetStations(userConfig.FavoriteStations);
 
 		populateFavoriteStationsListbox();
 	}
@@ -271,30 +272,46 @@ namespace inetr {
 		if (leftPanelSlideStatus != INETR_WSS_Expanded)
 			return;
 
-		LRESULT index = SendMessage(allStationsLbox, LB_GETCURSEL, (WPARAM)0,
-			(LPARAM)0);
-		LRESULT textLength = SendMessage(allStationsLbox, LB_GETTEXTLEN,
-			(WPARAM)index, (LPARAM)0);
+		const Station *station = selectedStation(allStationsLbox);
+		if (station != nullptr && find(userConfig.FavoriteStations.begin(),
+			userConfig.FavoriteStations.end(), station) ==
+			userConfig.FavoriteStations.end()) {
+
+			userConfig.FavoriteStations.push_back(station);
+			nowPlayingMonitor.Add(station);
+		}
+
+		populateFavoriteStationsListbox();
+	}
+
+	void MainWindow::searchEdit_Change() {
+		int textLength = GetWindowTextLength(searchEd);
 		char* cText = new char[size_t(textLength + 1)];
-		SendMessage(allStationsLbox, LB_GETTEXT, (WPARAM)index,
-			(LPARAM)cText);
+		GetWindowText(searchEd, cText, textLength + 1);
 		string text(cText);
 		delete[] cText;
 
-		list<Station>::const_iterator it = find_if(stations.begin(),
-			stations.end(), [&text](const Station &elem) {
+		SendMessage(allStationsLbox, WM_SETREDRAW, (WPARAM)FALSE, (LPARAM)0);
+		SendMessage(allStationsLbox, LB_RESETCONTENT, (WPARAM)0, (LPARAM)0);
 
-			return elem.Name == text;
-		});
+		if (text.empty()) {
+			populateAllStationsListbox();
+		} else {
+			vector<const Station*> matches;
+			stationSearchIndex.Search(text, maxSearchResults, matches);
 
-		if (it != stations.end() && find(userConfig.FavoriteStations.begin(),
-			userConfig.FavoriteStations.end(), &*it) ==
-			userConfig.FavoriteStations.end()) {
+			for (vector<const Station*>::const_iterator it = matches.begin();
+				it != matches.end(); ++it) {
 
-			userConfig.FavoriteStations.push_back(&*it);
+				LRESULT i = SendMessage(allStationsLbox, LB_ADDSTRING,
+					(WPARAM)0, (LPARAM)(*it)->GetName().Data());
+				SendMessage(allStationsLbox, LB_SETITEMDATA, (WPARAM)i,
+					(LPARAM)*it);
+			}
 		}
 
-		populateFavoriteStationsListbox();
+		SendMessage(allStationsLbox, WM_SETREDRAW, (WPARAM)TRUE, (LPARAM)0);
+		InvalidateRect(allStationsLbox, nullptr, TRUE);
 	}
 
 	void MainWindow::languageComboBox_SelChange() {
@@ -354,6 +371,7 @@ namespace inetr {
 		EnableWindow(stationsLbox, FALSE);
 		EnableWindow(stationImg, FALSE);
 		EnableWindow(statusLbl, FALSE);
+		EnableWindow(searchEd, FALSE);
 		EnableWindow(allStationsLbox, FALSE);
 		EnableWindow(languageCbox, FALSE);
 		EnableWindow(updateInfoLbl, FALSE);
@@ -390,4 +408,37 @@ namespace inetr {
 			nVolume);
 		radioSetVolume(nVolume);
 	}
+
+	void MainWindow::historyTip_GetDispInfo(NMHDR *header) {
+		NMTTDISPINFO *dispInfo = reinterpret_cast<NMTTDISPINFO*>(header);
+
+		// Lists what the current station played recently, newest first. An
+		// empty text keeps the tooltip hidden.
+		historyTipText = "";
+
+		vector<HistoryEntry> recent;
+		if (currentStation != nullptr && radioStatus == INTER_RS_Connected)
+			metadataHistory.GetRecent(currentStation->GetIdentifier()
+				.ToString(), historyTipEntries, recent);
+
+		for (vector<HistoryEntry>::const_iterator it = recent.begin();
+			it != recent.end(); ++it) {
+
+			char clock[8] = "";
+			time_t playedAt = static_cast<time_t>(it->Time);
+			tm localTime;
+			if (localtime_s(&localTime, &playedAt) == 0)
+				strftime(clock, sizeof(clock), "%H:%M", &localTime);
+
+			if (historyTipText != "")
+				historyTipText += "\r\n";
+			historyTipText += clock;
+			historyTipText += "  ";
+			if (it->Artist != "")
+				historyTipText += toDisplayText(it->Artist) + " - ";
+			historyTipText += toDisplayText(it->Title);
+		}
+
+		dispInfo->lpszText = const_cast<char*>(historyTipText.c_str());
+	}
 }
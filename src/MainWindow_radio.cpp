@@ -31,7 +31,15 @@ namespace inetr {
 	}
 
 	void MainWindow::radioOpenURLThread(string url) {
-		radioStatus_currentMetadata = "";
+		// Show the last known metadata until the first update comes in
+		const Station *station = currentStation;
+		NowPlaying nowPlaying;
+		if (station != nullptr && nowPlayingMonitor.TryGet(
+			Station(*station).GetIdentifier().ToString(), nowPlaying) &&
+			!nowPlaying.Failed)
+			radioStatus_currentMetadata = toDisplayText(nowPlaying.Meta);
+		else
+			radioStatus_currentMetadata = "";
 
 		KillTimer(window, bufferTimerId);
 		KillTimer(window, metaTimerId);
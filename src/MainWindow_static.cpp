@@ -13,6 +13,12 @@ using std::map;
 namespace inetr {
 	const char* const MainWindow::windowClassName = "InternetRadio";
 
+	const char* const MainWindow::labelEscapes[][2] = {
+		{ "&", "&&" }
+	};
+	const StringReplacer MainWindow::labelEscaper(labelEscapes,
+		sizeof(labelEscapes) / sizeof(labelEscapes[0]));
+
 	WNDPROC MainWindow::staticListBoxOriginalWndProc;
 	map<HWND, MainWindow*> MainWindow::staticParentLookupTable;
 
@@ -86,6 +92,16 @@ namespace inetr {
 			parent->downloadUpdatesThread();
 	}
 
+	unsigned int __stdcall MainWindow::staticRefreshStationsThread(
+		void *param) {
+
+		MainWindow *parent = reinterpret_cast<MainWindow*>(param);
+		if (parent)
+			parent->refreshStationsThread();
+
+		return 0;
+	}
+
 
 	void CALLBACK MainWindow::staticMetaSync(HSYNC handle, DWORD channel,
 		DWORD data, void *user) {
@@ -0,0 +1,44 @@
+#include "MappedFile.hpp"
+
+#include <string>
+
+#include <Windows.h>
+
+using std::string;
+
+namespace inetr {
+	MappedFile::MappedFile(const string &path) {
+		mapping = nullptr;
+		view = nullptr;
+		size = 0;
+
+		// Sharing delete lets the file be renamed while it is mapped
+		file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ |
+			FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			return;
+
+		mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0,
+			nullptr);
+		if (mapping == nullptr)
+			return;
+
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view != nullptr)
+			size = static_cast<size_t>(fileSize.QuadPart);
+	}
+
+	MappedFile::~MappedFile() {
+		if (view != nullptr)
+			UnmapViewOfFile(view);
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+}
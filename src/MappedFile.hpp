@@ -0,0 +1,32 @@
+#ifndef INETR_MAPPEDFILE_HPP
+#define INETR_MAPPEDFILE_HPP
+
+#include <string>
+
+#include <Windows.h>
+
+namespace inetr {
+	// Read-only view of a whole file, empty if the file does not exist or
+	// cannot be mapped
+	class MappedFile {
+	public:
+		MappedFile(const std::string &path);
+		~MappedFile();
+
+		inline bool IsOpen() const { return view != nullptr; }
+		inline const char *GetData() const {
+			return static_cast<const char*>(view);
+		}
+		inline size_t GetSize() const { return size; }
+	private:
+		MappedFile(const MappedFile &original);
+		MappedFile& operator=(const MappedFile &original);
+
+		HANDLE file;
+		HANDLE mapping;
+		void *view;
+		size_t size;
+	};
+}
+
+#endif  // !INETR_MAPPEDFILE_HPP
@@ -1,23 +1,117 @@
 #include "MetaMetaSource.hpp"
 
+#include <cstdlib>
+#include <cstring>
+
 #include <map>
+#include <memory>
+#include <ostream>
+#include <streambuf>
 #include <string>
 #include <vector>
 
 #include <bass.h>
 
+#include "HTTP.hpp"
+#include "IcyDemuxer.hpp"
 #include "StringUtil.hpp"
 
 using std::map;
+using std::ostream;
+using std::pair;
+using std::streambuf;
+using std::streamsize;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 namespace inetr {
+	namespace {
+		// Demuxes an ICY response body written by HTTP::Get and fails the
+		// stream as soon as the first metadata block has been parsed, which
+		// makes HTTP::Get disconnect
+		class IcyMetadataStreamBuf : public streambuf,
+			public IcyDemuxerListener {
+		public:
+			IcyMetadataStreamBuf(const map<string, string> &responseHeaders) :
+				responseHeaders(responseHeaders) {
+
+				received = false;
+				bytesLeft = 0;
+			}
+
+			void OnAudioData(const char *data, size_t length) { }
+
+			void OnMetadata(const IcyMetadata &metadata) {
+				Metadata = metadata;
+				received = true;
+			}
+
+			IcyMetadata Metadata;
+		protected:
+			int_type overflow(int_type c) {
+				if (traits_type::eq_int_type(c, traits_type::eof()))
+					return traits_type::not_eof(c);
+
+				char ch = traits_type::to_char_type(c);
+				return (xsputn(&ch, 1) == 1) ? c : traits_type::eof();
+			}
+
+			streamsize xsputn(const char *s, streamsize n) {
+				if (demuxer.get() == nullptr) {
+					map<string, string>::const_iterator it =
+						responseHeaders.find("icy-metaint");
+					if (it == responseHeaders.end())
+						return 0;
+
+					size_t metaInterval = static_cast<size_t>(strtoul(
+						it->second.c_str(), nullptr, 10));
+					if (metaInterval == 0)
+						return 0;
+
+					demuxer.reset(new IcyDemuxer(this, metaInterval));
+					bytesLeft = (metaInterval + maxMetaBlockSize) *
+						maxMetaBlocks;
+				}
+
+				size_t length = static_cast<size_t>(n);
+				if (length > bytesLeft)
+					return 0;
+				bytesLeft -= length;
+
+				demuxer->Feed(s, length);
+
+				return received ? 0 : n;
+			}
+		private:
+			static const size_t maxMetaBlockSize = 4080;
+			static const size_t maxMetaBlocks = 4;
+
+			IcyMetadataStreamBuf &operator=(const IcyMetadataStreamBuf &);
+
+			const map<string, string> &responseHeaders;
+			unique_ptr<IcyDemuxer> demuxer;
+			bool received;
+			size_t bytesLeft;
+		};
+	}
+
 	bool MetaMetaSource::Get(const map<string, string> &parameters,
 		vector<string> &precedingMetaSources, string &out) const {
 
+		map<string, string>::const_iterator itRStream =
+			parameters.find("rStream"), itRStreamURL =
+			parameters.find("rStreamURL");
+
+		if (itRStream == parameters.end()) {
+			if (itRStreamURL == parameters.end())
+				return false;
+
+			return getFromStreamURL(itRStreamURL->second, out);
+		}
+
 		HSTREAM *currentStreamPtr = reinterpret_cast<HSTREAM*>(
-			StringUtil::StringToPointer(parameters.find("rStream")->second));
+			StringUtil::StringToPointer(itRStream->second));
 
 		const char *csMetadata =
 			BASS_ChannelGetTags(*currentStreamPtr, BASS_TAG_META);
@@ -25,25 +119,31 @@ namespace inetr {
 		if (!csMetadata)
 			return false;
 
-		string metadata(csMetadata);
+		IcyMetadata metadata;
+		if (!IcyDemuxer::ParseMetadata(csMetadata, strlen(csMetadata),
+			metadata) || metadata.StreamTitle.empty())
+			return false;
+
+		out = metadata.StreamTitle;
 
-		string titleStr("StreamTitle='");
+		return true;
+	}
 
-		size_t titlePos = metadata.find(titleStr);
+	bool MetaMetaSource::getFromStreamURL(const string &url, string &out) {
+		map<string, string> requestHeaders, responseHeaders;
+		requestHeaders.insert(pair<string, string>("Icy-MetaData", "1"));
 
-		if (titlePos == metadata.npos)
-			return false;
+		IcyMetadataStreamBuf icyBuf(responseHeaders);
+		ostream icyStream(&icyBuf);
 
-		size_t titleBeginPos = titlePos + titleStr.length();
-		size_t titleEndPos = metadata.find("'", titleBeginPos);
+		try {
+			HTTP::Get(url, &icyStream, requestHeaders, &responseHeaders);
+		} catch(...) { }
 
-		if (titleEndPos == metadata.npos)
+		if (icyBuf.Metadata.StreamTitle.empty())
 			return false;
 
-		string title = metadata.substr(titleBeginPos, titleEndPos -
-			titleBeginPos);
-
-		out = title;
+		out = icyBuf.Metadata.StreamTitle;
 
 		return true;
 	}
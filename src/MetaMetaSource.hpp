@@ -16,6 +16,10 @@ namespace inetr {
 		bool Get(const std::map<std::string, std::string> &parameters,
 			std::vector<std::string> &precedingMetaSources, std::string &out)
 			const;
+	private:
+		// Used when there is no BASS stream to read the tags from, e.g. for
+		// stations that aren't currently playing
+		static bool getFromStreamURL(const std::string &url, std::string &out);
 	};
 }
 
@@ -0,0 +1,880 @@
+#include "MetadataHistory.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ShlObj.h>
+#include <Windows.h>
+
+#include "MappedFile.hpp"
+#include "StringUtil.hpp"
+
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+using std::pair;
+using std::streamoff;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace inetr {
+	namespace {
+		const char stringsMagic[4] = { 'I', 'R', 'H', 'S' };
+		const char recordsMagic[4] = { 'I', 'R', 'H', 'R' };
+		const uint32_t fileVersion = 3;
+		// Magic, version and the generation both files have to agree on
+		const size_t headerSize = sizeof(stringsMagic) + sizeof(fileVersion) +
+			sizeof(uint32_t);
+
+		// Returns the payload after a valid header or nullptr
+		const char *payload(const MappedFile &file, const char magic[4],
+			uint32_t &generation, size_t &length) {
+
+			if (file.GetSize() < headerSize || memcmp(file.GetData(), magic,
+				4) != 0)
+				return nullptr;
+
+			uint32_t version;
+			memcpy(&version, file.GetData() + 4, sizeof(version));
+			if (version != fileVersion)
+				return nullptr;
+
+			memcpy(&generation, file.GetData() + 8, sizeof(generation));
+
+			length = file.GetSize() - headerSize;
+			return file.GetData() + headerSize;
+		}
+
+		void writeHeader(ofstream &file, const char magic[4],
+			uint32_t generation) {
+
+			file.write(magic, 4);
+			file.write(reinterpret_cast<const char*>(&fileVersion),
+				sizeof(fileVersion));
+			file.write(reinterpret_cast<const char*>(&generation),
+				sizeof(generation));
+		}
+
+		// Fails unless the payload is offset bytes long, string IDs and
+		// record indices handed out for data written anywhere else would
+		// point at the wrong thing
+		bool appendToFile(const string &path, const char magic[4],
+			uint32_t generation, size_t offset, const char *data,
+			size_t length) {
+
+			ifstream probe;
+			probe.open(path, ios::in | ios::binary | ios::ate);
+			streamoff size = probe.is_open() ? static_cast<streamoff>(
+				probe.tellg()) : 0;
+			probe.close();
+
+			bool empty = size <= 0;
+			if (empty ? offset != 0 : static_cast<uint64_t>(size) !=
+				headerSize + offset)
+				return false;
+
+			ofstream file;
+			file.open(path, ios::out | ios::binary | ios::app);
+			if (!file.is_open())
+				return false;
+
+			if (empty)
+				writeHeader(file, magic, generation);
+			file.write(data, length);
+
+			return !file.fail();
+		}
+
+		bool writeFile(const string &path, const char magic[4],
+			uint32_t generation, const char *data, size_t length) {
+
+			ofstream file;
+			file.open(path, ios::out | ios::binary | ios::trunc);
+			if (!file.is_open())
+				return false;
+
+			writeHeader(file, magic, generation);
+			if (length > 0)
+				file.write(data, length);
+
+			return !file.fail();
+		}
+
+		void appendString(string &data, const string &str) {
+			uint32_t length = static_cast<uint32_t>(str.length());
+			data.append(reinterpret_cast<const char*>(&length),
+				sizeof(length));
+			data.append(str);
+		}
+
+		// String IDs are offsets into the strings file, the header keeps
+		// every stored string's above 0
+		bool stringAt(const char *strings, size_t length, uint32_t id,
+			StringRef &out) {
+
+			if (id == 0) {
+				out = StringRef();
+				return true;
+			}
+
+			if (strings == nullptr || id < headerSize)
+				return false;
+
+			size_t offset = id - headerSize;
+			if (offset > length || length - offset < sizeof(uint32_t))
+				return false;
+
+			uint32_t strLength;
+			memcpy(&strLength, strings + offset, sizeof(strLength));
+			offset += sizeof(strLength);
+
+			if (strLength > length - offset)
+				return false;
+
+			out = StringRef(strings + offset, strLength);
+			return true;
+		}
+	}
+
+	MetadataHistory::MetadataHistory(size_t budget /* = 16384 */,
+		size_t ringCapacity /* = 256 */, size_t diskBudget /* = 262144 */) {
+
+		this->ringCapacity = (ringCapacity > 0) ? ringCapacity : 1;
+		this->budget = (budget >= this->ringCapacity) ? budget :
+			this->ringCapacity;
+		this->diskBudget = (diskBudget >= this->budget) ? diskBudget :
+			this->budget;
+		entryCount = 0;
+
+		String empty;
+		empty.References = 1;
+		strings.insert(pair<uint32_t, String>(0, empty));
+		stringIds.insert(pair<string, uint32_t>("", 0));
+		stringsEnd = headerSize;
+
+		generation = 0;
+		recordCount = 0;
+
+		InitializeCriticalSection(&lock);
+	}
+
+	MetadataHistory::~MetadataHistory() {
+		DeleteCriticalSection(&lock);
+	}
+
+	bool MetadataHistory::Load() {
+		EnterCriticalSection(&lock);
+
+		entryCount = 0;
+		strings.clear();
+		stringIds.clear();
+		stationIds.clear();
+		unsavedStrings.clear();
+		rings.clear();
+		pending.clear();
+		generation = 0;
+		recordCount = 0;
+		lastRecords.clear();
+
+		String empty;
+		empty.References = 1;
+		strings.insert(pair<uint32_t, String>(0, empty));
+		stringIds.insert(pair<string, uint32_t>("", 0));
+		stringsEnd = headerSize;
+
+		string stringsPath = dataPath("history.str");
+		string recordsPath = dataPath("history.dat");
+
+		bool valid, torn = false;
+		unordered_map<uint32_t, vector<Record> > newest;
+		{
+			MappedFile stringsFile(stringsPath), recordsFile(recordsPath);
+			uint32_t stringsGeneration = 0, recordsGeneration = 0;
+			size_t stringsLength = 0, recordsLength = 0;
+			const char *stringsData = payload(stringsFile, stringsMagic,
+				stringsGeneration, stringsLength);
+			const char *recordsData = payload(recordsFile, recordsMagic,
+				recordsGeneration, recordsLength);
+
+			// Files from an older version, or a pair that an interrupted
+			// compaction left behind, can't be appended to
+			valid = (stringsData != nullptr || !stringsFile.IsOpen()) &&
+				(recordsData != nullptr || !recordsFile.IsOpen()) &&
+				(recordsData == nullptr || (stringsData != nullptr &&
+				stringsGeneration == recordsGeneration));
+
+			// A string cut off at the end is never referenced, appending
+			// after it keeps every ID valid
+			if (valid && stringsData != nullptr) {
+				generation = stringsGeneration;
+				stringsEnd = static_cast<uint32_t>(headerSize + stringsLength);
+			}
+
+			if (valid && recordsData != nullptr) {
+				recordCount = static_cast<uint32_t>(recordsLength /
+					sizeof(Record));
+				torn = recordsLength % sizeof(Record) != 0;
+			}
+
+			// Find the head of every station's chain and refill the rings
+			// with the newest records. Only the strings those use are read
+			// into memory.
+			size_t loaded = 0;
+			for (size_t i = recordCount; i > 0; --i) {
+				Record record;
+				memcpy(&record, recordsData + (i - 1) * sizeof(Record),
+					sizeof(Record));
+
+				StringRef station, artist, title;
+				if (!stringAt(stringsData, stringsLength, record.Artist,
+					artist) || !stringAt(stringsData, stringsLength,
+					record.Title, title))
+					continue;
+
+				if (lastRecords.find(record.Station) == lastRecords.end()) {
+					if (record.Station == 0 || !stringAt(stringsData,
+						stringsLength, record.Station, station))
+						continue;
+
+					stationIds.insert(pair<string, uint32_t>(
+						station.ToString(), record.Station));
+					lastRecords.insert(pair<uint32_t, uint32_t>(
+						record.Station, static_cast<uint32_t>(i - 1)));
+				}
+
+				if (loaded < budget) {
+					vector<Record> &records = newest[record.Station];
+					if (records.size() < ringCapacity) {
+						record.Artist = acquire(artist.ToString(),
+							record.Artist);
+						record.Title = acquire(title.ToString(), record.Title);
+						records.push_back(record);
+						++loaded;
+					}
+				}
+			}
+		}
+
+		if (!valid) {
+			DeleteFile(stringsPath.c_str());
+			DeleteFile(recordsPath.c_str());
+		}
+
+		for (unordered_map<uint32_t, vector<Record> >::iterator it =
+			newest.begin(); it != newest.end(); ++it) {
+
+			Ring &ring = rings[it->first];
+
+			for (vector<Record>::reverse_iterator rIt = it->second.rbegin();
+				rIt != it->second.rend(); ++rIt) {
+
+				push(it->first, ring, rIt->Time, rIt->Artist, rIt->Title,
+					true);
+			}
+		}
+
+		// A partial record at the end would misalign everything appended
+		// after it
+		if (torn)
+			compact();
+
+		LeaveCriticalSection(&lock);
+
+		return true;
+	}
+
+	bool MetadataHistory::Save() {
+		EnterCriticalSection(&lock);
+
+		for (unordered_map<uint32_t, Ring>::iterator it = rings.begin();
+			it != rings.end(); ++it) {
+
+			Ring &ring = it->second;
+			size_t size = ring.Deltas.size();
+			size_t longDeltas = 0;
+
+			uint32_t time = ring.FirstTime;
+			for (size_t i = 0; i < ring.Count; ++i) {
+				size_t position = (ring.Head + i) % size;
+				uint32_t delta = ring.Deltas[position];
+				if (delta == longDelta)
+					delta = ring.LongDeltas[longDeltas++];
+				if (i > 0)
+					time += delta;
+
+				if (i >= ring.Count - ring.Unsaved) {
+					Record record = { time, it->first, ring.Artists[position],
+						ring.Titles[position], noRecord };
+					pending.push_back(record);
+				}
+			}
+
+			ring.Unsaved = 0;
+		}
+
+		bool result = flush();
+		if (result && recordCount > diskBudget + diskBudget / 4)
+			result = compact();
+
+		LeaveCriticalSection(&lock);
+
+		return result;
+	}
+
+	void MetadataHistory::Add(const string &station, const string &meta,
+		uint32_t time) {
+
+		StringRef trimmed = StringRef(meta).Trim();
+		if (station == "" || trimmed.Empty())
+			return;
+
+		string artist, title;
+		size_t separator = trimmed.Find(" - ");
+		if (separator == StringRef::npos) {
+			title = trimmed.ToString();
+		} else {
+			artist = trimmed.Substr(0, separator).Trim().ToString();
+			title = trimmed.Substr(separator + 3).Trim().ToString();
+		}
+
+		EnterCriticalSection(&lock);
+
+		uint32_t stationId = addStation(station);
+
+		Ring &ring = rings[stationId];
+		bool repeated = false;
+		if (ring.Count > 0) {
+			size_t last = (ring.Head + ring.Count - 1) % ring.Deltas.size();
+			repeated = strings[ring.Artists[last]].Value == artist &&
+				strings[ring.Titles[last]].Value == title;
+		}
+
+		if (!repeated) {
+			push(stationId, ring, time, acquire(artist), acquire(title),
+				false);
+		}
+
+		LeaveCriticalSection(&lock);
+	}
+
+	size_t MetadataHistory::GetRecent(const string &station, size_t count,
+		vector<HistoryEntry> &out) const {
+
+		out.clear();
+
+		EnterCriticalSection(&lock);
+
+		unordered_map<uint32_t, Ring>::const_iterator it =
+			rings.find(findStation(station));
+		if (it != rings.end())
+			readRing(it->second, count, out);
+
+		LeaveCriticalSection(&lock);
+
+		return out.size();
+	}
+
+	size_t MetadataHistory::GetHistory(const string &station, size_t count,
+		vector<HistoryEntry> &out) {
+
+		out.clear();
+
+		EnterCriticalSection(&lock);
+
+		uint32_t stationId = findStation(station);
+		size_t persisted = 0;
+
+		unordered_map<uint32_t, Ring>::const_iterator it =
+			rings.find(stationId);
+		if (it != rings.end()) {
+			readRing(it->second, count, out);
+			persisted = it->second.Count - it->second.Unsaved;
+		}
+
+		// Looked up after flushing, which chains the spilled entries
+		size_t index = noRecord;
+		if (stationId != 0 && out.size() < count && flush()) {
+			unordered_map<uint32_t, uint32_t>::const_iterator last =
+				lastRecords.find(stationId);
+			if (last != lastRecords.end())
+				index = last->second;
+		}
+
+		if (index != noRecord) {
+			MappedFile stringsFile(dataPath("history.str")),
+				recordsFile(dataPath("history.dat"));
+			uint32_t fileGeneration = 0;
+			size_t stringsLength = 0, recordsLength = 0;
+			const char *stringsData = payload(stringsFile, stringsMagic,
+				fileGeneration, stringsLength);
+			const char *recordsData = payload(recordsFile, recordsMagic,
+				fileGeneration, recordsLength);
+
+			size_t available = (recordsData != nullptr) ? recordsLength /
+				sizeof(Record) : 0;
+
+			// Follow the station's chain from its newest record back
+			while (index < available && out.size() < count) {
+				Record record;
+				memcpy(&record, recordsData + index * sizeof(Record),
+					sizeof(Record));
+
+				if (record.Station != stationId)
+					break;
+
+				// The newest records on disk are still held by the ring
+				StringRef artist, title;
+				if (persisted > 0) {
+					--persisted;
+				} else if (stringAt(stringsData, stringsLength, record.Artist,
+					artist) && stringAt(stringsData, stringsLength,
+					record.Title, title)) {
+
+					HistoryEntry entry;
+					entry.Artist = artist.ToString();
+					entry.Title = title.ToString();
+					entry.Time = record.Time;
+					out.push_back(entry);
+				}
+
+				index = (record.Previous < index) ? record.Previous :
+					noRecord;
+			}
+		}
+
+		LeaveCriticalSection(&lock);
+
+		return out.size();
+	}
+
+	string MetadataHistory::dataPath(const char *fileName) {
+		char appDataPath[MAX_PATH];
+		SHGetFolderPath(nullptr, CSIDL_APPDATA, nullptr, SHGFP_TYPE_CURRENT,
+			appDataPath);
+
+		return string(appDataPath) + "\\InternetRadio\\" + fileName;
+	}
+
+	uint32_t MetadataHistory::append(const string &str) {
+		uint32_t id = stringsEnd;
+		appendString(unsavedStrings, str);
+		stringsEnd += static_cast<uint32_t>(sizeof(uint32_t) + str.length());
+
+		return id;
+	}
+
+	uint32_t MetadataHistory::acquire(const string &str,
+		uint32_t savedId /* = 0 */) {
+
+		unordered_map<string, uint32_t>::const_iterator it =
+			stringIds.find(str);
+		if (it != stringIds.end()) {
+			++strings[it->second].References;
+			return it->second;
+		}
+
+		uint32_t id = (savedId != 0) ? savedId : append(str);
+
+		String entry;
+		entry.Value = str;
+		entry.References = 1;
+		strings.insert(pair<uint32_t, String>(id, entry));
+		stringIds.insert(pair<string, uint32_t>(str, id));
+
+		return id;
+	}
+
+	void MetadataHistory::release(uint32_t id) {
+		unordered_map<uint32_t, String>::iterator it = strings.find(id);
+		if (id == 0 || it == strings.end() || --it->second.References > 0)
+			return;
+
+		stringIds.erase(it->second.Value);
+		strings.erase(it);
+	}
+
+	uint32_t MetadataHistory::addStation(const string &name) {
+		unordered_map<string, uint32_t>::const_iterator it =
+			stationIds.find(name);
+		if (it != stationIds.end())
+			return it->second;
+
+		uint32_t id = append(name);
+		stationIds.insert(pair<string, uint32_t>(name, id));
+
+		return id;
+	}
+
+	uint32_t MetadataHistory::findStation(const string &name) const {
+		unordered_map<string, uint32_t>::const_iterator it =
+			stationIds.find(name);
+
+		return (it != stationIds.end()) ? it->second : 0;
+	}
+
+	void MetadataHistory::push(uint32_t station, Ring &ring, uint32_t time,
+		uint32_t artist, uint32_t title, bool saved) {
+
+		if (ring.Count == ringCapacity)
+			evict(station, ring);
+		else if (entryCount >= budget)
+			evictOldest();
+
+		if (ring.Count > 0 && time < ring.LastTime)
+			time = ring.LastTime;
+
+		uint32_t delta = (ring.Count > 0) ? time - ring.LastTime : 0;
+
+		size_t tail = (ring.Head + ring.Count) % ringCapacity;
+		if (tail == ring.Deltas.size()) {
+			ring.Artists.push_back(0);
+			ring.Titles.push_back(0);
+			ring.Deltas.push_back(0);
+		}
+
+		ring.Artists[tail] = artist;
+		ring.Titles[tail] = title;
+		if (delta >= longDelta) {
+			ring.Deltas[tail] = longDelta;
+			ring.LongDeltas.push_back(delta);
+		} else {
+			ring.Deltas[tail] = static_cast<uint16_t>(delta);
+		}
+
+		if (ring.Count == 0)
+			ring.FirstTime = time;
+		ring.LastTime = time;
+
+		++ring.Count;
+		if (!saved)
+			++ring.Unsaved;
+		++entryCount;
+	}
+
+	void MetadataHistory::evict(uint32_t station, Ring &ring) {
+		if (ring.Count == 0)
+			return;
+
+		size_t head = ring.Head;
+
+		// Entries that were loaded or saved already exist on disk
+		if (ring.Count == ring.Unsaved) {
+			Record record = { ring.FirstTime, station, ring.Artists[head],
+				ring.Titles[head], noRecord };
+			pending.push_back(record);
+			--ring.Unsaved;
+		}
+
+		release(ring.Artists[head]);
+		release(ring.Titles[head]);
+
+		if (ring.Deltas[head] == longDelta)
+			ring.LongDeltas.pop_front();
+
+		ring.Head = (head + 1) % ringCapacity;
+		--ring.Count;
+		--entryCount;
+
+		if (ring.Count > 0) {
+			uint16_t delta = ring.Deltas[ring.Head];
+			ring.FirstTime += (delta == longDelta) ? ring.LongDeltas.front() :
+				delta;
+		}
+
+		if (pending.size() >= flushThreshold)
+			flush();
+	}
+
+	void MetadataHistory::evictOldest() {
+		unordered_map<uint32_t, Ring>::iterator oldest = rings.end();
+
+		for (unordered_map<uint32_t, Ring>::iterator it = rings.begin();
+			it != rings.end(); ++it) {
+
+			if (it->second.Count > 0 && (oldest == rings.end() ||
+				it->second.FirstTime < oldest->second.FirstTime)) {
+
+				oldest = it;
+			}
+		}
+
+		if (oldest != rings.end())
+			evict(oldest->first, oldest->second);
+	}
+
+	bool MetadataHistory::flush() {
+		// Strings first so that every record on disk can be resolved
+		if (!unsavedStrings.empty()) {
+			if (!appendToFile(dataPath("history.str"), stringsMagic,
+				generation, stringsEnd - headerSize - unsavedStrings.length(),
+				unsavedStrings.data(), unsavedStrings.length()))
+				return false;
+
+			unsavedStrings.clear();
+		}
+
+		if (!pending.empty()) {
+			for (size_t i = 0; i < pending.size(); ++i) {
+				Record &record = pending[i];
+
+				unordered_map<uint32_t, uint32_t>::iterator last =
+					lastRecords.find(record.Station);
+				record.Previous = (last != lastRecords.end()) ? last->second :
+					noRecord;
+				lastRecords[record.Station] = static_cast<uint32_t>(
+					recordCount + i);
+			}
+
+			if (!appendToFile(dataPath("history.dat"), recordsMagic,
+				generation, recordCount * sizeof(Record),
+				reinterpret_cast<const char*>(&pending[0]),
+				pending.size() * sizeof(Record))) {
+
+				// Unlink the batch again, it is chained anew next time
+				for (size_t i = pending.size(); i > 0; --i) {
+					const Record &record = pending[i - 1];
+					if (record.Previous == noRecord)
+						lastRecords.erase(record.Station);
+					else
+						lastRecords[record.Station] = record.Previous;
+				}
+
+				return false;
+			}
+
+			recordCount += static_cast<uint32_t>(pending.size());
+			pending.clear();
+		}
+
+		return true;
+	}
+
+	bool MetadataHistory::compact() {
+		if (!flush())
+			return false;
+
+		string stringsPath = dataPath("history.str");
+		string recordsPath = dataPath("history.dat");
+
+		vector<Record> kept;
+		string stringData;
+		unordered_map<uint32_t, String> compactedStrings;
+		unordered_map<string, uint32_t> compactedStations;
+		unordered_map<uint32_t, Ring> remapped;
+		unordered_map<uint32_t, uint32_t> compactedLast;
+		{
+			MappedFile stringsFile(stringsPath), recordsFile(recordsPath);
+			uint32_t fileGeneration = 0;
+			size_t stringsLength = 0, recordsLength = 0;
+			const char *stringsData = payload(stringsFile, stringsMagic,
+				fileGeneration, stringsLength);
+			const char *recordsData = payload(recordsFile, recordsMagic,
+				fileGeneration, recordsLength);
+
+			// Keep the newest diskBudget records and whatever a ring counts
+			// on being on disk
+			size_t available = (recordsData != nullptr) ? recordsLength /
+				sizeof(Record) : 0;
+			size_t first = (available > diskBudget) ? available - diskBudget :
+				0;
+
+			vector<bool> keep(available, false);
+			for (size_t i = first; i < available; ++i)
+				keep[i] = true;
+
+			for (unordered_map<uint32_t, Ring>::const_iterator it =
+				rings.begin(); it != rings.end(); ++it) {
+
+				unordered_map<uint32_t, uint32_t>::const_iterator last =
+					lastRecords.find(it->first);
+				if (last == lastRecords.end())
+					continue;
+
+				size_t persisted = it->second.Count - it->second.Unsaved;
+				size_t index = last->second;
+				while (persisted > 0 && index < available) {
+					keep[index] = true;
+					--persisted;
+
+					Record record;
+					memcpy(&record, recordsData + index * sizeof(Record),
+						sizeof(Record));
+					index = (record.Previous < index) ? record.Previous :
+						noRecord;
+				}
+			}
+
+			// Everything in memory was flushed, so all strings are read from
+			// the file and written back once each, which also drops the
+			// ones nothing refers to anymore
+			unordered_map<uint32_t, uint32_t> remap;
+			unordered_map<string, uint32_t> compactedIds;
+			remap.insert(pair<uint32_t, uint32_t>(0, 0));
+			auto relocate = [&](uint32_t id) -> uint32_t {
+				unordered_map<uint32_t, uint32_t>::const_iterator it =
+					remap.find(id);
+				if (it != remap.end())
+					return it->second;
+
+				StringRef str;
+				if (!stringAt(stringsData, stringsLength, id, str))
+					return 0;
+
+				string value = str.ToString();
+				uint32_t compactedId;
+				unordered_map<string, uint32_t>::const_iterator existing =
+					compactedIds.find(value);
+				if (existing != compactedIds.end()) {
+					compactedId = existing->second;
+				} else {
+					compactedId = static_cast<uint32_t>(headerSize +
+						stringData.length());
+					compactedIds.insert(pair<string, uint32_t>(value,
+						compactedId));
+					appendString(stringData, value);
+				}
+
+				remap.insert(pair<uint32_t, uint32_t>(id, compactedId));
+				return compactedId;
+			};
+
+			for (size_t i = 0; i < available; ++i) {
+				if (!keep[i])
+					continue;
+
+				Record record;
+				memcpy(&record, recordsData + i * sizeof(Record),
+					sizeof(Record));
+
+				StringRef unused;
+				if (record.Station == 0 || !stringAt(stringsData,
+					stringsLength, record.Station, unused) ||
+					!stringAt(stringsData, stringsLength, record.Artist,
+					unused) || !stringAt(stringsData, stringsLength,
+					record.Title, unused))
+					continue;
+
+				record.Station = relocate(record.Station);
+				record.Artist = relocate(record.Artist);
+				record.Title = relocate(record.Title);
+
+				unordered_map<uint32_t, uint32_t>::iterator last =
+					compactedLast.find(record.Station);
+				record.Previous = (last != compactedLast.end()) ?
+					last->second : noRecord;
+				compactedLast[record.Station] = static_cast<uint32_t>(
+					kept.size());
+				kept.push_back(record);
+			}
+
+			for (unordered_map<uint32_t, String>::const_iterator it =
+				strings.begin(); it != strings.end(); ++it) {
+
+				uint32_t id = relocate(it->first);
+				unordered_map<uint32_t, String>::iterator existing =
+					compactedStrings.find(id);
+				if (existing != compactedStrings.end())
+					existing->second.References += it->second.References;
+				else
+					compactedStrings.insert(pair<uint32_t, String>(id,
+						it->second));
+			}
+
+			for (unordered_map<string, uint32_t>::const_iterator it =
+				stationIds.begin(); it != stationIds.end(); ++it) {
+
+				uint32_t id = relocate(it->second);
+				if (id != 0) {
+					compactedStations.insert(pair<string, uint32_t>(it->first,
+						id));
+				}
+			}
+
+			for (unordered_map<uint32_t, Ring>::const_iterator it =
+				rings.begin(); it != rings.end(); ++it) {
+
+				Ring &ring = remapped[relocate(it->first)];
+				ring = it->second;
+				for (size_t i = 0; i < ring.Count; ++i) {
+					size_t position = (ring.Head + i) % ring.Deltas.size();
+					ring.Artists[position] = relocate(ring.Artists[position]);
+					ring.Titles[position] = relocate(ring.Titles[position]);
+				}
+			}
+		}
+
+		// A new generation makes Load discard the pair if only one of the
+		// files gets replaced
+		uint32_t compactedGeneration = generation + 1;
+		string stringsTemp = stringsPath + ".tmp";
+		string recordsTemp = recordsPath + ".tmp";
+
+		bool written = writeFile(stringsTemp, stringsMagic,
+			compactedGeneration, stringData.data(), stringData.length()) &&
+			writeFile(recordsTemp, recordsMagic, compactedGeneration,
+			kept.empty() ? nullptr : reinterpret_cast<const char*>(&kept[0]),
+			kept.size() * sizeof(Record)) &&
+			MoveFileEx(stringsTemp.c_str(), stringsPath.c_str(),
+			MOVEFILE_REPLACE_EXISTING) != 0 &&
+			MoveFileEx(recordsTemp.c_str(), recordsPath.c_str(),
+			MOVEFILE_REPLACE_EXISTING) != 0;
+
+		if (!written) {
+			DeleteFile(stringsTemp.c_str());
+			DeleteFile(recordsTemp.c_str());
+			return false;
+		}
+
+		strings.swap(compactedStrings);
+		stringIds.clear();
+		for (unordered_map<uint32_t, String>::const_iterator it =
+			strings.begin(); it != strings.end(); ++it) {
+
+			stringIds.insert(pair<string, uint32_t>(it->second.Value,
+				it->first));
+		}
+		stationIds.swap(compactedStations);
+		stringsEnd = static_cast<uint32_t>(headerSize + stringData.length());
+
+		rings.swap(remapped);
+		lastRecords.swap(compactedLast);
+		recordCount = static_cast<uint32_t>(kept.size());
+		generation = compactedGeneration;
+
+		return true;
+	}
+
+	size_t MetadataHistory::readRing(const Ring &ring, size_t count,
+		vector<HistoryEntry> &out) const {
+
+		size_t read = 0;
+		uint32_t time = ring.LastTime;
+		size_t longDeltas = ring.LongDeltas.size();
+
+		for (size_t i = ring.Count; i > 0 && read < count; --i, ++read) {
+			size_t position = (ring.Head + i - 1) % ring.Deltas.size();
+
+			HistoryEntry historyEntry;
+			historyEntry.Artist = strings.find(
+				ring.Artists[position])->second.Value;
+			historyEntry.Title = strings.find(
+				ring.Titles[position])->second.Value;
+			historyEntry.Time = time;
+			out.push_back(historyEntry);
+
+			uint16_t delta = ring.Deltas[position];
+			time -= (delta == longDelta) ? ring.LongDeltas[--longDeltas] :
+				delta;
+		}
+
+		return read;
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef INETR_METADATAHISTORY_HPP
+#define INETR_METADATAHISTORY_HPP
+
+#include <cstdint>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+
+namespace inetr {
+	struct HistoryEntry {
+		std::string Artist;
+		std::string Title;
+		uint32_t Time;
+	};
+
+	// Append-only per-station track history. Artists and titles are interned
+	// and kept in fixed-size per-station rings with 16 bit timestamp deltas
+	// while the total number of entries in memory is bounded by a budget.
+	// Entries pushed out of memory are spilled to a file of fixed-size
+	// records that is memory-mapped when older history is requested. Strings
+	// are identified by their offset in the strings file, so only the ones
+	// the rings and station names use are kept in memory and spilled records
+	// are resolved from the mapped file. The records of a station are
+	// chained, so reading one station's history doesn't scan everyone
+	// else's, and Save trims the files back to diskBudget records once a
+	// quarter of them is over it.
+	class MetadataHistory {
+	public:
+		MetadataHistory(size_t budget = 16384, size_t ringCapacity = 256,
+			size_t diskBudget = 262144);
+		~MetadataHistory();
+
+		bool Load();
+		bool Save();
+
+		// Records meta ("Artist - Title") unless it is what the station
+		// was already playing
+		void Add(const std::string &station, const std::string &meta,
+			uint32_t time);
+
+		// Newest first, served from memory only
+		size_t GetRecent(const std::string &station, size_t count,
+			std::vector<HistoryEntry> &out) const;
+		// Newest first, continues into the spilled history on disk
+		size_t GetHistory(const std::string &station, size_t count,
+			std::vector<HistoryEntry> &out);
+	private:
+		struct Ring {
+			Ring() : Head(0), Count(0), Unsaved(0), FirstTime(0),
+				LastTime(0) { }
+
+			std::vector<uint32_t> Artists;
+			std::vector<uint32_t> Titles;
+			// Deltas that don't fit are stored as longDelta and kept in
+			// LongDeltas instead, oldest first
+			std::vector<uint16_t> Deltas;
+			std::deque<uint32_t> LongDeltas;
+			size_t Head;
+			size_t Count;
+			size_t Unsaved;
+			uint32_t FirstTime;
+			uint32_t LastTime;
+		};
+
+		struct String {
+			std::string Value;
+			size_t References;
+		};
+
+		// Strings are offsets into history.str, 0 is the empty string
+		struct Record {
+			uint32_t Time;
+			uint32_t Station;
+			uint32_t Artist;
+			uint32_t Title;
+			// Index of the station's previous record or noRecord
+			uint32_t Previous;
+		};
+
+		static const size_t flushThreshold = 256;
+		static const uint16_t longDelta = 0xFFFF;
+		static const uint32_t noRecord = 0xFFFFFFFF;
+
+		static std::string dataPath(const char *fileName);
+
+		uint32_t append(const std::string &str);
+		// Takes a reference to str, which is appended to the strings file
+		// unless it is already there at savedId
+		uint32_t acquire(const std::string &str, uint32_t savedId = 0);
+		void release(uint32_t id);
+		// Station names are kept for as long as the history is loaded
+		uint32_t addStation(const std::string &name);
+		uint32_t findStation(const std::string &name) const;
+
+		void push(uint32_t station, Ring &ring, uint32_t time, uint32_t artist,
+			uint32_t title, bool saved);
+		void evict(uint32_t station, Ring &ring);
+		void evictOldest();
+		bool flush();
+		bool compact();
+
+		size_t readRing(const Ring &ring, size_t count,
+			std::vector<HistoryEntry> &out) const;
+
+		size_t budget;
+		size_t ringCapacity;
+		size_t diskBudget;
+		size_t entryCount;
+
+		std::unordered_map<uint32_t, String> strings;
+		std::unordered_map<std::string, uint32_t> stringIds;
+		std::unordered_map<std::string, uint32_t> stationIds;
+		// Strings that have an ID but aren't written yet, as stored
+		std::string unsavedStrings;
+		uint32_t stringsEnd;
+
+		std::unordered_map<uint32_t, Ring> rings;
+		std::vector<Record> pending;
+
+		uint32_t generation;
+		uint32_t recordCount;
+		std::unordered_map<uint32_t, uint32_t> lastRecords;
+
+		mutable CRITICAL_SECTION lock;
+	};
+}
+
+#endif  // !INETR_METADATAHISTORY_HPP
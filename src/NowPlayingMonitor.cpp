@@ -0,0 +1,321 @@
+#include "NowPlayingMonitor.hpp"
+
+#include <cstdint>
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <process.h>
+#include <Windows.h>
+
+#include "TextCodec.hpp"
+
+using std::list;
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace inetr {
+	NowPlayingMonitor::NowPlayingMonitor(unsigned int workerCount /* = 4 */,
+		unsigned int interval /* = 30000 */, unsigned int hostInterval
+		/* = 2000 */) {
+
+		this->workerCount = (workerCount > 0) ? workerCount : 1;
+		this->interval = interval;
+		this->hostInterval = hostInterval;
+
+		InitializeCriticalSection(&schedulerLock);
+		wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		stoppedEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+		runningWorkers = 0;
+		running = false;
+
+		nextGeneration = 0;
+
+		for (size_t i = 0; i < resultShardCount; ++i)
+			InitializeCriticalSection(&resultLocks[i]);
+	}
+
+	NowPlayingMonitor::~NowPlayingMonitor() {
+		Stop();
+
+		for (size_t i = 0; i < resultShardCount; ++i)
+			DeleteCriticalSection(&resultLocks[i]);
+
+		CloseHandle(stoppedEvent);
+		CloseHandle(stopEvent);
+		CloseHandle(wakeEvent);
+		DeleteCriticalSection(&schedulerLock);
+	}
+
+	void NowPlayingMonitor::Start() {
+		if (running)
+			return;
+		running = true;
+
+		ResetEvent(stopEvent);
+		ResetEvent(stoppedEvent);
+		requests.Reset();
+		runningWorkers = static_cast<LONG>(workerCount);
+
+		for (unsigned int i = 0; i < workerCount; ++i)
+			_beginthread(staticWorkerThread, 0, reinterpret_cast<void*>(this));
+	}
+
+	void NowPlayingMonitor::Stop() {
+		if (!running)
+			return;
+		running = false;
+
+		SetEvent(stopEvent);
+		requests.Abort();
+		WaitForSingleObject(stoppedEvent, INFINITE);
+	}
+
+	void NowPlayingMonitor::Add(const Station *station) {
+		if (station->GetMetaSources().empty())
+			return;
+
+		EnterCriticalSection(&schedulerLock);
+
+		if (entries.find(station) == entries.end()) {
+			Entry entry;
+			entry.Host = hostOf(station);
+			entry.Generation = ++nextGeneration;
+			entries.insert(pair<const Station*, Entry>(station, entry));
+
+			Job job;
+			job.Due = now();
+			job.Target = station;
+			job.Generation = entry.Generation;
+			jobs.push(job);
+		}
+
+		LeaveCriticalSection(&schedulerLock);
+
+		SetEvent(wakeEvent);
+	}
+
+	void NowPlayingMonitor::Remove(const Station *station) {
+		// Queued jobs of removed stations are dropped lazily by nextJob
+		EnterCriticalSection(&schedulerLock);
+		entries.erase(station);
+		LeaveCriticalSection(&schedulerLock);
+
+		string identifier = station->GetIdentifier().ToString();
+		size_t shard = shardOf(identifier);
+		EnterCriticalSection(&resultLocks[shard]);
+		results[shard].erase(identifier);
+		LeaveCriticalSection(&resultLocks[shard]);
+	}
+
+	void NowPlayingMonitor::SetStations(const list<const Station*> &stations) {
+		map<const Station*, bool> wanted;
+		for (list<const Station*>::const_iterator it = stations.begin();
+			it != stations.end(); ++it) {
+
+			wanted.insert(pair<const Station*, bool>(*it, true));
+		}
+
+		list<const Station*> removed;
+		EnterCriticalSection(&schedulerLock);
+		for (map<const Station*, Entry>::const_iterator it = entries.begin();
+			it != entries.end(); ++it) {
+
+			if (wanted.find(it->first) == wanted.end())
+				removed.push_back(it->first);
+		}
+		LeaveCriticalSection(&schedulerLock);
+
+		for (list<const Station*>::iterator it = removed.begin();
+			it != removed.end(); ++it) {
+
+			Remove(*it);
+		}
+
+		for (list<const Station*>::const_iterator it = stations.begin();
+			it != stations.end(); ++it) {
+
+			Add(*it);
+		}
+	}
+
+	bool NowPlayingMonitor::TryGet(const string &identifier, NowPlaying &out)
+		const {
+
+		size_t shard = shardOf(identifier);
+		bool found = false;
+
+		EnterCriticalSection(&resultLocks[shard]);
+		map<string, NowPlaying>::const_iterator it =
+			results[shard].find(identifier);
+		if (it != results[shard].end()) {
+			out = it->second;
+			found = true;
+		}
+		LeaveCriticalSection(&resultLocks[shard]);
+
+		return found;
+	}
+
+	void __cdecl NowPlayingMonitor::staticWorkerThread(void *param) {
+		NowPlayingMonitor *parent = reinterpret_cast<NowPlayingMonitor*>(param);
+		if (parent)
+			parent->workerThread();
+	}
+
+	uint64_t NowPlayingMonitor::now() {
+		static LARGE_INTEGER frequency = { 0 };
+		if (frequency.QuadPart == 0)
+			QueryPerformanceFrequency(&frequency);
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		return static_cast<uint64_t>(counter.QuadPart) * 1000 /
+			static_cast<uint64_t>(frequency.QuadPart);
+	}
+
+	string NowPlayingMonitor::hostOf(const Station *station) {
+		string url = station->GetStreamURL().ToString();
+
+		for (vector<MetaSource>::const_iterator it =
+			station->GetMetaSources().begin(); it !=
+			station->GetMetaSources().end(); ++it) {
+
+			map<string, string>::const_iterator sURLIt =
+				it->Parameters.find("sURL");
+			if (sURLIt != it->Parameters.end()) {
+				url = sURLIt->second;
+				break;
+			}
+		}
+
+		size_t schemeEnd = url.find("://");
+		size_t hostBegin = (schemeEnd == string::npos) ? 0 : schemeEnd + 3;
+		size_t hostEnd = url.find_first_of(":/", hostBegin);
+
+		return url.substr(hostBegin, (hostEnd == string::npos) ? string::npos
+			: hostEnd - hostBegin);
+	}
+
+	size_t NowPlayingMonitor::shardOf(const string &identifier) {
+		size_t hash = 2166136261U;
+		for (string::const_iterator it = identifier.begin();
+			it != identifier.end(); ++it) {
+
+			hash = (hash ^ static_cast<unsigned char>(*it)) * 16777619U;
+		}
+
+		return hash % resultShardCount;
+	}
+
+	void NowPlayingMonitor::workerThread() {
+		HANDLE waitHandles[2] = { stopEvent, wakeEvent };
+		HTTPAbortGroup::Scope requestScope(requests);
+
+		while (WaitForSingleObject(stopEvent, 0) != WAIT_OBJECT_0) {
+			Job job;
+			DWORD wait;
+			if (!nextJob(job, wait)) {
+				WaitForMultipleObjects(2, waitHandles, FALSE, wait);
+				continue;
+			}
+
+			// A refresh may update the station meanwhile, the copy keeps
+			// the record it was taken with
+			Station station(*job.Target);
+
+			map<string, string> metaAdParam;
+			metaAdParam.insert(pair<string, string>("rStreamURL",
+				station.GetStreamURL().ToString()));
+
+			string meta;
+			bool failed = !station.FetchMeta(meta, metaAdParam);
+
+			EnterCriticalSection(&schedulerLock);
+			map<const Station*, Entry>::const_iterator it =
+				entries.find(job.Target);
+			bool current = (it != entries.end() && it->second.Generation ==
+				job.Generation);
+			if (current) {
+				job.Due = now() + interval;
+				jobs.push(job);
+			}
+			LeaveCriticalSection(&schedulerLock);
+
+			// Requests aborted by Stop fail, they mustn't replace good results
+			if (current && WaitForSingleObject(stopEvent, 0) != WAIT_OBJECT_0)
+				storeResult(&station, meta, failed);
+
+			SetEvent(wakeEvent);
+		}
+
+		if (InterlockedDecrement(&runningWorkers) == 0)
+			SetEvent(stoppedEvent);
+	}
+
+	bool NowPlayingMonitor::nextJob(Job &job, DWORD &wait) {
+		bool found = false;
+		wait = INFINITE;
+
+		EnterCriticalSection(&schedulerLock);
+
+		uint64_t time = now();
+		while (!jobs.empty()) {
+			Job top = jobs.top();
+
+			map<const Station*, Entry>::const_iterator it =
+				entries.find(top.Target);
+			if (it == entries.end() || it->second.Generation !=
+				top.Generation) {
+
+				jobs.pop();
+				continue;
+			}
+
+			if (top.Due > time) {
+				wait = static_cast<DWORD>(top.Due - time);
+				break;
+			}
+
+			jobs.pop();
+
+			uint64_t &hostNext = hostNextAllowed[it->second.Host];
+			if (hostNext > time) {
+				top.Due = hostNext;
+				jobs.push(top);
+				continue;
+			}
+
+			hostNext = time + hostInterval;
+			job = top;
+			found = true;
+			break;
+		}
+
+		LeaveCriticalSection(&schedulerLock);
+
+		return found;
+	}
+
+	void NowPlayingMonitor::storeResult(const Station *station,
+		const string &meta, bool failed) {
+
+		NowPlaying nowPlaying;
+		nowPlaying.Meta = TextCodec::ToUTF8(meta);
+		nowPlaying.Failed = failed;
+		nowPlaying.UpdatedAt = now();
+
+		string identifier = station->GetIdentifier().ToString();
+		size_t shard = shardOf(identifier);
+		EnterCriticalSection(&resultLocks[shard]);
+		results[shard][identifier] = nowPlaying;
+		LeaveCriticalSection(&resultLocks[shard]);
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef INETR_NOWPLAYINGMONITOR_HPP
+#define INETR_NOWPLAYINGMONITOR_HPP
+
+#include <cstdint>
+
+#include <list>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <Windows.h>
+
+#include "HTTP.hpp"
+#include "Station.hpp"
+
+namespace inetr {
+	struct NowPlaying {
+		// UTF-8, whatever charset the station sent
+		std::string Meta;
+		bool Failed;
+		uint64_t UpdatedAt;
+	};
+
+	// Keeps the metadata of a set of stations fresh in the background. All
+	// stations share one schedule that is worked off by a small pool of
+	// threads, requests to the same host are spaced out by hostInterval and
+	// results are kept in a sharded map that can be read at any time
+	// without waiting for network I/O.
+	class NowPlayingMonitor {
+	public:
+		NowPlayingMonitor(unsigned int workerCount = 4, unsigned int
+			interval = 30000, unsigned int hostInterval = 2000);
+		~NowPlayingMonitor();
+
+		void Start();
+		// Aborts the requests in flight instead of waiting for them
+		void Stop();
+
+		void Add(const Station *station);
+		void Remove(const Station *station);
+		void SetStations(const std::list<const Station*> &stations);
+
+		bool TryGet(const std::string &identifier, NowPlaying &out) const;
+	private:
+		struct Job {
+			uint64_t Due;
+			const Station *Target;
+			unsigned int Generation;
+		};
+
+		struct JobLater {
+			bool operator()(const Job &a, const Job &b) const {
+				return a.Due > b.Due;
+			}
+		};
+
+		struct Entry {
+			std::string Host;
+			unsigned int Generation;
+		};
+
+		static const size_t resultShardCount = 16;
+
+		static void __cdecl staticWorkerThread(void *param);
+
+		static uint64_t now();
+		static std::string hostOf(const Station *station);
+		static size_t shardOf(const std::string &identifier);
+
+		void workerThread();
+		bool nextJob(Job &job, DWORD &wait);
+		void storeResult(const Station *station, const std::string &meta,
+			bool failed);
+
+		unsigned int workerCount;
+		unsigned int interval;
+		unsigned int hostInterval;
+
+		CRITICAL_SECTION schedulerLock;
+		HANDLE wakeEvent;
+		HANDLE stopEvent;
+		HANDLE stoppedEvent;
+		volatile LONG runningWorkers;
+		bool running;
+		HTTPAbortGroup requests;
+
+		std::priority_queue<Job, std::vector<Job>, JobLater> jobs;
+		std::map<const Station*, Entry> entries;
+		std::map<std::string, uint64_t> hostNextAllowed;
+		unsigned int nextGeneration;
+
+		mutable CRITICAL_SECTION resultLocks[resultShardCount];
+		std::map<std::string, NowPlaying> results[resultShardCount];
+	};
+}
+
+#endif  // !INETR_NOWPLAYINGMONITOR_HPP
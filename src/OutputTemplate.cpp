@@ -0,0 +1,231 @@
+#include "OutputTemplate.hpp"
+
+#include <cctype>
+#include <cstdint>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+using std::map;
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace inetr {
+	namespace {
+		struct TemplateCache {
+			TemplateCache() { InitializeCriticalSection(&Lock); }
+			~TemplateCache() { DeleteCriticalSection(&Lock); }
+
+			CRITICAL_SECTION Lock;
+			unordered_map<string, OutputTemplate> Templates;
+		};
+
+		TemplateCache templateCache;
+
+		bool isNameChar(char c) {
+			return isalnum(static_cast<unsigned char>(c)) || c == '_';
+		}
+
+		// Saturates at SIZE_MAX, which no value list reaches, so an
+		// out-of-range reference makes Render fail instead of wrapping around
+		size_t appendDigit(size_t index, char digit) {
+			size_t value = static_cast<size_t>(digit - '0');
+			if (index > (SIZE_MAX - value) / 10)
+				return SIZE_MAX;
+
+			return index * 10 + value;
+		}
+	}
+
+	OutputTemplate::OutputTemplate() { }
+
+	OutputTemplate::OutputTemplate(const string &pattern) {
+		Compile(pattern);
+	}
+
+	void OutputTemplate::Compile(const string &pattern) {
+		ops.clear();
+
+		size_t pos = 0;
+		while (pos < pattern.length()) {
+			size_t dollar = pattern.find('$', pos);
+			if (dollar == string::npos) {
+				appendLiteral(pattern.c_str() + pos, pattern.length() - pos);
+				break;
+			}
+
+			appendLiteral(pattern.c_str() + pos, dollar - pos);
+			pos = dollar + 1;
+
+			if (pos == pattern.length()) {
+				appendLiteral("$", 1);
+				break;
+			}
+
+			if (pattern[pos] == '$') {
+				appendLiteral("$", 1);
+				++pos;
+				continue;
+			}
+
+			Op op;
+			op.Index = 0;
+			op.HasDefault = false;
+
+			if (isdigit(static_cast<unsigned char>(pattern[pos]))) {
+				op.Type = INETR_OTOT_Index;
+				while (pos < pattern.length() && isdigit(
+					static_cast<unsigned char>(pattern[pos])))
+					op.Index = appendDigit(op.Index, pattern[pos++]);
+
+				ops.push_back(op);
+				continue;
+			}
+
+			size_t close = (pattern[pos] == '{') ? pattern.find('}', pos) :
+				string::npos;
+			if (close == string::npos) {
+				appendLiteral("$", 1);
+				continue;
+			}
+
+			string body = pattern.substr(pos + 1, close - pos - 1);
+			size_t separator = body.find(":-");
+			string reference = body.substr(0, separator);
+
+			bool isIndex = !reference.empty();
+			bool isName = !reference.empty();
+			for (size_t i = 0; i < reference.length(); ++i) {
+				isIndex = isIndex && isdigit(static_cast<unsigned char>(
+					reference[i]));
+				isName = isName && isNameChar(reference[i]);
+			}
+
+			if (!isName) {
+				appendLiteral("$", 1);
+				continue;
+			}
+
+			if (isIndex) {
+				op.Type = INETR_OTOT_Index;
+				for (size_t i = 0; i < reference.length(); ++i)
+					op.Index = appendDigit(op.Index, reference[i]);
+			} else {
+				op.Type = INETR_OTOT_Name;
+				op.Text = reference;
+			}
+
+			if (separator != string::npos) {
+				op.HasDefault = true;
+				op.Default = body.substr(separator + 2);
+			}
+
+			ops.push_back(op);
+			pos = close + 1;
+		}
+	}
+
+	bool OutputTemplate::Render(const vector<string> &values, string &out,
+		const map<string, size_t> *names /* = nullptr */) const {
+
+		size_t length = 0;
+		for (vector<Op>::const_iterator it = ops.begin(); it != ops.end();
+			++it) {
+
+			const string *value = resolve(*it, values, names);
+			if (value == nullptr)
+				return false;
+
+			length += value->length();
+		}
+
+		out.clear();
+		out.reserve(length);
+		for (vector<Op>::const_iterator it = ops.begin(); it != ops.end();
+			++it) {
+
+			out += *resolve(*it, values, names);
+		}
+
+		return true;
+	}
+
+	const OutputTemplate &OutputTemplate::Cached(const string &pattern) {
+		const OutputTemplate *outputTemplate = nullptr;
+
+		EnterCriticalSection(&templateCache.Lock);
+
+		unordered_map<string, OutputTemplate>::const_iterator it =
+			templateCache.Templates.find(pattern);
+		if (it != templateCache.Templates.end())
+			outputTemplate = &it->second;
+
+		LeaveCriticalSection(&templateCache.Lock);
+
+		if (outputTemplate == nullptr) {
+			// Compiling allocates, threads rendering cached templates
+			// shouldn't wait for it. If another thread got there first,
+			// insert keeps its template.
+			pair<string, OutputTemplate> parsed(pattern,
+				OutputTemplate(pattern));
+
+			EnterCriticalSection(&templateCache.Lock);
+			outputTemplate = &templateCache.Templates.insert(parsed).first->
+				second;
+			LeaveCriticalSection(&templateCache.Lock);
+		}
+
+		// Elements of an unordered_map never move, so the reference stays
+		// valid after the lock is released
+		return *outputTemplate;
+	}
+
+	void OutputTemplate::appendLiteral(const char *data, size_t length) {
+		if (length == 0)
+			return;
+
+		if (!ops.empty() && ops.back().Type == INETR_OTOT_Literal) {
+			ops.back().Text.append(data, length);
+			return;
+		}
+
+		Op op;
+		op.Type = INETR_OTOT_Literal;
+		op.Index = 0;
+		op.Text.assign(data, length);
+		op.HasDefault = false;
+		ops.push_back(op);
+	}
+
+	const string *OutputTemplate::resolve(const Op &op, const vector<string>
+		&values, const map<string, size_t> *names) const {
+
+		if (op.Type == INETR_OTOT_Literal)
+			return &op.Text;
+
+		size_t index = op.Index;
+		bool known = true;
+
+		if (op.Type == INETR_OTOT_Name) {
+			map<string, size_t>::const_iterator it;
+			known = names != nullptr && (it = names->find(op.Text)) !=
+				names->end();
+			if (known)
+				index = it->second;
+		}
+
+		known = known && index < values.size();
+
+		if (known && (!op.HasDefault || !values[index].empty()))
+			return &values[index];
+
+		return op.HasDefault ? &op.Default : nullptr;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef INETR_OUTPUTTEMPLATE_HPP
+#define INETR_OUTPUTTEMPLATE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace inetr {
+	enum OutputTemplateOpType { INETR_OTOT_Literal, INETR_OTOT_Index,
+		INETR_OTOT_Name };
+
+	// An output pattern compiled into a sequence of literals and value
+	// references. Supported syntax:
+	//   $N, ${N}             value N (multi-digit)
+	//   ${name}              named value
+	//   ${N:-text}           value N, or text if it is missing or empty
+	//   $$                   a literal $
+	// A $ that starts no reference is kept literally. Rendering fails on
+	// references without a default that point past the available values.
+	class OutputTemplate {
+	public:
+		OutputTemplate();
+		explicit OutputTemplate(const std::string &pattern);
+
+		void Compile(const std::string &pattern);
+
+		bool Render(const std::vector<std::string> &values, std::string &out,
+			const std::map<std::string, size_t> *names = nullptr) const;
+
+		// Compiles each distinct pattern once per process
+		static const OutputTemplate &Cached(const std::string &pattern);
+	private:
+		struct Op {
+			OutputTemplateOpType Type;
+			size_t Index;
+			std::string Text;
+			std::string Default;
+			bool HasDefault;
+		};
+
+		void appendLiteral(const char *data, size_t length);
+		const std::string *resolve(const Op &op, const std::vector<std::string>
+			&values, const std::map<std::string, size_t> *names) const;
+
+		std::vector<Op> ops;
+	};
+}
+
+#endif  // !INETR_OUTPUTTEMPLATE_HPP
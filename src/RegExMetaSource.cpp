@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "OutputTemplate.hpp"
 #include "StringUtil.hpp"
 
 using std::cmatch;
@@ -25,9 +26,13 @@ namespace inetr {
 			itSOut == parameters.end())
 			return false;
 
-		string rIn = StringUtil::DetokenizeVectorToPattern(precedingMetaSources,
-			itSIn->second);
-		regex rx(itSRegex->second);
+		string rIn;
+		if (!StringUtil::DetokenizeVectorToPattern(precedingMetaSources,
+			itSIn->second, rIn))
+			return false;
+
+		map<string, size_t> names;
+		regex rx(stripGroupNames(itSRegex->second, names));
 		cmatch res;
 		regex_search(rIn.c_str(), res, rx);
 
@@ -36,9 +41,55 @@ namespace inetr {
 			lRes.push_back(res[i]);
 		}
 
-		out = StringUtil::DetokenizeVectorToPattern(lRes,
-			itSOut->second);
+		return OutputTemplate::Cached(itSOut->second).Render(lRes, out,
+			&names);
+	}
+
+	string RegExMetaSource::stripGroupNames(const string &pattern,
+		map<string, size_t> &names) {
+
+		string stripped;
+		stripped.reserve(pattern.length());
+
+		size_t group = 0;
+		bool inClass = false;
+
+		size_t i = 0;
+		while (i < pattern.length()) {
+			char c = pattern[i];
+
+			if (c == '\\' && i + 1 < pattern.length()) {
+				stripped.append(pattern, i, 2);
+				i += 2;
+				continue;
+			}
+
+			if (inClass) {
+				inClass = (c != ']');
+			} else if (c == '[') {
+				inClass = true;
+			} else if (c == '(') {
+				bool isNamed = pattern.compare(i, 3, "(?<") == 0 &&
+					i + 3 < pattern.length() && pattern[i + 3] != '=' &&
+					pattern[i + 3] != '!';
+				size_t close = isNamed ? pattern.find('>', i + 3) :
+					string::npos;
+
+				if (close != string::npos) {
+					names[pattern.substr(i + 3, close - i - 3)] = group++;
+					stripped += '(';
+					i = close + 1;
+					continue;
+				}
+
+				if (pattern.compare(i, 2, "(?") != 0)
+					++group;
+			}
+
+			stripped += c;
+			++i;
+		}
 
-		return true;
+		return stripped;
 	}
 }
@@ -16,6 +16,11 @@ namespace inetr {
 		bool Get(const std::map<std::string, std::string> &parameters,
 			std::vector<std::string> &precedingMetaSources, std::string &out)
 			const;
+	private:
+		// std::regex has no named groups, (?<name>...) is rewritten into a
+		// plain group and its value index recorded in names
+		static std::string stripGroupNames(const std::string &pattern,
+			std::map<std::string, size_t> &names);
 	};
 }
 
@@ -1,179 +1,134 @@
 #include "Station.hpp"
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
-#include <ShlObj.h>
 #include <Windows.h>
 
-#include "ImageUtil.hpp"
+#include "StringUtil.hpp"
 
+using std::make_shared;
+using std::map;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
 namespace inetr {
-	Station::Station(string identifier, string name, string streamURL,
-		string imagePath, vector<MetaSource> metaSources, string metaOut) {
-
-			this->Identifier = identifier;
-			this->Name = name;
-			this->StreamURL = streamURL;
-			this->MetaSources = metaSources;
-			this->MetaOut = metaOut;
-			this->imagePath = imagePath;
+	namespace {
+		// Guards the record pointers of all stations, only held to copy one
+		struct RecordLock {
+			RecordLock() { InitializeCriticalSection(&Lock); }
+			~RecordLock() { DeleteCriticalSection(&Lock); }
 
-			loadImage();
+			CRITICAL_SECTION Lock;
+		};
 
-			if (this->Image == nullptr)
-				MessageBox(nullptr, (string("Couldn't load image\n") +
-				imagePath).c_str(),	"Error", MB_ICONERROR | MB_OK);
+		RecordLock recordLock;
 	}
 
-	Station::Station(const Station &original) {
-		this->Identifier = original.Identifier;
-		this->Name = original.Name;
-		this->StreamURL = original.StreamURL;
-		this->MetaSources = original.MetaSources;
-		this->MetaOut = original.MetaOut;
-		this->imagePath = original.imagePath;
-
-		loadImage();
-
-		if (this->Image == nullptr)
-			MessageBox(nullptr, (string("Couldn't load image\n") +
-			imagePath).c_str(),	"Error", MB_ICONERROR | MB_OK);
+	const char* const Station::metaReplacements[][2] = {
+		{ "\t", "" }
+	};
+	const StringReplacer Station::metaCleaner(metaReplacements,
+		sizeof(metaReplacements) / sizeof(metaReplacements[0]));
+
+	Station::Station(string identifier, string name, string streamURL,
+		string imagePath, vector<MetaSource> metaSources, string metaOut) {
+
+		shared_ptr<Strings> strings = make_shared<Strings>();
+		strings->Identifier = std::move(identifier);
+		strings->Name = std::move(name);
+		strings->StreamURL = std::move(streamURL);
+		strings->ImagePath = std::move(imagePath);
+		strings->MetaOut = std::move(metaOut);
+
+		shared_ptr<Record> newRecord = make_shared<Record>();
+		newRecord->Identifier = strings->Identifier;
+		newRecord->Name = strings->Name;
+		newRecord->StreamURL = strings->StreamURL;
+		newRecord->ImagePath = strings->ImagePath;
+		newRecord->MetaSources = std::move(metaSources);
+		newRecord->MetaOut = strings->MetaOut;
+		newRecord->Storage = strings;
+
+		record = newRecord;
 	}
 
-	Station::Station(Station &&original) {
-		this->Identifier = original.Identifier;
-		this->Name = original.Name;
-		this->StreamURL = original.StreamURL;
-		this->MetaSources = move(original.MetaSources);
-		this->MetaOut = original.MetaOut;
-		this->imagePath = original.imagePath;
+	Station::Station(StringRef identifier, StringRef name,
+		StringRef streamURL, StringRef imagePath, vector<MetaSource>
+		metaSources, StringRef metaOut, shared_ptr<const void> storage) {
 
-		this->Image = original.Image;
+		shared_ptr<Record> newRecord = make_shared<Record>();
+		newRecord->Identifier = identifier;
+		newRecord->Name = name;
+		newRecord->StreamURL = streamURL;
+		newRecord->ImagePath = imagePath;
+		newRecord->MetaSources = std::move(metaSources);
+		newRecord->MetaOut = metaOut;
+		newRecord->Storage = std::move(storage);
 
-		original.Image = nullptr;
+		record = newRecord;
 	}
 
-	Station::~Station() {
-		if (Image != nullptr)
-			DeleteObject((HGDIOBJ)Image);
+	Station::Station(const Station &original) {
+		EnterCriticalSection(&recordLock.Lock);
+		record = original.record;
+		LeaveCriticalSection(&recordLock.Lock);
 	}
 
+	Station::Station(Station &&original) :
+		record(std::move(original.record)) { }
+
 	Station& Station::operator=(const Station &original) {
-		if (this != &original) {
-			if (this->Image != nullptr)
-				DeleteObject((HGDIOBJ)this->Image);
-
-			this->Identifier = original.Identifier;
-			this->Name = original.Name;
-			this->StreamURL = original.StreamURL;
-			this->MetaSources = original.MetaSources;
-			this->MetaOut = original.MetaOut;
-			this->imagePath = original.imagePath;
-
-			loadImage();
-
-			if (this->Image == nullptr)
-				MessageBox(nullptr, (string("Couldn't load image\n") +
-				imagePath).c_str(),	"Error", MB_ICONERROR | MB_OK);
-		}
+		// The old record is released outside the lock
+		shared_ptr<const Record> previous;
+
+		EnterCriticalSection(&recordLock.Lock);
+		previous = std::move(record);
+		record = original.record;
+		LeaveCriticalSection(&recordLock.Lock);
 
 		return *this;
 	}
 
 	Station& Station::operator=(Station &&original) {
-		if (this != &original) {
-			if (this->Image != nullptr)
-				DeleteObject((HGDIOBJ)this->Image);
-
-			this->Identifier = original.Identifier;
-			this->Name = original.Name;
-			this->StreamURL = original.StreamURL;
-			this->MetaSources = move(original.MetaSources);
-			this->MetaOut = original.MetaOut;
-			this->imagePath = original.imagePath;
+		if (this == &original)
+			return *this;
 
-			this->Image = original.Image;
+		shared_ptr<const Record> previous;
 
-			original.Image = nullptr;
-		}
+		EnterCriticalSection(&recordLock.Lock);
+		previous = std::move(record);
+		record = std::move(original.record);
+		LeaveCriticalSection(&recordLock.Lock);
 
 		return *this;
 	}
 
-	void Station::loadImage() {
-		HBITMAP hbm;
+	bool Station::FetchMeta(string &out, map<string, string>
+		&additionalParameters) const {
 
-		char appDataPath[MAX_PATH];
-		SHGetFolderPath(nullptr, CSIDL_COMMON_APPDATA, nullptr,
-			SHGFP_TYPE_CURRENT, appDataPath);
+		vector<string> metaSrcOut;
+		for (vector<MetaSource>::const_iterator it =
+			record->MetaSources.begin(); it != record->MetaSources.end();
+			++it) {
 
-		string appDataImgPath = string(appDataPath) + "\\InternetRadio\\"
-			+ imagePath;
-
-		try {
-			hbm = ImageUtil::LoadImage(appDataImgPath);
-		} catch (...) {
-			return;
-		}
+			string cMetaSrcOut;
+			if (!it->Get(metaSrcOut, cMetaSrcOut, additionalParameters))
+				return false;
 
-		BITMAP bm;
-		GetObject(hbm, sizeof(BITMAP), &bm);
-		LONG width = bm.bmWidth;
-		LONG height = bm.bmHeight;
-
-		int dWidth, dHeight;
-		double aspectRatio = static_cast<double>(width) /
-			static_cast<double>(height);
-		if (width > height) {
-			dWidth = (width > imgWH) ? imgWH : width;
-
-			dHeight = static_cast<int>(dWidth * (1.0 / aspectRatio));
-		} else if (height > width) {
-			dHeight = (height > imgWH) ? imgWH : height;
-
-			dWidth = static_cast<int>(dHeight * aspectRatio);
-		} else {
-			dWidth = (width > imgWH) ? imgWH : width;
-			dHeight = (height > imgWH) ? imgWH : height;
+			metaSrcOut.push_back(cMetaSrcOut);
 		}
 
-		int dX = (imgWH - dWidth) / 2;
-		int dY = (imgWH - dHeight) / 2;
-
-		BITMAPINFO bmInfo;
-		ZeroMemory(&bmInfo, sizeof(bmInfo));
-		bmInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-		bmInfo.bmiHeader.biWidth = imgWH;
-		bmInfo.bmiHeader.biHeight = -((LONG)imgWH);
-		bmInfo.bmiHeader.biPlanes = 1;
-		bmInfo.bmiHeader.biBitCount = 32;
-		bmInfo.bmiHeader.biCompression = BI_RGB;
-
-		HDC hDC = GetDC(nullptr);
-		HDC tmpDC = CreateCompatibleDC(hDC);
-
-		BYTE *pBase;
-		HBITMAP tmpBmp = CreateDIBSection(hDC, &bmInfo, DIB_RGB_COLORS,
-			reinterpret_cast<void**>(&pBase), nullptr, 0);
-		HGDIOBJ tmpObj = SelectObject(tmpDC, tmpBmp);
-
-		HDC dcBmp = CreateCompatibleDC(tmpDC);
-		HGDIOBJ tmpObj2 = SelectObject(dcBmp, hbm);
-		StretchBlt(tmpDC, dX, dY, dWidth, dHeight, dcBmp, 0, 0, width, height,
-			SRCCOPY);
-		SelectObject(tmpDC, tmpObj2);
-		DeleteDC(dcBmp);
-
-		DeleteObject(hbm);
-		hbm = tmpBmp;
+		if (!StringUtil::DetokenizeVectorToPattern(metaSrcOut,
+			record->MetaOut.ToString(), out))
+			return false;
 
-		SelectObject(tmpDC, tmpObj);
-		DeleteDC(tmpDC);
+		out = StringUtil::Trim(out);
+		metaCleaner.Replace(out);
 
-		Image = hbm;
+		return true;
 	}
 }
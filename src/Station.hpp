@@ -2,38 +2,76 @@
 #define INTERNETRADIO_STATION_HPP
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
-#include <Windows.h>
-
 #include "MetaSource.hpp"
+#include "StringReplacer.hpp"
+#include "StringUtil.hpp"
 
 namespace inetr {
 	class Station {
 	public:
+		// Station images are shown as ImageSize x ImageSize bitmaps
+		static const int ImageSize = 200;
+
 		Station(std::string identifier, std::string name, std::string streamURL,
 			std::string imagePath, std::vector<MetaSource> metaSources,
 			std::string metaOut);
+		// The strings stay in storage, which has to keep them alive and
+		// NUL-terminated
+		Station(StringRef identifier, StringRef name, StringRef streamURL,
+			StringRef imagePath, std::vector<MetaSource> metaSources,
+			StringRef metaOut, std::shared_ptr<const void> storage);
+		// Copies share the record of the original. Copying and assigning
+		// are safe while other threads copy the same station, so threads
+		// that don't own a station work on a copy of it.
 		Station(const Station &original);
 		Station(Station &&original);
-		~Station();
 
 		Station& operator=(const Station &original);
 		Station& operator=(Station &&original);
 
-		std::string Identifier;
-		std::string Name;
-		std::string StreamURL;
-		HBITMAP Image;
-		std::vector<MetaSource> MetaSources;
-		std::string MetaOut;
+		// Runs the meta source pipeline and renders MetaOut
+		bool FetchMeta(std::string &out, std::map<std::string, std::string>
+			&additionalParameters) const;
+
+		// All strings are NUL-terminated
+		inline StringRef GetIdentifier() const { return record->Identifier; }
+		inline StringRef GetName() const { return record->Name; }
+		inline StringRef GetStreamURL() const { return record->StreamURL; }
+		inline StringRef GetImagePath() const { return record->ImagePath; }
+		inline const std::vector<MetaSource> &GetMetaSources() const {
+			return record->MetaSources;
+		}
+		inline StringRef GetMetaOut() const { return record->MetaOut; }
 	private:
-		static const int imgWH = 200;
+		struct Strings {
+			std::string Identifier;
+			std::string Name;
+			std::string StreamURL;
+			std::string ImagePath;
+			std::string MetaOut;
+		};
+
+		struct Record {
+			StringRef Identifier;
+			StringRef Name;
+			StringRef StreamURL;
+			StringRef ImagePath;
+			std::vector<MetaSource> MetaSources;
+			StringRef MetaOut;
+			// Owns the characters referenced above, either Strings or the
+			// mapped catalog snapshot
+			std::shared_ptr<const void> Storage;
+		};
 
-		std::string imagePath;
+		static const char* const metaReplacements[][2];
+		static const StringReplacer metaCleaner;
 
-		void loadImage();
+		// Never modified once created, so copies of a station share it
+		std::shared_ptr<const Record> record;
 	};
 }
 
@@ -0,0 +1,377 @@
+#include "StationImageCache.hpp"
+
+#include <cstdint>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <process.h>
+#include <ShlObj.h>
+#include <Windows.h>
+
+#include "CatalogSnapshot.hpp"
+#include "ImageScaler.hpp"
+#include "ImageUtil.hpp"
+#include "MappedFile.hpp"
+#include "StringUtil.hpp"
+
+using std::list;
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+namespace inetr {
+	StationImageCache::StationImageCache(size_t budget /* = defaultBudget */,
+		unsigned int workers /* = 0 */)
+		: thumbnails(dataPath() + "\\thumbnails.bin") {
+
+		this->budget = budget;
+		size = 0;
+
+		displayed = nullptr;
+
+		if (workers == 0) {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			workers = systemInfo.dwNumberOfProcessors;
+		}
+		this->workers = (workers > 0) ? workers : 1;
+
+		activeWorkers = 0;
+		stopping = false;
+		idleEvent = CreateEvent(nullptr, TRUE, TRUE, nullptr);
+		decodedEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+		InitializeCriticalSection(&lock);
+	}
+
+	StationImageCache::~StationImageCache() {
+		EnterCriticalSection(&lock);
+		stopping = true;
+		LeaveCriticalSection(&lock);
+
+		// The last prefetch worker signals while holding the lock, entering
+		// it once more makes sure it has let go
+		WaitForSingleObject(idleEvent, INFINITE);
+		EnterCriticalSection(&lock);
+		LeaveCriticalSection(&lock);
+
+		thumbnails.Save();
+
+		displayed = nullptr;
+		Clear();
+		for (vector<HBITMAP>::const_iterator it = released.begin();
+			it != released.end(); ++it) {
+
+			DeleteObject((HGDIOBJ)*it);
+		}
+
+		CloseHandle(decodedEvent);
+		CloseHandle(idleEvent);
+		DeleteCriticalSection(&lock);
+	}
+
+	HBITMAP StationImageCache::Get(const Station *station) {
+		EnterCriticalSection(&lock);
+
+		for (vector<HBITMAP>::const_iterator it = released.begin();
+			it != released.end(); ++it) {
+
+			DeleteObject((HGDIOBJ)*it);
+		}
+		released.clear();
+
+		if (station == nullptr) {
+			displayed = nullptr;
+			LeaveCriticalSection(&lock);
+			return nullptr;
+		}
+
+		string imagePath = station->GetImagePath().ToString();
+		while (decoding.find(imagePath) != decoding.end()) {
+			ResetEvent(decodedEvent);
+			LeaveCriticalSection(&lock);
+			WaitForSingleObject(decodedEvent, INFINITE);
+			EnterCriticalSection(&lock);
+		}
+
+		unordered_map<string, Entry>::iterator it = entries.find(imagePath);
+		if (it != entries.end()) {
+			uses.splice(uses.begin(), uses, it->second.Use);
+			displayed = it->second.Image;
+			LeaveCriticalSection(&lock);
+			return displayed;
+		}
+
+		// Keeps the workers off this image while it is decoded here
+		decoding.insert(imagePath);
+		LeaveCriticalSection(&lock);
+
+		HBITMAP image = load(imagePath);
+
+		EnterCriticalSection(&lock);
+		decoding.erase(imagePath);
+		if (image == nullptr) {
+			displayed = nullptr;
+			bool report = reportedFailures.insert(imagePath).second;
+			LeaveCriticalSection(&lock);
+
+			if (report)
+				MessageBox(nullptr, (string("Couldn't load image\n") +
+					imagePath).c_str(), "Error", MB_ICONERROR | MB_OK);
+
+			return nullptr;
+		}
+
+		evict(sizeOf(image));
+		insert(imagePath, image, true);
+		displayed = image;
+
+		LeaveCriticalSection(&lock);
+
+		return image;
+	}
+
+	void StationImageCache::Prefetch(const list<const Station*> &stations) {
+		list<string> imagePaths;
+		for (list<const Station*>::const_iterator it = stations.begin();
+			it != stations.end(); ++it) {
+
+			imagePaths.push_back((*it)->GetImagePath().ToString());
+		}
+
+		EnterCriticalSection(&lock);
+		prefetchQueue.swap(imagePaths);
+
+		// Workers that are still busy take from the new queue as well
+		unsigned int start = 0;
+		if (!stopping) {
+			unsigned int wanted = (prefetchQueue.size() < workers) ?
+				static_cast<unsigned int>(prefetchQueue.size()) : workers;
+			if (wanted > activeWorkers) {
+				start = wanted - activeWorkers;
+				activeWorkers = wanted;
+				ResetEvent(idleEvent);
+			}
+		}
+		LeaveCriticalSection(&lock);
+
+		for (unsigned int i = 0; i < start; ++i)
+			_beginthread(staticPrefetchThread, 0,
+				reinterpret_cast<void*>(this));
+	}
+
+	void StationImageCache::Clear() {
+		EnterCriticalSection(&lock);
+
+		for (unordered_map<string, Entry>::const_iterator it =
+			entries.begin(); it != entries.end(); ++it) {
+
+			release(it->second.Image);
+		}
+		entries.clear();
+		uses.clear();
+		size = 0;
+
+		reportedFailures.clear();
+
+		LeaveCriticalSection(&lock);
+	}
+
+	void StationImageCache::Invalidate(const vector<string> &imagePaths) {
+		unordered_set<string> invalid;
+		for (vector<string>::const_iterator it = imagePaths.begin();
+			it != imagePaths.end(); ++it) {
+
+			invalid.insert(normalizePath(*it));
+		}
+
+		EnterCriticalSection(&lock);
+
+		unordered_map<string, Entry>::iterator it = entries.begin();
+		while (it != entries.end()) {
+			if (invalid.find(normalizePath(it->first)) == invalid.end()) {
+				++it;
+				continue;
+			}
+
+			size -= it->second.Size;
+			release(it->second.Image);
+			uses.erase(it->second.Use);
+			it = entries.erase(it);
+		}
+
+		for (unordered_set<string>::iterator failure =
+			reportedFailures.begin(); failure != reportedFailures.end(); ) {
+
+			if (invalid.find(normalizePath(*failure)) != invalid.end())
+				failure = reportedFailures.erase(failure);
+			else
+				++failure;
+		}
+
+		LeaveCriticalSection(&lock);
+	}
+
+	void StationImageCache::SetBudget(size_t budget) {
+		EnterCriticalSection(&lock);
+		this->budget = budget;
+		evict(0);
+		LeaveCriticalSection(&lock);
+	}
+
+	size_t StationImageCache::GetSize() const {
+		EnterCriticalSection(&lock);
+		size_t currentSize = size;
+		LeaveCriticalSection(&lock);
+
+		return currentSize;
+	}
+
+	void __cdecl StationImageCache::staticPrefetchThread(void *param) {
+		StationImageCache *parent = reinterpret_cast<StationImageCache*>(
+			param);
+		if (parent)
+			parent->prefetchThread();
+	}
+
+	string StationImageCache::dataPath() {
+		char appDataPath[MAX_PATH];
+		SHGetFolderPath(nullptr, CSIDL_COMMON_APPDATA, nullptr,
+			SHGFP_TYPE_CURRENT, appDataPath);
+
+		return string(appDataPath) + "\\InternetRadio";
+	}
+
+	string StationImageCache::normalizePath(const string &path) {
+		string normalized = path;
+		StringUtil::SearchAndReplace(normalized, "/", "\\");
+
+		return normalized;
+	}
+
+	HBITMAP StationImageCache::load(const string &imagePath) {
+		string appDataImgPath = dataPath() + "\\" + imagePath;
+
+		// Hashing the file is much cheaper than decoding it
+		uint64_t contentHash;
+		{
+			MappedFile imageFile(appDataImgPath);
+			if (!imageFile.IsOpen())
+				return nullptr;
+
+			contentHash = CatalogSnapshot::Hash(imageFile.GetData(),
+				imageFile.GetSize());
+		}
+
+		const uint32_t *pixels = thumbnails.Find(contentHash,
+			Station::ImageSize);
+		if (pixels != nullptr)
+			return ImageUtil::CreateBitmap(Station::ImageSize,
+				Station::ImageSize, pixels);
+
+		PixelImage source, thumbnail;
+		try {
+			ImageUtil::LoadPixels(appDataImgPath, source);
+		} catch (...) {
+			return nullptr;
+		}
+
+		ImageScaler::Letterbox(source, Station::ImageSize, INETR_SF_Lanczos,
+			thumbnail);
+		thumbnails.Add(contentHash, Station::ImageSize, imagePath,
+			thumbnail.Pixels);
+
+		return ImageUtil::CreateBitmap(thumbnail.Width, thumbnail.Height,
+			&thumbnail.Pixels[0]);
+	}
+
+	size_t StationImageCache::sizeOf(HBITMAP image) {
+		BITMAP bm;
+		if (GetObject(image, sizeof(BITMAP), &bm) == 0)
+			return 0;
+
+		return static_cast<size_t>(bm.bmWidthBytes) *
+			static_cast<size_t>(bm.bmHeight);
+	}
+
+	void StationImageCache::prefetchThread() {
+		// The image decoders are COM objects
+		CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+		for (;;) {
+			EnterCriticalSection(&lock);
+			if (stopping || prefetchQueue.empty() || size >= budget) {
+				if (--activeWorkers == 0)
+					SetEvent(idleEvent);
+				LeaveCriticalSection(&lock);
+				break;
+			}
+
+			string imagePath = prefetchQueue.front();
+			prefetchQueue.pop_front();
+			bool skip = entries.find(imagePath) != entries.end() ||
+				!decoding.insert(imagePath).second;
+			LeaveCriticalSection(&lock);
+
+			if (skip)
+				continue;
+
+			HBITMAP image = load(imagePath);
+
+			// Prefetching never evicts, images that were actually shown are
+			// worth more than the ones that might be
+			EnterCriticalSection(&lock);
+			decoding.erase(imagePath);
+			SetEvent(decodedEvent);
+			if (image != nullptr && size + sizeOf(image) <= budget) {
+				insert(imagePath, image, false);
+				image = nullptr;
+			}
+			LeaveCriticalSection(&lock);
+
+			if (image != nullptr)
+				DeleteObject((HGDIOBJ)image);
+		}
+
+		CoUninitialize();
+	}
+
+	void StationImageCache::insert(const string &imagePath, HBITMAP image,
+		bool recentlyUsed) {
+
+		Entry entry;
+		entry.Image = image;
+		entry.Size = sizeOf(image);
+		entry.Use = uses.insert(recentlyUsed ? uses.begin() : uses.end(),
+			imagePath);
+
+		entries.insert(pair<string, Entry>(imagePath, entry));
+		size += entry.Size;
+	}
+
+	void StationImageCache::evict(size_t reserve) {
+		while (!uses.empty() && size + reserve > budget) {
+			unordered_map<string, Entry>::iterator it =
+				entries.find(uses.back());
+
+			size -= it->second.Size;
+			release(it->second.Image);
+			entries.erase(it);
+			uses.pop_back();
+		}
+	}
+
+	void StationImageCache::release(HBITMAP image) {
+		if (image == displayed)
+			released.push_back(image);
+		else
+			DeleteObject((HGDIOBJ)image);
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef INETR_STATIONIMAGECACHE_HPP
+#define INETR_STATIONIMAGECACHE_HPP
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Windows.h>
+
+#include "Station.hpp"
+#include "ThumbnailPack.hpp"
+
+namespace inetr {
+	// Decodes station images when they are first shown and keeps the most
+	// recently used ones within a memory budget. Finished thumbnails are
+	// kept on disk so later starts skip decoding and scaling. Images of the
+	// stations passed to Prefetch are decoded by one background worker per
+	// core, roughly in the given order, until the budget is used up.
+	class StationImageCache {
+	public:
+		static const size_t defaultBudget = 8 * 1024 * 1024;
+
+		StationImageCache(size_t budget = defaultBudget,
+			unsigned int workers = 0);
+		~StationImageCache();
+
+		// Must be called from the UI thread. The bitmap belongs to the cache
+		// and stays valid until the next call to Get. An image a worker is
+		// decoding already is waited for rather than decoded again.
+		HBITMAP Get(const Station *station);
+		void Prefetch(const std::list<const Station*> &stations);
+		// Drops every image, for when the files on disk have been replaced
+		void Clear();
+		// Drops the images of the given files only, paths are relative to
+		// the data directory like the stations' image paths
+		void Invalidate(const std::vector<std::string> &imagePaths);
+
+		void SetBudget(size_t budget);
+		inline size_t GetBudget() const { return budget; }
+		size_t GetSize() const;
+	private:
+		struct Entry {
+			HBITMAP Image;
+			size_t Size;
+			std::list<std::string>::iterator Use;
+		};
+
+		StationImageCache(const StationImageCache &);
+		StationImageCache &operator=(const StationImageCache &);
+
+		static void __cdecl staticPrefetchThread(void *param);
+
+		static std::string dataPath();
+		static std::string normalizePath(const std::string &path);
+		static size_t sizeOf(HBITMAP image);
+
+		HBITMAP load(const std::string &imagePath);
+		void prefetchThread();
+		void insert(const std::string &imagePath, HBITMAP image,
+			bool recentlyUsed);
+		void evict(size_t reserve);
+		void release(HBITMAP image);
+
+		size_t budget;
+		size_t size;
+
+		// Most recently used first
+		std::list<std::string> uses;
+		std::unordered_map<std::string, Entry> entries;
+		std::unordered_set<std::string> reportedFailures;
+
+		ThumbnailPack thumbnails;
+
+		// The image last handed out by Get may still be shown, it is deleted
+		// only once the next Get has given out a replacement
+		HBITMAP displayed;
+		std::vector<HBITMAP> released;
+
+		unsigned int workers;
+		std::list<std::string> prefetchQueue;
+		std::unordered_set<std::string> decoding;
+		unsigned int activeWorkers;
+		bool stopping;
+		HANDLE idleEvent;
+		HANDLE decodedEvent;
+
+		mutable CRITICAL_SECTION lock;
+	};
+}
+
+#endif  // !INETR_STATIONIMAGECACHE_HPP
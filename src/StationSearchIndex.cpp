@@ -0,0 +1,496 @@
+#include "StationSearchIndex.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::min;
+using std::pair;
+using std::sort;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace inetr {
+	StationSearchIndex::StationSearchIndex() {
+		Clear();
+	}
+
+	void StationSearchIndex::Add(const Station *station) {
+		if (documentIds.find(station) != documentIds.end())
+			return;
+
+		uint32_t id = static_cast<uint32_t>(documents.size());
+
+		Document document;
+		document.Target = station;
+		document.Text = documentText(station);
+		tokenize(document.Text, document.Words);
+		documents.push_back(document);
+		documentIds.insert(pair<const Station*, uint32_t>(station, id));
+
+		seen.push_back(0);
+		trigramHits.push_back(0);
+
+		const vector<string> &words = documents.back().Words;
+		vector<uint32_t> grams;
+		for (vector<string>::const_iterator it = words.begin();
+			it != words.end(); ++it) {
+
+			insertWord(*it, id);
+
+			trigramsOf(*it, grams);
+			for (vector<uint32_t>::const_iterator gramIt = grams.begin();
+				gramIt != grams.end(); ++gramIt) {
+
+				vector<uint32_t> &postings = trigrams[*gramIt];
+				if (postings.empty() || postings.back() != id)
+					postings.push_back(id);
+			}
+		}
+	}
+
+	void StationSearchIndex::Remove(const Station *station) {
+		unordered_map<const Station*, uint32_t>::iterator it =
+			documentIds.find(station);
+		if (it == documentIds.end())
+			return;
+
+		// Trigram postings are cleaned up lazily by compact
+		Document &document = documents[it->second];
+		for (vector<string>::const_iterator wordIt = document.Words.begin();
+			wordIt != document.Words.end(); ++wordIt) {
+
+			removeWord(*wordIt, it->second);
+		}
+		document.Target = nullptr;
+		document.Text.clear();
+		document.Words.clear();
+
+		documentIds.erase(it);
+		++removedCount;
+
+		if (removedCount > 64 && removedCount * 2 > documents.size())
+			compact();
+	}
+
+	void StationSearchIndex::Update(const Station *station) {
+		unordered_map<const Station*, uint32_t>::const_iterator it =
+			documentIds.find(station);
+
+		if (it != documentIds.end()) {
+			if (documents[it->second].Text == documentText(station))
+				return;
+
+			Remove(station);
+		}
+
+		Add(station);
+	}
+
+	void StationSearchIndex::Clear() {
+		documents.clear();
+		documentIds.clear();
+		removedCount = 0;
+
+		trie.clear();
+		trie.push_back(TrieNode());
+		trigrams.clear();
+
+		seen.clear();
+		seenGeneration = 0;
+		trigramHits.clear();
+	}
+
+	size_t StationSearchIndex::Search(const string &query, size_t maxResults,
+		vector<const Station*> &out) const {
+
+		vector<string> words;
+		tokenize(query, words);
+		if (words.empty() || maxResults == 0)
+			return 0;
+
+		vector<uint32_t> exact, matches;
+
+		if (words.size() == 1) {
+			// A single word needs no intersection, so the prefix walk can
+			// stop as soon as there are enough results
+			markSeen(UINT32_MAX);
+			prefixMatches(words[0], maxResults, exact);
+			sort(exact.begin(), exact.end());
+			if (exact.size() < maxResults)
+				fuzzyMatches(words[0], matches);
+
+			matches.insert(matches.begin(), exact.begin(), exact.end());
+		} else {
+			for (size_t i = 0; i < words.size(); ++i) {
+				vector<uint32_t> wordExact, wordMatches;
+				markSeen(UINT32_MAX);
+				prefixMatches(words[i], SIZE_MAX, wordExact);
+				sort(wordExact.begin(), wordExact.end());
+				fuzzyMatches(words[i], wordMatches);
+
+				vector<uint32_t> wordAll(wordExact.size() +
+					wordMatches.size());
+				std::merge(wordExact.begin(), wordExact.end(),
+					wordMatches.begin(), wordMatches.end(), wordAll.begin());
+
+				if (i == 0) {
+					exact.swap(wordExact);
+					matches.swap(wordAll);
+					continue;
+				}
+
+				vector<uint32_t> intersection;
+				std::set_intersection(exact.begin(), exact.end(),
+					wordExact.begin(), wordExact.end(),
+					std::back_inserter(intersection));
+				exact.swap(intersection);
+
+				intersection.clear();
+				std::set_intersection(matches.begin(), matches.end(),
+					wordAll.begin(), wordAll.end(),
+					std::back_inserter(intersection));
+				matches.swap(intersection);
+			}
+
+			vector<uint32_t> fuzzy;
+			std::set_difference(matches.begin(), matches.end(),
+				exact.begin(), exact.end(), std::back_inserter(fuzzy));
+			matches.swap(exact);
+			matches.insert(matches.end(), fuzzy.begin(), fuzzy.end());
+		}
+
+		size_t count = min(matches.size(), maxResults);
+		for (size_t i = 0; i < count; ++i)
+			out.push_back(documents[matches[i]].Target);
+
+		return count;
+	}
+
+	string StationSearchIndex::documentText(const Station *station) {
+		return station->GetName().ToString() + "\n" +
+			station->GetIdentifier().ToString();
+	}
+
+	void StationSearchIndex::tokenize(const string &text,
+		vector<string> &words) {
+
+		// Lowercases ASCII, any other byte is part of a word so UTF-8
+		// sequences stay intact
+		string word;
+		for (string::const_iterator it = text.begin(); it != text.end();
+			++it) {
+
+			unsigned char c = static_cast<unsigned char>(*it);
+			if (c >= 'A' && c <= 'Z') {
+				word += static_cast<char>(c - 'A' + 'a');
+			} else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+				c >= 0x80) {
+
+				word += static_cast<char>(c);
+			} else if (!word.empty()) {
+				words.push_back(word);
+				word.clear();
+			}
+		}
+
+		if (!word.empty())
+			words.push_back(word);
+	}
+
+	void StationSearchIndex::trigramsOf(const string &word,
+		vector<uint32_t> &out) {
+
+		// Two leading markers anchor the first characters, the end is left
+		// open so that a trigram set of a prefix is a subset of the word's
+		out.clear();
+		uint32_t gram = 0x0101;
+		for (string::const_iterator it = word.begin(); it != word.end();
+			++it) {
+
+			gram = ((gram << 8) | static_cast<unsigned char>(*it)) &
+				0xFFFFFF;
+			out.push_back(gram);
+		}
+	}
+
+	size_t StationSearchIndex::maxEdits(size_t length) {
+		if (length < 4)
+			return 0;
+		if (length < 7)
+			return 1;
+
+		return 2;
+	}
+
+	bool StationSearchIndex::fuzzyPrefixMatch(const string &query,
+		const string &word, size_t maxEdits) {
+
+		// Edit distance between query and the closest prefix of word, one
+		// row per query character
+		vector<size_t> previous(word.length() + 1), current(word.length() +
+			1);
+		for (size_t j = 0; j <= word.length(); ++j)
+			previous[j] = j;
+
+		for (size_t i = 1; i <= query.length(); ++i) {
+			current[0] = i;
+			size_t rowMin = current[0];
+
+			for (size_t j = 1; j <= word.length(); ++j) {
+				size_t cost = (query[i - 1] == word[j - 1]) ? 0 : 1;
+				current[j] = min(min(previous[j] + 1, current[j - 1] + 1),
+					previous[j - 1] + cost);
+				rowMin = min(rowMin, current[j]);
+			}
+
+			if (rowMin > maxEdits)
+				return false;
+
+			previous.swap(current);
+		}
+
+		for (size_t j = 0; j <= word.length(); ++j) {
+			if (previous[j] <= maxEdits)
+				return true;
+		}
+
+		return false;
+	}
+
+	void StationSearchIndex::insertWord(const string &word, uint32_t document) {
+		uint32_t node = 0;
+		size_t pos = 0;
+
+		// Nodes are referred to by index, trie may reallocate on insertion
+		while (pos < word.length()) {
+			uint32_t child = UINT32_MAX;
+			for (vector<uint32_t>::const_iterator it =
+				trie[node].Children.begin(); it != trie[node].Children.end();
+				++it) {
+
+				if (trie[*it].Label[0] == word[pos]) {
+					child = *it;
+					break;
+				}
+			}
+
+			if (child == UINT32_MAX) {
+				TrieNode leaf;
+				leaf.Label = word.substr(pos);
+				trie.push_back(leaf);
+				trie[node].Children.push_back(static_cast<uint32_t>(
+					trie.size() - 1));
+
+				node = static_cast<uint32_t>(trie.size() - 1);
+				pos = word.length();
+				break;
+			}
+
+			const string &label = trie[child].Label;
+			size_t common = 0;
+			while (common < label.length() && pos + common < word.length() &&
+				label[common] == word[pos + common])
+				++common;
+
+			if (common < label.length()) {
+				// Split the edge, the new node takes over the shared part
+				TrieNode middle;
+				middle.Label = label.substr(0, common);
+				middle.Children.push_back(child);
+				trie[child].Label.erase(0, common);
+				trie.push_back(middle);
+
+				uint32_t middleId = static_cast<uint32_t>(trie.size() - 1);
+				std::replace(trie[node].Children.begin(),
+					trie[node].Children.end(), child, middleId);
+				child = middleId;
+			}
+
+			node = child;
+			pos += common;
+		}
+
+		vector<uint32_t> &nodeDocuments = trie[node].Documents;
+		if (nodeDocuments.empty() || nodeDocuments.back() != document)
+			nodeDocuments.push_back(document);
+	}
+
+	void StationSearchIndex::removeWord(const string &word, uint32_t document) {
+		uint32_t node = 0;
+		size_t pos = 0;
+
+		while (pos < word.length()) {
+			uint32_t child = UINT32_MAX;
+			for (vector<uint32_t>::const_iterator it =
+				trie[node].Children.begin(); it != trie[node].Children.end();
+				++it) {
+
+				if (trie[*it].Label[0] == word[pos]) {
+					child = *it;
+					break;
+				}
+			}
+
+			if (child == UINT32_MAX || word.compare(pos,
+				trie[child].Label.length(), trie[child].Label) != 0)
+				return;
+
+			pos += trie[child].Label.length();
+			node = child;
+		}
+
+		vector<uint32_t> &nodeDocuments = trie[node].Documents;
+		nodeDocuments.erase(std::remove(nodeDocuments.begin(),
+			nodeDocuments.end(), document), nodeDocuments.end());
+	}
+
+	void StationSearchIndex::prefixMatches(const string &prefix, size_t limit,
+		vector<uint32_t> &out) const {
+
+		uint32_t node = 0;
+		size_t pos = 0;
+
+		while (pos < prefix.length()) {
+			uint32_t child = UINT32_MAX;
+			for (vector<uint32_t>::const_iterator it =
+				trie[node].Children.begin(); it != trie[node].Children.end();
+				++it) {
+
+				if (trie[*it].Label[0] == prefix[pos]) {
+					child = *it;
+					break;
+				}
+			}
+
+			if (child == UINT32_MAX)
+				return;
+
+			// The prefix may end in the middle of an edge
+			const string &label = trie[child].Label;
+			size_t length = min(label.length(), prefix.length() - pos);
+			if (prefix.compare(pos, length, label, 0, length) != 0)
+				return;
+
+			pos += length;
+			node = child;
+		}
+
+		vector<uint32_t> pending(1, node);
+		while (!pending.empty() && out.size() < limit) {
+			const TrieNode &current = trie[pending.back()];
+			pending.pop_back();
+
+			for (vector<uint32_t>::const_iterator it =
+				current.Documents.begin(); it != current.Documents.end() &&
+				out.size() < limit; ++it) {
+
+				if (markSeen(*it))
+					out.push_back(*it);
+			}
+
+			pending.insert(pending.end(), current.Children.begin(),
+				current.Children.end());
+		}
+	}
+
+	void StationSearchIndex::fuzzyMatches(const string &word,
+		vector<uint32_t> &out) const {
+
+		size_t edits = maxEdits(word.length());
+		if (edits == 0)
+			return;
+
+		// Every edit changes at most three trigrams of the word
+		vector<uint32_t> grams;
+		trigramsOf(word, grams);
+		size_t threshold = (grams.size() > 3 * edits + 1) ?
+			grams.size() - 3 * edits : 1;
+
+		vector<uint32_t> touched;
+		for (vector<uint32_t>::const_iterator it = grams.begin();
+			it != grams.end(); ++it) {
+
+			unordered_map<uint32_t, vector<uint32_t> >::const_iterator
+				postings = trigrams.find(*it);
+			if (postings == trigrams.end())
+				continue;
+
+			for (vector<uint32_t>::const_iterator docIt =
+				postings->second.begin(); docIt != postings->second.end();
+				++docIt) {
+
+				if (trigramHits[*docIt] == 0)
+					touched.push_back(*docIt);
+				if (trigramHits[*docIt] < UINT16_MAX)
+					++trigramHits[*docIt];
+			}
+		}
+
+		for (vector<uint32_t>::const_iterator it = touched.begin();
+			it != touched.end(); ++it) {
+
+			const Document &document = documents[*it];
+			bool candidate = trigramHits[*it] >= threshold &&
+				document.Target != nullptr && seen[*it] != seenGeneration;
+			trigramHits[*it] = 0;
+
+			if (!candidate)
+				continue;
+
+			for (vector<string>::const_iterator wordIt =
+				document.Words.begin(); wordIt != document.Words.end();
+				++wordIt) {
+
+				if (fuzzyPrefixMatch(word, *wordIt, edits)) {
+					markSeen(*it);
+					out.push_back(*it);
+					break;
+				}
+			}
+		}
+
+		sort(out.begin(), out.end());
+	}
+
+	bool StationSearchIndex::markSeen(uint32_t document) const {
+		// UINT32_MAX starts a new round, which clears all marks at once
+		if (document == UINT32_MAX) {
+			if (++seenGeneration == 0) {
+				std::fill(seen.begin(), seen.end(), 0);
+				seenGeneration = 1;
+			}
+			return true;
+		}
+
+		if (documents[document].Target == nullptr ||
+			seen[document] == seenGeneration)
+			return false;
+
+		seen[document] = seenGeneration;
+		return true;
+	}
+
+	void StationSearchIndex::compact() {
+		vector<const Station*> live;
+		live.reserve(documentIds.size());
+		for (vector<Document>::const_iterator it = documents.begin();
+			it != documents.end(); ++it) {
+
+			if (it->Target != nullptr)
+				live.push_back(it->Target);
+		}
+
+		Clear();
+		for (vector<const Station*>::const_iterator it = live.begin();
+			it != live.end(); ++it) {
+
+			Add(*it);
+		}
+	}
+}
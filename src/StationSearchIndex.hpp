@@ -0,0 +1,77 @@
+#ifndef INETR_STATIONSEARCHINDEX_HPP
+#define INETR_STATIONSEARCHINDEX_HPP
+
+#include <cstdint>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Station.hpp"
+
+namespace inetr {
+	// Type-ahead search over station names and identifiers. Every word is
+	// stored in a compressed trie for prefix lookups and split into trigrams
+	// whose posting lists narrow typo-tolerant lookups down to a few
+	// candidates, which are then checked by edit distance. Stations can be
+	// added, updated and removed at any time.
+	class StationSearchIndex {
+	public:
+		StationSearchIndex();
+
+		void Add(const Station *station);
+		void Remove(const Station *station);
+		// Reindexes a station if its name or identifier changed
+		void Update(const Station *station);
+		void Clear();
+
+		// Appends up to maxResults stations that match every word of query,
+		// stations matching by prefix before those matching with typos
+		size_t Search(const std::string &query, size_t maxResults,
+			std::vector<const Station*> &out) const;
+	private:
+		struct Document {
+			const Station *Target;
+			std::string Text;
+			std::vector<std::string> Words;
+		};
+
+		struct TrieNode {
+			std::string Label;
+			std::vector<uint32_t> Children;
+			std::vector<uint32_t> Documents;
+		};
+
+		static std::string documentText(const Station *station);
+		static void tokenize(const std::string &text,
+			std::vector<std::string> &words);
+		static void trigramsOf(const std::string &word,
+			std::vector<uint32_t> &out);
+		static size_t maxEdits(size_t length);
+		static bool fuzzyPrefixMatch(const std::string &query,
+			const std::string &word, size_t maxEdits);
+
+		void insertWord(const std::string &word, uint32_t document);
+		void removeWord(const std::string &word, uint32_t document);
+		void prefixMatches(const std::string &prefix, size_t limit,
+			std::vector<uint32_t> &out) const;
+		void fuzzyMatches(const std::string &word,
+			std::vector<uint32_t> &out) const;
+		bool markSeen(uint32_t document) const;
+		void compact();
+
+		std::vector<Document> documents;
+		std::unordered_map<const Station*, uint32_t> documentIds;
+		size_t removedCount;
+
+		std::vector<TrieNode> trie;
+		std::unordered_map<uint32_t, std::vector<uint32_t> > trigrams;
+
+		// Scratch space of Search, sized to the documents
+		mutable std::vector<uint32_t> seen;
+		mutable uint32_t seenGeneration;
+		mutable std::vector<uint16_t> trigramHits;
+	};
+}
+
+#endif  // !INETR_STATIONSEARCHINDEX_HPP
@@ -1,13 +1,15 @@
 #include "Stations.hpp"
 
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
-#include <algorithm>
 #include <fstream>
 #include <list>
 #include <map>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -15,17 +17,22 @@
 
 #include <json/json.h>
 
-#include "CryptUtil.hpp"
+#include "AssetSync.hpp"
+#include "CatalogSnapshot.hpp"
+#include "FileHashCache.hpp"
 #include "HTTP.hpp"
+#include "JSONPullParser.hpp"
+#include "MappedFile.hpp"
 #include "StringUtil.hpp"
 #include "VersionUtil.hpp"
 
 #include "HTMLFixMetaSource.hpp"
+#include "HTMLSelectorMetaSource.hpp"
 #include "HTTPMetaSource.hpp"
+#include "JSONPathMetaSource.hpp"
 #include "MetaMetaSource.hpp"
 #include "RegExMetaSource.hpp"
 
-using std::find_if;
 using std::ifstream;
 using std::ios;
 using std::list;
@@ -34,17 +41,24 @@ using std::ofstream;
 using std::pair;
 using std::string;
 using std::stringstream;
+using std::unordered_map;
 using std::vector;
-using Json::nullValue;
 using Json::Reader;
 using Json::Value;
 
 namespace inetr {
 	Stations::Stations() {
-		MetaSourcePrototypes.push_back(new MetaMetaSource());
-		MetaSourcePrototypes.push_back(new HTTPMetaSource());
-		MetaSourcePrototypes.push_back(new RegExMetaSource());
-		MetaSourcePrototypes.push_back(new HTMLFixMetaSource());
+		memset(&loadedCatalogStamp, 0, sizeof(loadedCatalogStamp));
+		memset(&failedCatalogStamp, 0, sizeof(failedCatalogStamp));
+		showErrors = true;
+		cancelled = 0;
+
+		addMetaSourcePrototype(new MetaMetaSource());
+		addMetaSourcePrototype(new HTTPMetaSource());
+		addMetaSourcePrototype(new RegExMetaSource());
+		addMetaSourcePrototype(new HTMLFixMetaSource());
+		addMetaSourcePrototype(new JSONPathMetaSource());
+		addMetaSourcePrototype(new HTMLSelectorMetaSource());
 	}
 
 	Stations::~Stations() {
@@ -57,11 +71,118 @@ namespace inetr {
 	}
 
 	bool Stations::Load() {
+		uint16_t installedVersion[4];
+		VersionUtil::GetInstalledVersion(installedVersion);
+
+		if (!loadCatalog(installedVersion, stations, false))
+			return false;
+
+		indexStations();
+
+		return true;
+	}
+
+	bool Stations::Refresh(list<Station> &out, bool showErrors /* = true */,
+		vector<string> *changedFiles /* = nullptr */) {
+
+		uint16_t installedVersion[4];
+		VersionUtil::GetInstalledVersion(installedVersion);
+
+		sync(installedVersion, changedFiles);
+		if (cancelled != 0)
+			return false;
+
+		this->showErrors = showErrors;
+		bool loaded = loadCatalog(installedVersion, out, true);
+		this->showErrors = true;
+
+		return loaded;
+	}
+
+	void Stations::Cancel() {
+		InterlockedExchange(&cancelled, 1);
+	}
+
+	void Stations::Merge(list<Station> &fresh) {
+		// Both lists are sorted by identifier. Known stations are updated in
+		// place so that pointers to them stay valid, stations that are gone
+		// from the fresh catalog are kept until the next start for the same
+		// reason.
+		list<Station>::iterator it = stations.begin();
+		while (!fresh.empty()) {
+			Station &freshStation = fresh.front();
+			while (it != stations.end() && it->GetIdentifier() <
+				freshStation.GetIdentifier())
+				++it;
+
+			if (it != stations.end() && it->GetIdentifier() ==
+				freshStation.GetIdentifier()) {
+
+				*it = std::move(freshStation);
+				fresh.pop_front();
+				++it;
+			} else {
+				stationIndex[freshStation.GetIdentifier().ToString()] =
+					&freshStation;
+				stations.splice(it, fresh, fresh.begin());
+			}
+		}
+	}
+
+	const Station *Stations::Find(const string &identifier) const {
+		unordered_map<string, const Station*>::const_iterator it =
+			stationIndex.find(identifier);
+
+		return (it != stationIndex.end()) ? it->second : nullptr;
+	}
+
+	MetaSourcePrototype *Stations::FindMetaSourcePrototype(
+		const string &identifier) const {
+
+		unordered_map<string, MetaSourcePrototype*>::const_iterator it =
+			metaSourcePrototypeIndex.find(identifier);
+
+		return (it != metaSourcePrototypeIndex.end()) ? it->second : nullptr;
+	}
+
+	void Stations::addMetaSourcePrototype(MetaSourcePrototype *prototype) {
+		MetaSourcePrototypes.push_back(prototype);
+		metaSourcePrototypeIndex.insert(pair<string, MetaSourcePrototype*>(
+			prototype->GetIdentifer(), prototype));
+	}
+
+	void Stations::indexStations() {
+		stationIndex.clear();
+		stationIndex.reserve(stations.size());
+
+		for (list<Station>::const_iterator it = stations.begin();
+			it != stations.end(); ++it) {
+
+			stationIndex.insert(pair<string, const Station*>(
+				it->GetIdentifier().ToString(), &*it));
+		}
+	}
+
+	string Stations::dataPath() {
 		char appDataPath[MAX_PATH];
 		SHGetFolderPath(nullptr, CSIDL_COMMON_APPDATA, nullptr,
 			SHGFP_TYPE_CURRENT, appDataPath);
 
-		string path = string(appDataPath) + "\\InternetRadio\\stations.json";
+		return string(appDataPath) + "\\InternetRadio";
+	}
+
+	void Stations::showError(const string &message) const {
+		// A refresh runs in the background, a message box would pop up out of
+		// nowhere
+		if (showErrors)
+			MessageBox(nullptr, message.c_str(), "Error", MB_OK |
+				MB_ICONERROR);
+		else
+			OutputDebugString(("Stations: " + message + "\n").c_str());
+	}
+
+	void Stations::sync(uint16_t *installedVersion,
+		vector<string> *changedFiles) {
 
 		stringstream ssArchive;
 		try {
@@ -76,21 +197,20 @@ namespace inetr {
 		jsonReader.parse(ssArchive, archiveRootValue);
 
 		map<int, string> staVersions;
-		for (size_t i = 0; i < (size_t)archiveRootValue.size(); ++i) {
-			string versionStr = archiveRootValue.getMemberNames().at(i);
+		if (archiveRootValue.isObject()) {
+			for (Value::const_iterator it = archiveRootValue.begin();
+				it != archiveRootValue.end(); ++it) {
 
-			Value versionMinVerVal = archiveRootValue.get(versionStr, Value(
-				nullValue));
-			if (!versionMinVerVal.isString())
-				continue;
+				const Value &versionMinVerVal = *it;
+				if (!versionMinVerVal.isString())
+					continue;
 
-			staVersions.insert(pair<int, string>(
-				atoi(versionStr.c_str()), versionMinVerVal.asString()));
+				staVersions.insert(pair<int, string>(
+					atoi(it.key().asString().c_str()),
+					versionMinVerVal.asString()));
+			}
 		}
 
-		uint16_t installedVersion[4];
-		VersionUtil::GetInstalledVersion(installedVersion);
-
 		for (map<int, string>::reverse_iterator it =
 			staVersions.rbegin(); it != staVersions.rend(); ++it) {
 
@@ -102,239 +222,531 @@ namespace inetr {
 
 				stringstream ssVer;
 				ssVer << it->first;
-				stringstream ssNewStaChecksumsF;
-				try {
-					HTTP::Get("http://internetradio.clemensboos.net/stations/" +
-						ssVer.str() + "/checksums", &ssNewStaChecksumsF);
-				} catch(...) {
+				string catalog = ssVer.str();
+				string remoteRoot =
+					"http://internetradio.clemensboos.net/stations/" + catalog;
+
+				// Unchanged local files are not read again
+				FileHashCache hashCache(dataPath() + "\\hashes");
+				AssetSync assetSync(dataPath(), remoteRoot);
+				assetSync.SetHashCache(&hashCache);
+				assetSync.SetCancelFlag(&cancelled);
+
+				// Only the changes since the last synchronized revision are
+				// fetched, the full checksum list is needed when there is no
+				// such revision or the server no longer keeps its changes
+				uint32_t revision = 0;
+				bool haveChanges = readRevision(catalog, revision) &&
+					addChanges(remoteRoot, assetSync, revision);
+				if (!haveChanges && !addChecksums(remoteRoot, assetSync,
+					revision))
+					break;
+				if (cancelled != 0)
 					break;
-				}
 
-				while (ssNewStaChecksumsF.good()) {
-					string filePathAndChecksum;
-					ssNewStaChecksumsF >> filePathAndChecksum;
-					if (filePathAndChecksum == "")
-						continue;
+				if (assetSync.Run() && revision != 0)
+					writeRevision(catalog, revision);
+				hashCache.Save();
+				if (changedFiles != nullptr)
+					changedFiles->insert(changedFiles->end(),
+						assetSync.GetDownloaded().begin(),
+						assetSync.GetDownloaded().end());
+
+				const AssetSyncTimings &timings = assetSync.GetTimings();
+				AssetSyncProgress progress = assetSync.GetProgress();
+				stringstream ssTimings;
+				ssTimings << "Station sync (" << (haveChanges ? "changes" :
+					"full") << "): " << progress.Checked <<
+					" checked in " << timings.Hashing << " ms, " <<
+					progress.Downloaded << " downloaded in " <<
+					timings.Downloading << " ms, " << progress.Failed <<
+					" failed, " << timings.Total << " ms total\n";
+				OutputDebugString(ssTimings.str().c_str());
 
-					vector<string> filePathAndChecksumSplit =
-						StringUtil::Explode(filePathAndChecksum, ":");
-					if (filePathAndChecksumSplit.size() != 2)
-						continue;
+				break;
+			}
+		}
+	}
 
-					string fileName = filePathAndChecksumSplit[0];
-					string locPath = string(appDataPath) + "\\InternetRadio\\"
-						+ fileName;
-					StringUtil::SearchAndReplace(locPath, "/", "\\");
-					string remoteChecksum = filePathAndChecksumSplit[1];
-
-					bool update = false;
-
-					ifstream fileStream(locPath);
-					if (fileStream.is_open()) {
-						fileStream.close();
-						string localChecksum = CryptUtil::FileMD5Hash(locPath);
-						if (remoteChecksum != localChecksum)
-							update = true;
-					} else {
-						update = true;
-					}
+	bool Stations::getChecksumList(const string &taggedURL,
+		const string &legacyURL, string &content, HashAlgorithm &algorithm) {
 
-					if (!update)
-						continue;
+		// Servers publish lists tagged with a faster algorithm next to the
+		// MD5 ones older clients read
+		stringstream ssTagged;
+		try {
+			HTTP::Get(taggedURL, &ssTagged);
+			content = ssTagged.str();
+			if (CryptUtil::StripAlgorithmTag(content, algorithm))
+				return true;
+		} catch(...) { }
 
-					string fileRemURL =
-						"http://internetradio.clemensboos.net/stations/" +
-						ssVer.str() + "/" + fileName;
-					StringUtil::SearchAndReplace(fileRemURL, "\\", "/");
-					stringstream ssRemFile;
-					try {
-						HTTP::Get(fileRemURL, &ssRemFile);
-					} catch(...) {
-						continue;
-					}
+		stringstream ssLegacy;
+		try {
+			HTTP::Get(legacyURL, &ssLegacy);
+		} catch(...) {
+			return false;
+		}
 
-					string locDir = locPath.substr(0,
-						locPath.find_last_of("\\"));
-					CreateDirectory(locDir.c_str(), nullptr);
+		content = ssLegacy.str();
+		return CryptUtil::StripAlgorithmTag(content, algorithm);
+	}
 
-					ofstream fOutStream;
-					fOutStream.open(locPath, ios::out | ios::binary);
-					fOutStream << ssRemFile.rdbuf();
-					fOutStream.close();
-				}
+	bool Stations::addChanges(const string &remoteRoot, AssetSync &assetSync,
+		uint32_t &revision) {
 
-				break;
+		stringstream ssSince;
+		ssSince << revision;
+		string changes;
+		HashAlgorithm algorithm;
+		if (!getChecksumList(remoteRoot + "/changes2/" + ssSince.str(),
+			remoteRoot + "/changes/" + ssSince.str(), changes, algorithm))
+			return false;
+
+		// "revision <n>" followed by one "+<path>:<checksum>" line per added
+		// or modified file and one "-<path>" line per removed file
+		StringTokenizer lines(changes, "\r\n", INETR_STM_CharSet);
+		StringRef line;
+		if (!lines.Next(line))
+			return false;
+
+		StringTokenizer header(line, " ");
+		StringRef keyword, newRevision, extraField;
+		if (!header.Next(keyword) || keyword != "revision" ||
+			!header.Next(newRevision) || header.Next(extraField))
+			return false;
+
+		vector<pair<string, string> > modified;
+		vector<string> removed;
+		while (lines.Next(line)) {
+			StringRef entry = line.Substr(1);
+			if (line[0] == '-' && !entry.Empty()) {
+				removed.push_back(entry.ToString());
+				continue;
 			}
+
+			StringTokenizer fields(entry, ":");
+			StringRef filePath, checksum;
+			if (line[0] != '+' || !fields.Next(filePath) ||
+				!fields.Next(checksum) || fields.Next(extraField))
+				return false;
+
+			modified.push_back(pair<string, string>(filePath.ToString(),
+				checksum.ToString()));
 		}
 
-		ifstream stationsFile;
-		stationsFile.open(path, ios::in);
-		if (!stationsFile.is_open()) {
-			return false;
+		assetSync.SetHashAlgorithm(algorithm);
+		for (vector<pair<string, string> >::const_iterator it =
+			modified.begin(); it != modified.end(); ++it) {
+
+			assetSync.Add(it->first, it->second);
 		}
 
-		Value rootValue;
+		for (vector<string>::const_iterator it = removed.begin();
+			it != removed.end(); ++it) {
+
+			if (it->find("..") != string::npos)
+				continue;
+
+			string localPath = dataPath() + "\\" + *it;
+			StringUtil::SearchAndReplace(localPath, "/", "\\");
+			DeleteFile(localPath.c_str());
+		}
+
+		revision = static_cast<uint32_t>(strtoul(newRevision.ToString().c_str(),
+			nullptr, 10));
+
+		return true;
+	}
+
+	bool Stations::addChecksums(const string &remoteRoot, AssetSync &assetSync,
+		uint32_t &revision) {
+
+		// The revision is fetched first, files published after it are
+		// simply synchronized again with the next changes
+		stringstream ssRevision;
+		try {
+			HTTP::Get(remoteRoot + "/revision", &ssRevision);
+			revision = static_cast<uint32_t>(strtoul(ssRevision.str().c_str(),
+				nullptr, 10));
+		} catch(...) {
+			revision = 0;
+		}
 
-		if (!jsonReader.parse(stationsFile, rootValue, false)) {
-			MessageBox(nullptr, jsonReader.getFormattedErrorMessages().c_str(),
-				"Error", MB_OK | MB_ICONERROR);
+		string checksums;
+		HashAlgorithm algorithm;
+		if (!getChecksumList(remoteRoot + "/checksums2",
+			remoteRoot + "/checksums", checksums, algorithm))
 			return false;
+
+		assetSync.SetHashAlgorithm(algorithm);
+		StringTokenizer checksumEntries(checksums, " \t\r\n",
+			INETR_STM_CharSet);
+		StringRef filePathAndChecksum;
+		while (checksumEntries.Next(filePathAndChecksum)) {
+			StringTokenizer fields(filePathAndChecksum, ":");
+			StringRef filePath, checksum, extraField;
+			if (!fields.Next(filePath) || !fields.Next(checksum) ||
+				fields.Next(extraField))
+				continue;
+
+			assetSync.Add(filePath.ToString(), checksum.ToString());
 		}
 
-		stationsFile.close();
+		return true;
+	}
+
+	bool Stations::readRevision(const string &catalog, uint32_t &revision) {
+		// Changes can only be applied to a catalog that is still there
+		if (GetFileAttributes((dataPath() + "\\stations.json").c_str()) ==
+			INVALID_FILE_ATTRIBUTES)
+			return false;
 
-		Value minVersionValue = rootValue.get("minVersion", Value(nullValue));
-		if (!minVersionValue.isString()) {
-			MessageBox(nullptr, "Unable to load stations, couldn't read \
-				minimum version", "Error", MB_OK | MB_ICONERROR);
+		ifstream revisionFile(dataPath() + "\\revision");
+		string revisionCatalog;
+		if (!(revisionFile >> revisionCatalog >> revision) ||
+			revisionCatalog != catalog)
 			return false;
+
+		return true;
+	}
+
+	void Stations::writeRevision(const string &catalog, uint32_t revision) {
+		ofstream revisionFile(dataPath() + "\\revision", ios::out |
+			ios::trunc);
+		revisionFile << catalog << " " << revision << "\n";
+	}
+
+	bool Stations::loadCatalog(uint16_t *installedVersion, list<Station> &out,
+		bool onlyIfChanged) {
+
+		string stationsPath = dataPath() + "\\stations.json";
+		FileHashCache::Stamp catalogStamp;
+		if (!FileHashCache::GetStamp(stationsPath, catalogStamp) ||
+			(onlyIfChanged && catalogStamp == loadedCatalogStamp))
+			return false;
+
+		// The errors of a file that failed to load have been reported, a
+		// retry with the same file stays quiet
+		bool wasShowingErrors = showErrors;
+		if (catalogStamp == failedCatalogStamp)
+			showErrors = false;
+
+		bool loaded = readCatalog(stationsPath, catalogStamp,
+			installedVersion, out);
+		if (loaded)
+			loadedCatalogStamp = catalogStamp;
+		else
+			failedCatalogStamp = catalogStamp;
+
+		showErrors = wasShowingErrors;
+
+		return loaded;
+	}
+
+	bool Stations::readCatalog(const string &stationsPath,
+		const FileHashCache::Stamp &catalogStamp, uint16_t *installedVersion,
+		list<Station> &out) {
+
+		// Use the binary snapshot as long as stations.json, the application
+		// and its meta source prototypes are unchanged
+		string snapshotPath = dataPath() + "\\stations.bin";
+		uint64_t prototypesHash = CatalogSnapshot::HashPrototypes(
+			metaSourcePrototypeIndex);
+		{
+			CatalogSnapshot snapshot(snapshotPath);
+			if (snapshot.IsValid(catalogStamp, installedVersion,
+				prototypesHash)) {
+
+				uint16_t minVersion[4];
+				snapshot.GetMinVersion(minVersion);
+				if (VersionUtil::CompareVersions(minVersion, installedVersion)
+					== VCR_Newer) {
+
+					showError("Stations file incompatible, please \
+						update this application");
+					return false;
+				}
+
+				if (snapshot.Read(metaSourcePrototypeIndex, out))
+					return true;
+			}
 		}
 
+		MappedFile stationsFile(stationsPath);
+		if (!stationsFile.IsOpen())
+			return false;
+
+		list<Station> loadedStations;
 		uint16_t minVersion[4];
-		VersionUtil::VersionStrToArr(minVersionValue.asString(), minVersion);
+		if (!parseCatalog(stationsFile.GetData(), stationsFile.GetSize(),
+			installedVersion, loadedStations, minVersion))
+			return false;
+
+		CatalogSnapshot::Write(snapshotPath, catalogStamp, installedVersion,
+			prototypesHash, minVersion, loadedStations);
+		out.splice(out.end(), loadedStations);
+
+		return true;
+	}
+
+	bool Stations::parseCatalog(const char *data, size_t length,
+		uint16_t *installedVersion, list<Station> &out, uint16_t *minVersion) {
+
+		JSONPullParser parser(data, length);
+		list<Station> loadedStations;
+
+		string minVersionStr;
+		bool hasMinVersion = false;
+		bool hasStations = false;
+
+		JSONPullToken token = parser.Next();
+		if (token == INETR_JPT_ObjectBegin) {
+			while ((token = parser.Next()) == INETR_JPT_Key) {
+				string key = parser.GetString();
+				token = parser.Next();
+
+				if (key == "minVersion" && token == INETR_JPT_String) {
+					minVersionStr = parser.GetString();
+					hasMinVersion = true;
+				} else if (key == "stations" && token ==
+					INETR_JPT_ObjectBegin) {
+
+					hasStations = true;
+					if (!parseStations(parser, loadedStations))
+						break;
+				} else if (!parser.Skip(token)) {
+					break;
+				}
+			}
+		}
+
+		if (token != INETR_JPT_ObjectEnd || parser.Next() != INETR_JPT_End) {
+			// A valid document whose root isn't an object leaves no parser
+			// error
+			showError(parser.GetError().empty() ? "Unable to load stations" :
+				parser.GetError());
+			return false;
+		}
+
+		if (!hasMinVersion) {
+			showError("Unable to load stations, couldn't read \
+				minimum version");
+			return false;
+		}
+
+		VersionUtil::VersionStrToArr(minVersionStr, minVersion);
 		if (VersionUtil::CompareVersions(minVersion, installedVersion) ==
 			VCR_Newer) {
 
-			MessageBox(nullptr, "Stations file incompatible, please update \
-				this application", "Error", MB_OK | MB_ICONERROR);
+			showError("Stations file incompatible, please update \
+				this application");
 			return false;
 		}
 
-		Value stationsValue = rootValue.get("stations", Value(nullValue));
-		if (!stationsValue.isObject()) {
-			MessageBox(nullptr, "Unable to load stations", "Error", MB_OK |
-				MB_ICONERROR);
+		if (!hasStations) {
+			showError("Unable to load stations");
 			return false;
 		}
 
-		for (size_t i = 0; i < (size_t)stationsValue.size(); ++i) {
-			string staIdentifier = stationsValue.getMemberNames().at(i);
+		loadedStations.sort([](const Station &a, const Station &b) -> bool {
+			return a.GetIdentifier() < b.GetIdentifier();
+		});
+		out.splice(out.end(), loadedStations);
 
-			Value staValue = stationsValue.get(staIdentifier, Value(nullValue));
-			if (!staValue.isObject()) {
-				MessageBox(nullptr, ("Unable to load station: " +
-					staIdentifier).c_str(), "Error", MB_OK | MB_ICONERROR);
-				continue;
-			}
+		return true;
+	}
 
-			Value staNameValue = staValue.get("name", Value(nullValue));
-			if (!staNameValue.isString()) {
-				MessageBox(nullptr, ("Unable to load station: " +
-					staIdentifier + "Couldn't read name").c_str(), "Error",
-					MB_OK | MB_ICONERROR);
-				continue;
-			}
+	bool Stations::parseStations(JSONPullParser &parser, list<Station> &out) {
+		JSONPullToken token;
+		while ((token = parser.Next()) == INETR_JPT_Key) {
+			string staIdentifier = parser.GetString();
 
-			Value staStreamURLValue = staValue.get("streamURL", Value(
-				nullValue));
-			if (!staStreamURLValue.isString()) {
-				MessageBox(nullptr, ("Unable to load station: " +
-					staIdentifier + "Couldn't read stream URL").c_str(),
-					"Error", MB_OK | MB_ICONERROR);
+			token = parser.Next();
+			if (token != INETR_JPT_ObjectBegin) {
+				if (!parser.Skip(token))
+					return false;
+
+				showError("Unable to load station: " + staIdentifier);
 				continue;
 			}
 
-			Value staImageValue = staValue.get("image", Value(nullValue));
-			if (!staImageValue.isString()) {
-				MessageBox(nullptr, ("Unable to load station: " +
-					staIdentifier + "Couldn't read image").c_str(), "Error",
-					MB_OK | MB_ICONERROR);
-				continue;
+			if (!parseStation(parser, staIdentifier, out))
+				return false;
+		}
+
+		return token == INETR_JPT_ObjectEnd;
+	}
+
+	bool Stations::parseStation(JSONPullParser &parser,
+		const string &staIdentifier, list<Station> &out) {
+
+		string name, streamURL, image;
+		bool hasName = false, hasStreamURL = false, hasImage = false;
+
+		vector<MetaSource> metaSources;
+		string metaOut = "";
+		bool metaValid = true;
+
+		JSONPullToken token;
+		while ((token = parser.Next()) == INETR_JPT_Key) {
+			string key = parser.GetString();
+			token = parser.Next();
+
+			if (key == "name" && token == INETR_JPT_String) {
+				name = parser.GetString();
+				hasName = true;
+			} else if (key == "streamURL" && token == INETR_JPT_String) {
+				streamURL = parser.GetString();
+				hasStreamURL = true;
+			} else if (key == "image" && token == INETR_JPT_String) {
+				image = parser.GetString();
+				hasImage = true;
+			} else if (key == "meta" && token == INETR_JPT_ObjectBegin) {
+				if (!parseMeta(parser, staIdentifier, metaSources, metaOut,
+					metaValid))
+					return false;
+			} else if (!parser.Skip(token)) {
+				return false;
 			}
+		}
 
-			vector<MetaSource> metaSources;
-			string metaOut = "";
-
-			Value staMetaValue = staValue.get("meta", Value(nullValue));
-			if (staMetaValue.isObject()) {
-				Value staMetaSrcsValue = staMetaValue.get("sources",
-					Value(nullValue));
-				if (!staMetaSrcsValue.isArray()) {
-					MessageBox(nullptr, ("Unable to load station: " +
-						staIdentifier + "Couldn't read meta sources").c_str(),
-						"Error", MB_OK | MB_ICONERROR);
-					continue;
-				}
+		if (token != INETR_JPT_ObjectEnd)
+			return false;
 
-				for (unsigned int i = 0; i < staMetaSrcsValue.size(); ++i) {
-					Value staMetaSrcVal = staMetaSrcsValue[i];
-					if (!staMetaSrcVal.isObject()) {
-						MessageBox(nullptr, ("Unable to load station: " +
-							staIdentifier +
-							"Couldn't read meta source").c_str(), "Error", MB_OK
-							| MB_ICONERROR);
-						continue;
-					}
+		if (!hasName) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read name");
+			return true;
+		}
 
-					Value staMetaSrcIdVal = staMetaSrcVal.get("id", Value(
-						nullValue));
-					if (!staMetaSrcIdVal.isString()) {
-						MessageBox(nullptr, ("Unable to load station: " +
-							staIdentifier + "Couldn't read meta source \
-							id").c_str(), "Error", MB_OK | MB_ICONERROR);
-						continue;
-					}
-					string staMetaSrcId = staMetaSrcIdVal.asString();
+		if (!hasStreamURL) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read stream URL");
+			return true;
+		}
+
+		if (!hasImage) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read image");
+			return true;
+		}
+
+		if (!metaValid)
+			return true;
+
+		out.push_back(Station(staIdentifier, name, streamURL, "img/" + image,
+			std::move(metaSources), metaOut));
+
+		return true;
+	}
+
+	bool Stations::parseMeta(JSONPullParser &parser,
+		const string &staIdentifier, vector<MetaSource> &metaSources,
+		string &metaOut, bool &valid) {
+
+		bool hasSources = false, hasOut = false;
 
-					list<MetaSourcePrototype*>::iterator srcProtIt =
-						find_if(MetaSourcePrototypes.begin(),
-						MetaSourcePrototypes.end(), [&staMetaSrcId](
-						MetaSourcePrototype* &element) -> bool {
+		JSONPullToken token;
+		while ((token = parser.Next()) == INETR_JPT_Key) {
+			string key = parser.GetString();
+			token = parser.Next();
 
-						return element->GetIdentifer() == staMetaSrcId;
-					});
+			if (key == "sources" && token == INETR_JPT_ArrayBegin) {
+				hasSources = true;
 
-					if (srcProtIt == MetaSourcePrototypes.end()) {
-						MessageBox(nullptr, ("Unable to load station: " +
-							staIdentifier + "\nUndefined meta source: " +
-							staMetaSrcId).c_str(), "Error", MB_OK |
-							MB_ICONERROR);
+				while ((token = parser.Next()) != INETR_JPT_ArrayEnd) {
+					if (token == INETR_JPT_ObjectBegin) {
+						if (!parseMetaSource(parser, staIdentifier,
+							metaSources))
+							return false;
 						continue;
 					}
 
-					map<string, string> staMetaSrcParam;
-					for (size_t j = 0; j < (size_t)staMetaSrcVal.size(); ++j) {
-						string staMetaSrcKey =
-							staMetaSrcVal.getMemberNames().at(j);
-
-						if (staMetaSrcKey == "id")
-							continue;
-
-						Value staMetaSrcValVal =
-							staMetaSrcVal.get(staMetaSrcKey, Value(nullValue));
-						if (!staMetaSrcValVal.isString()) {
-							MessageBox(nullptr, ("Unable to load station: " +
-								staIdentifier + "\nCouldn't read parameter: " +
-								staMetaSrcKey + " of meta source: " +
-								staMetaSrcId).c_str(), "Error", MB_OK |
-								MB_ICONERROR);
-							continue;
-						}
-
-						staMetaSrcParam.insert(pair<string, string>(
-							staMetaSrcKey, staMetaSrcValVal.asString()));
-					}
+					if (!parser.Skip(token))
+						return false;
 
-					metaSources.push_back(MetaSource(*srcProtIt, move(
-						staMetaSrcParam)));
+					showError("Unable to load station: " +
+						staIdentifier + "Couldn't read meta source");
 				}
+			} else if (key == "out" && token == INETR_JPT_String) {
+				metaOut = parser.GetString();
+				hasOut = true;
+			} else if (!parser.Skip(token)) {
+				return false;
+			}
+		}
 
-				Value staMetaOutValue = staMetaValue.get("out",
-					Value(nullValue));
-				if (!staMetaOutValue.isString()) {
-					MessageBox(nullptr, ("Unable to load station: " +
-						staIdentifier + "Couldn't read meta output").c_str(),
-						"Error", MB_OK | MB_ICONERROR);
-					continue;
+		if (token != INETR_JPT_ObjectEnd)
+			return false;
+
+		if (!hasSources) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read meta sources");
+			valid = false;
+		} else if (!hasOut) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read meta output");
+			valid = false;
+		}
+
+		return true;
+	}
+
+	bool Stations::parseMetaSource(JSONPullParser &parser,
+		const string &staIdentifier, vector<MetaSource> &metaSources) {
+
+		string staMetaSrcId;
+		bool hasId = false;
+		map<string, string> staMetaSrcParam;
+
+		JSONPullToken token;
+		while ((token = parser.Next()) == INETR_JPT_Key) {
+			string staMetaSrcKey = parser.GetString();
+			token = parser.Next();
+
+			if (token != INETR_JPT_String) {
+				if (!parser.Skip(token))
+					return false;
+
+				if (staMetaSrcKey != "id") {
+					showError("Unable to load station: " +
+						staIdentifier + "\nCouldn't read parameter: " +
+						staMetaSrcKey + " of meta source: " +
+						staMetaSrcId);
 				}
-				metaOut = staMetaOutValue.asString();
+				continue;
+			}
+
+			if (staMetaSrcKey == "id") {
+				staMetaSrcId = parser.GetString();
+				hasId = true;
+			} else {
+				staMetaSrcParam.insert(pair<string, string>(staMetaSrcKey,
+					parser.GetString()));
 			}
+		}
+
+		if (token != INETR_JPT_ObjectEnd)
+			return false;
 
-			stations.push_back(Station(staIdentifier, staNameValue.asString(),
-				staStreamURLValue.asString(), "img/" + staImageValue.asString(),
-				std::move(metaSources), metaOut));
+		if (!hasId) {
+			showError("Unable to load station: " +
+				staIdentifier + "Couldn't read meta source \
+				id");
+			return true;
 		}
 
+		MetaSourcePrototype *srcProt = FindMetaSourcePrototype(staMetaSrcId);
+		if (srcProt == nullptr) {
+			showError("Unable to load station: " +
+				staIdentifier + "\nUndefined meta source: " +
+				staMetaSrcId);
+			return true;
+		}
+
+		metaSources.push_back(MetaSource(srcProt, move(staMetaSrcParam)));
+
 		return true;
 	}
 }
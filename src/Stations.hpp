@@ -1,8 +1,18 @@
 #ifndef INETR_STATIONS_HPP
 #define INETR_STATIONS_HPP
 
+#include <cstdint>
+
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "AssetSync.hpp"
+#include "CryptUtil.hpp"
+#include "FileHashCache.hpp"
+#include "JSONPullParser.hpp"
+#include "MetaSource.hpp"
 #include "MetaSourcePrototype.hpp"
 #include "Station.hpp"
 
@@ -12,7 +22,23 @@ namespace inetr {
 		Stations();
 		~Stations();
 
+		// Loads the catalog that is already on disk
 		bool Load();
+		// Synchronizes the catalog with the server and loads it into out if
+		// it changed since the last load, may be called on any thread. Errors
+		// are only logged when showErrors is false. The paths of all files
+		// the synchronization replaced are added to changedFiles.
+		bool Refresh(std::list<Station> &out, bool showErrors = true,
+			std::vector<std::string> *changedFiles = nullptr);
+		// Makes a running Refresh give up as soon as possible
+		void Cancel();
+		// Applies a refreshed catalog on the thread that owns the stations.
+		// Other threads may keep using the stations, they work on copies.
+		void Merge(std::list<Station> &fresh);
+
+		const Station *Find(const std::string &identifier) const;
+		MetaSourcePrototype *FindMetaSourcePrototype(
+			const std::string &identifier) const;
 
 		inline std::list<Station>::const_iterator begin() const {
 			return stations.begin();
@@ -23,7 +49,53 @@ namespace inetr {
 
 		std::list<MetaSourcePrototype*> MetaSourcePrototypes;
 	private:
+		static std::string dataPath();
+		static bool getChecksumList(const std::string &taggedURL,
+			const std::string &legacyURL, std::string &content,
+			HashAlgorithm &algorithm);
+		static bool addChanges(const std::string &remoteRoot,
+			AssetSync &assetSync, uint32_t &revision);
+		static bool addChecksums(const std::string &remoteRoot,
+			AssetSync &assetSync, uint32_t &revision);
+		static bool readRevision(const std::string &catalog,
+			uint32_t &revision);
+		static void writeRevision(const std::string &catalog,
+			uint32_t revision);
+
+		void addMetaSourcePrototype(MetaSourcePrototype *prototype);
+		void indexStations();
+		void showError(const std::string &message) const;
+
+		void sync(uint16_t *installedVersion,
+			std::vector<std::string> *changedFiles);
+		bool loadCatalog(uint16_t *installedVersion, std::list<Station> &out,
+			bool onlyIfChanged);
+		bool readCatalog(const std::string &stationsPath,
+			const FileHashCache::Stamp &catalogStamp,
+			uint16_t *installedVersion, std::list<Station> &out);
+		bool parseCatalog(const char *data, size_t length,
+			uint16_t *installedVersion, std::list<Station> &out,
+			uint16_t *minVersion);
+		bool parseStations(JSONPullParser &parser, std::list<Station> &out);
+		bool parseStation(JSONPullParser &parser,
+			const std::string &staIdentifier, std::list<Station> &out);
+		bool parseMeta(JSONPullParser &parser, const std::string &staIdentifier,
+			std::vector<MetaSource> &metaSources, std::string &metaOut,
+			bool &valid);
+		bool parseMetaSource(JSONPullParser &parser,
+			const std::string &staIdentifier,
+			std::vector<MetaSource> &metaSources);
+
+		std::unordered_map<std::string, MetaSourcePrototype*>
+			metaSourcePrototypeIndex;
+
 		std::list<Station> stations;
+		std::unordered_map<std::string, const Station*> stationIndex;
+		FileHashCache::Stamp loadedCatalogStamp;
+		FileHashCache::Stamp failedCatalogStamp;
+
+		bool showErrors;
+		volatile LONG cancelled;
 	};
 }
 
@@ -0,0 +1,158 @@
+#include "StringReplacer.hpp"
+
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace inetr {
+	StringReplacer::StringReplacer() {
+		memset(candidates, 0, sizeof(candidates));
+		distinctFirstBytes = 0;
+		singleFirstByte = 0;
+		maxGrowth = 1;
+	}
+
+	StringReplacer::StringReplacer(const char* const table[][2],
+		size_t count) {
+
+		memset(candidates, 0, sizeof(candidates));
+		distinctFirstBytes = 0;
+		singleFirstByte = 0;
+		maxGrowth = 1;
+
+		for (size_t i = 0; i < count; ++i)
+			Add(table[i][0], table[i][1]);
+	}
+
+	void StringReplacer::Add(const string &search, const string &replace) {
+		if (search.empty())
+			return;
+
+		// Keep patterns grouped by first byte, longest first within a group
+		vector<Pattern>::iterator it = patterns.begin();
+		while (it != patterns.end() && (static_cast<unsigned char>(
+			it->Search[0]) < static_cast<unsigned char>(search[0]) ||
+			(it->Search[0] == search[0] && it->Search.length() >=
+			search.length()))) {
+
+			if (it->Search == search)
+				break;
+			++it;
+		}
+
+		// A replaced pattern may change the growth bound either way
+		if (it != patterns.end() && it->Search == search) {
+			it->Replace = replace;
+		} else {
+			Pattern pattern;
+			pattern.Search = search;
+			pattern.Replace = replace;
+			patterns.insert(it, pattern);
+		}
+
+		compile();
+	}
+
+	size_t StringReplacer::Apply(const char *in, size_t length, char *out)
+		const {
+
+		size_t written = 0;
+
+		size_t pos = 0;
+		while (pos < length) {
+			size_t next = findCandidate(in, pos, length);
+			memcpy(out + written, in + pos, next - pos);
+			written += next - pos;
+			pos = next;
+
+			if (pos == length)
+				break;
+
+			const Pattern *match = nullptr;
+			const Range &range = candidates[static_cast<unsigned char>(
+				in[pos])];
+			for (size_t i = range.Begin; i < range.End; ++i) {
+				const string &search = patterns[i].Search;
+				if (search.length() <= length - pos && memcmp(in + pos,
+					search.c_str(), search.length()) == 0) {
+
+					match = &patterns[i];
+					break;
+				}
+			}
+
+			if (match != nullptr) {
+				memcpy(out + written, match->Replace.c_str(),
+					match->Replace.length());
+				written += match->Replace.length();
+				pos += match->Search.length();
+			} else {
+				out[written++] = in[pos++];
+			}
+		}
+
+		return written;
+	}
+
+	size_t StringReplacer::MaxOutputLength(size_t length) const {
+		return length * maxGrowth;
+	}
+
+	void StringReplacer::Replace(string &str) const {
+		if (findCandidate(str.c_str(), 0, str.length()) == str.length())
+			return;
+
+		string out;
+		out.resize(MaxOutputLength(str.length()));
+		out.resize(Apply(str.c_str(), str.length(), &out[0]));
+
+		str.swap(out);
+	}
+
+	void StringReplacer::compile() {
+		maxGrowth = 1;
+		memset(candidates, 0, sizeof(candidates));
+		distinctFirstBytes = 0;
+		for (size_t i = 0; i < patterns.size(); ++i) {
+			const Pattern &pattern = patterns[i];
+
+			size_t growth = (pattern.Replace.length() +
+				pattern.Search.length() - 1) / pattern.Search.length();
+			if (growth > maxGrowth)
+				maxGrowth = growth;
+
+			Range &range = candidates[static_cast<unsigned char>(
+				pattern.Search[0])];
+			if (range.End == 0) {
+				range.Begin = i;
+				++distinctFirstBytes;
+			}
+			range.End = i + 1;
+		}
+		singleFirstByte = patterns.empty() ? 0 : patterns[0].Search[0];
+	}
+
+	size_t StringReplacer::findCandidate(const char *in, size_t pos,
+		size_t length) const {
+
+		if (distinctFirstBytes == 0)
+			return length;
+
+		if (distinctFirstBytes == 1) {
+			const void *found = memchr(in + pos, singleFirstByte,
+				length - pos);
+			return (found != nullptr) ? static_cast<const char*>(found) - in :
+				length;
+		}
+
+		while (pos < length && candidates[static_cast<unsigned char>(
+			in[pos])].End == 0)
+			++pos;
+
+		return pos;
+	}
+}
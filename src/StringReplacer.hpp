@@ -0,0 +1,47 @@
+#ifndef INETR_STRINGREPLACER_HPP
+#define INETR_STRINGREPLACER_HPP
+
+#include <string>
+#include <vector>
+
+namespace inetr {
+	// A compiled replacement table that is applied in a single left-to-right
+	// pass. At every position the longest matching search string wins and
+	// replaced text is never rescanned. Positions whose byte cannot start
+	// any search string are skipped through a first-byte lookup table.
+	class StringReplacer {
+	public:
+		StringReplacer();
+		StringReplacer(const char* const table[][2], size_t count);
+
+		void Add(const std::string &search, const std::string &replace);
+
+		// out needs room for MaxOutputLength(length) characters
+		size_t Apply(const char *in, size_t length, char *out) const;
+		size_t MaxOutputLength(size_t length) const;
+
+		void Replace(std::string &str) const;
+	private:
+		struct Pattern {
+			std::string Search;
+			std::string Replace;
+		};
+
+		struct Range {
+			size_t Begin;
+			size_t End;
+		};
+
+		// Rebuilds the first-byte table and the growth bound from patterns
+		void compile();
+		size_t findCandidate(const char *in, size_t pos, size_t length) const;
+
+		std::vector<Pattern> patterns;
+		Range candidates[256];
+		size_t distinctFirstBytes;
+		char singleFirstByte;
+		size_t maxGrowth;
+	};
+}
+
+#endif  // !INETR_STRINGREPLACER_HPP
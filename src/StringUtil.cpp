@@ -1,95 +1,175 @@
 #include "StringUtil.hpp"
 
 #include <cctype>
+#include <cstring>
 
 #include <algorithm>
 #include <string>
 #include <vector>
 
+#include "OutputTemplate.hpp"
+#include "StringReplacer.hpp"
+
 using std::string;
 using std::vector;
 
 namespace inetr {
-	vector<string> StringUtil::Explode(string str, string separator) {
-		vector<string> results;
-		size_t found = str.find_first_of(separator);
-		while (found != string::npos) {
-			if (found > 0)
-				results.push_back(str.substr(0, found));
-			str = str.substr(found + separator.length());
-			found = str.find_first_of(separator);
-		}
-		if (str.length() > 0)
-			results.push_back(str);
-		return results;
+	StringRef StringRef::Substr(size_t pos, size_t count /* = npos */) const {
+		if (pos > length)
+			pos = length;
+		if (count > length - pos)
+			count = length - pos;
+
+		return StringRef(data + pos, count);
 	}
 
-	string StringUtil::TrimLeft(string str) {
-		string::iterator it;
+	size_t StringRef::Find(char c, size_t pos /* = 0 */) const {
+		if (pos >= length)
+			return npos;
 
-		for (it = str.begin(); it != str.end(); ++it)
-			if (!isspace(*it))
-				break;
+		const void *found = memchr(data + pos, c, length - pos);
 
-		str.erase(str.begin(), it);
-		return str;
+		return (found != nullptr) ? static_cast<const char*>(found) - data :
+			npos;
 	}
 
-	string StringUtil::TrimRight(string str) {
-		string::reverse_iterator it;
+	size_t StringRef::Find(StringRef str, size_t pos /* = 0 */) const {
+		if (str.length == 0)
+			return (pos <= length) ? pos : npos;
 
-		for (it = str.rbegin(); it != str.rend(); ++it)
-			if (!isspace(*it))
-				break;
+		while (pos + str.length <= length) {
+			pos = Find(str.data[0], pos);
+			if (pos == npos || pos + str.length > length)
+				return npos;
 
-		string::difference_type dt = str.rend() - it;
+			if (memcmp(data + pos, str.data, str.length) == 0)
+				return pos;
 
-		str.erase(str.begin() + dt, str.end());
-		return str;
+			++pos;
+		}
+
+		return npos;
 	}
 
-	string StringUtil::Trim(string str) {
-		return TrimRight(TrimLeft(str));
+	size_t StringRef::FindFirstOf(StringRef chars, size_t pos /* = 0 */)
+		const {
+
+		if (chars.length == 1)
+			return Find(chars.data[0], pos);
+
+		for (; pos < length; ++pos) {
+			if (memchr(chars.data, data[pos], chars.length) != nullptr)
+				return pos;
+		}
+
+		return npos;
 	}
 
-	string StringUtil::DetokenizeVectorToPattern(vector<string> &inputList,
-		const string &pattern) {
+	StringRef StringRef::TrimLeft() const {
+		size_t begin = 0;
+		while (begin < length && isspace(static_cast<unsigned char>(
+			data[begin])))
+			++begin;
 
-		string out;
+		return StringRef(data + begin, length - begin);
+	}
 
-		size_t lastPos = 0;
-		size_t pos = 0;
-		while ((pos = pattern.find_first_of('$', pos)) != string::npos) {
-			out += pattern.substr(lastPos, (pos - lastPos));
+	StringRef StringRef::TrimRight() const {
+		size_t end = length;
+		while (end > 0 && isspace(static_cast<unsigned char>(data[end - 1])))
+			--end;
+
+		return StringRef(data, end);
+	}
 
-			if (++pos == pattern.length())
-				return pattern;
+	StringRef StringRef::Trim() const {
+		return TrimLeft().TrimRight();
+	}
 
-			size_t elem = (size_t)atoi(string(size_t(1), pattern[pos]).c_str());
+	bool operator==(StringRef a, StringRef b) {
+		return a.Length() == b.Length() && memcmp(a.Data(), b.Data(),
+			a.Length()) == 0;
+	}
 
-			out += inputList[elem];
+	bool operator!=(StringRef a, StringRef b) {
+		return !(a == b);
+	}
 
-			++pos;
+	bool operator<(StringRef a, StringRef b) {
+		int result = memcmp(a.Data(), b.Data(), (a.Length() < b.Length()) ?
+			a.Length() : b.Length());
 
-			lastPos = pos;
+		return (result != 0) ? result < 0 : a.Length() < b.Length();
+	}
+
+	StringTokenizer::StringTokenizer(StringRef str, StringRef separator,
+		StringTokenizerMode mode /* = INETR_STM_Substring */,
+		bool skipEmpty /* = true */) : str(str), separator(separator),
+		mode(mode), skipEmpty(skipEmpty), pos(0), done(false) { }
+
+	bool StringTokenizer::Next(StringRef &token) {
+		while (!done) {
+			size_t found = (mode == INETR_STM_CharSet) ?
+				str.FindFirstOf(separator, pos) : str.Find(separator, pos);
+			size_t separatorLength = (mode == INETR_STM_CharSet) ? 1 :
+				separator.Length();
+
+			StringRef candidate;
+			if (found == StringRef::npos || separator.Empty()) {
+				candidate = str.Substr(pos);
+				pos = str.Length();
+				done = true;
+			} else {
+				candidate = str.Substr(pos, found - pos);
+				pos = found + separatorLength;
+			}
+
+			if (!skipEmpty || !candidate.Empty()) {
+				token = candidate;
+				return true;
+			}
 		}
 
-		out += pattern.substr(lastPos, (pos - lastPos));
+		return false;
+	}
+
+	vector<string> StringUtil::Explode(const string &str,
+		const string &separator) {
+
+		vector<string> results;
+
+		StringTokenizer tokenizer(str, separator);
+		StringRef token;
+		while (tokenizer.Next(token))
+			results.push_back(token.ToString());
 
-		return out;
+		return results;
 	}
 
-	void StringUtil::SearchAndReplace(string &str, const string &search,
-		const string &replace) {
+	string StringUtil::TrimLeft(const string &str) {
+		return StringRef(str).TrimLeft().ToString();
+	}
 
-		string::size_type next;
+	string StringUtil::TrimRight(const string &str) {
+		return StringRef(str).TrimRight().ToString();
+	}
 
-		for (next = str.find(search); next != string::npos;
-			next = str.find(search, next)) {
+	string StringUtil::Trim(const string &str) {
+		return StringRef(str).Trim().ToString();
+	}
 
-			str.replace(next, search.length(), replace);
-			next += replace.length();
-		}
+	bool StringUtil::DetokenizeVectorToPattern(const vector<string>
+		&inputList, const string &pattern, string &out) {
+
+		return OutputTemplate::Cached(pattern).Render(inputList, out);
+	}
+
+	void StringUtil::SearchAndReplace(string &str, const string &search,
+		const string &replace) {
+
+		StringReplacer replacer;
+		replacer.Add(search, replace);
+		replacer.Replace(str);
 	}
 
 	string StringUtil::PointerToString(void *ptr) {
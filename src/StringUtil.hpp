@@ -1,20 +1,87 @@
 #ifndef INTERNETRADIO_STRINGUTIL_HPP
 #define INTERNETRADIO_STRINGUTIL_HPP
 
+#include <cstring>
+
 #include <string>
 #include <vector>
 
 namespace inetr {
+	// Non-owning view of a character range, the referenced string has to
+	// outlive it
+	class StringRef {
+	public:
+		static const size_t npos = static_cast<size_t>(-1);
+
+		StringRef() : data(""), length(0) { }
+		StringRef(const char *str) : data(str), length(strlen(str)) { }
+		StringRef(const char *data, size_t length) : data(data),
+			length(length) { }
+		StringRef(const std::string &str) : data(str.c_str()),
+			length(str.length()) { }
+
+		inline const char *Data() const { return data; }
+		inline size_t Length() const { return length; }
+		inline bool Empty() const { return length == 0; }
+		inline char operator[](size_t pos) const { return data[pos]; }
+
+		StringRef Substr(size_t pos, size_t count = npos) const;
+
+		size_t Find(char c, size_t pos = 0) const;
+		size_t Find(StringRef str, size_t pos = 0) const;
+		size_t FindFirstOf(StringRef chars, size_t pos = 0) const;
+
+		StringRef TrimLeft() const;
+		StringRef TrimRight() const;
+		StringRef Trim() const;
+
+		inline std::string ToString() const {
+			return std::string(data, length);
+		}
+	private:
+		const char *data;
+		size_t length;
+	};
+
+	bool operator==(StringRef a, StringRef b);
+	bool operator!=(StringRef a, StringRef b);
+	// Orders like std::string
+	bool operator<(StringRef a, StringRef b);
+
+	enum StringTokenizerMode { INETR_STM_Substring, INETR_STM_CharSet };
+
+	// Lazily splits a string at every occurrence of separator (or of any of
+	// its characters in INETR_STM_CharSet mode) without allocating
+	class StringTokenizer {
+	public:
+		StringTokenizer(StringRef str, StringRef separator,
+			StringTokenizerMode mode = INETR_STM_Substring,
+			bool skipEmpty = true);
+
+		// Returns false once all tokens have been read
+		bool Next(StringRef &token);
+		inline StringRef Remainder() const { return str.Substr(pos); }
+	private:
+		StringRef str;
+		StringRef separator;
+		StringTokenizerMode mode;
+		bool skipEmpty;
+		size_t pos;
+		bool done;
+	};
+
 	class StringUtil {
 	public:
-		static std::vector<std::string> Explode(std::string str,
-			std::string separator);
-		static std::string TrimLeft(std::string str);
-		static std::string TrimRight(std::string str);
-		static std::string Trim(std::string str);
-
-		static std::string DetokenizeVectorToPattern(std::vector<std::string>
-			&inputList, const std::string &pattern);
+		static std::vector<std::string> Explode(const std::string &str,
+			const std::string &separator);
+		static std::string TrimLeft(const std::string &str);
+		static std::string TrimRight(const std::string &str);
+		static std::string Trim(const std::string &str);
+
+		// Renders pattern (see OutputTemplate), returns false on references
+		// to missing values
+		static bool DetokenizeVectorToPattern(const std::vector<std::string>
+			&inputList, const std::string &pattern, std::string &out);
 
 		static void SearchAndReplace(std::string &str,
 			const std::string &search, const std::string &replace);
@@ -0,0 +1,286 @@
+#include "TextCodec.hpp"
+
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+	defined(__SSE2__)
+#define INETR_TEXTCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace inetr {
+	const wchar_t TextCodec::cp1252HighTable[32] = {
+		0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+		0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+		0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+		0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+	};
+
+	bool TextCodec::IsASCII(const char *str, size_t length) {
+		return asciiPrefix(str, length) == length;
+	}
+
+	bool TextCodec::IsValidUTF8(const char *str, size_t length) {
+		const unsigned char *data = reinterpret_cast<const unsigned char*>(
+			str);
+
+		size_t i = 0;
+		while (i < length) {
+			i += asciiPrefix(str + i, length - i);
+			if (i == length)
+				break;
+
+			unsigned long codePoint;
+			size_t sequenceLength = decodeUTF8(data + i, length - i,
+				codePoint);
+			if (sequenceLength == 0)
+				return false;
+
+			i += sequenceLength;
+		}
+
+		return true;
+	}
+
+	TextEncoding TextCodec::Detect(const char *str, size_t length) {
+		size_t prefix = asciiPrefix(str, length);
+		if (prefix == length)
+			return INETR_TE_ASCII;
+
+		if (IsValidUTF8(str + prefix, length - prefix))
+			return INETR_TE_UTF8;
+
+		// Bytes 0x80-0x9F are unused control characters in Latin-1 but
+		// printable (quotes, dashes, euro sign, ...) in Windows-1252
+		for (size_t i = prefix; i < length; ++i) {
+			unsigned char c = static_cast<unsigned char>(str[i]);
+			if (c >= 0x80 && c < 0xA0)
+				return INETR_TE_CP1252;
+		}
+
+		return INETR_TE_Latin1;
+	}
+
+	size_t TextCodec::Latin1ToUTF8(const char *in, size_t length, char *out) {
+		size_t written = 0;
+
+		size_t i = 0;
+		while (i < length) {
+			size_t prefix = asciiPrefix(in + i, length - i);
+			memcpy(out + written, in + i, prefix);
+			written += prefix;
+			i += prefix;
+
+			if (i == length)
+				break;
+
+			unsigned char c = static_cast<unsigned char>(in[i++]);
+			out[written++] = static_cast<char>(0xC0 | (c >> 6));
+			out[written++] = static_cast<char>(0x80 | (c & 0x3F));
+		}
+
+		return written;
+	}
+
+	size_t TextCodec::CP1252ToUTF8(const char *in, size_t length, char *out) {
+		size_t written = 0;
+
+		size_t i = 0;
+		while (i < length) {
+			size_t prefix = asciiPrefix(in + i, length - i);
+			memcpy(out + written, in + i, prefix);
+			written += prefix;
+			i += prefix;
+
+			if (i == length)
+				break;
+
+			unsigned char c = static_cast<unsigned char>(in[i++]);
+			unsigned long codePoint = (c < 0xA0) ? cp1252HighTable[c - 0x80] :
+				c;
+			written += encodeUTF8(codePoint, out + written);
+		}
+
+		return written;
+	}
+
+	size_t TextCodec::ToUTF8(const char *in, size_t length, char *out) {
+		switch (Detect(in, length)) {
+		case INETR_TE_Latin1:
+			return Latin1ToUTF8(in, length, out);
+		case INETR_TE_CP1252:
+			return CP1252ToUTF8(in, length, out);
+		default:
+			memcpy(out, in, length);
+			return length;
+		}
+	}
+
+	size_t TextCodec::UTF8ToUTF16(const char *in, size_t length,
+		wchar_t *out) {
+
+		const unsigned char *data = reinterpret_cast<const unsigned char*>(
+			in);
+		size_t written = 0;
+
+		size_t i = 0;
+		while (i < length) {
+			size_t prefix = asciiPrefix(in + i, length - i);
+			size_t end = i + prefix;
+
+#ifdef INETR_TEXTCODEC_SSE2
+			if (sizeof(wchar_t) == 2) {
+				__m128i zero = _mm_setzero_si128();
+				for (; i + 16 <= end; i += 16, written += 16) {
+					__m128i block = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(in + i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out +
+						written), _mm_unpacklo_epi8(block, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out +
+						written + 8), _mm_unpackhi_epi8(block, zero));
+				}
+			}
+#endif
+			for (; i < end; ++i)
+				out[written++] = static_cast<wchar_t>(data[i]);
+
+			if (i == length)
+				break;
+
+			unsigned long codePoint;
+			size_t sequenceLength = decodeUTF8(data + i, length - i,
+				codePoint);
+			if (sequenceLength == 0) {
+				codePoint = 0xFFFD;
+				sequenceLength = 1;
+			}
+			i += sequenceLength;
+
+			if (codePoint >= 0x10000) {
+				codePoint -= 0x10000;
+				out[written++] = static_cast<wchar_t>(0xD800 |
+					(codePoint >> 10));
+				out[written++] = static_cast<wchar_t>(0xDC00 |
+					(codePoint & 0x3FF));
+			} else {
+				out[written++] = static_cast<wchar_t>(codePoint);
+			}
+		}
+
+		return written;
+	}
+
+	string TextCodec::ToUTF8(const string &str) {
+		if (IsValidUTF8(str.c_str(), str.length()))
+			return str;
+
+		vector<char> buffer(str.length() * 3);
+		size_t length = ToUTF8(str.c_str(), str.length(), &buffer[0]);
+
+		return string(&buffer[0], length);
+	}
+
+	void TextCodec::AppendUTF8(string &out, unsigned long codePoint) {
+		if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) ||
+			codePoint > 0x10FFFF)
+			codePoint = 0xFFFD;
+
+		char encoded[4];
+		out.append(encoded, encodeUTF8(codePoint, encoded));
+	}
+
+	size_t TextCodec::asciiPrefix(const char *str, size_t length) {
+		size_t i = 0;
+
+#ifdef INETR_TEXTCODEC_SSE2
+		for (; i + 16 <= length; i += 16) {
+			int mask = _mm_movemask_epi8(_mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(str + i)));
+			if (mask != 0) {
+				while ((mask & 1) == 0) {
+					mask >>= 1;
+					++i;
+				}
+				return i;
+			}
+		}
+#endif
+
+		for (; i < length; ++i) {
+			if (static_cast<unsigned char>(str[i]) >= 0x80)
+				break;
+		}
+
+		return i;
+	}
+
+	size_t TextCodec::decodeUTF8(const unsigned char *str, size_t length,
+		unsigned long &codePoint) {
+
+		unsigned char lead = str[0];
+		size_t sequenceLength;
+		unsigned long minimum;
+
+		if (lead < 0x80) {
+			codePoint = lead;
+			return 1;
+		} else if ((lead & 0xE0) == 0xC0) {
+			sequenceLength = 2;
+			codePoint = lead & 0x1F;
+			minimum = 0x80;
+		} else if ((lead & 0xF0) == 0xE0) {
+			sequenceLength = 3;
+			codePoint = lead & 0x0F;
+			minimum = 0x800;
+		} else if ((lead & 0xF8) == 0xF0) {
+			sequenceLength = 4;
+			codePoint = lead & 0x07;
+			minimum = 0x10000;
+		} else {
+			return 0;
+		}
+
+		if (sequenceLength > length)
+			return 0;
+
+		for (size_t i = 1; i < sequenceLength; ++i) {
+			if ((str[i] & 0xC0) != 0x80)
+				return 0;
+			codePoint = (codePoint << 6) | (str[i] & 0x3F);
+		}
+
+		if (codePoint < minimum || codePoint > 0x10FFFF ||
+			(codePoint >= 0xD800 && codePoint <= 0xDFFF))
+			return 0;
+
+		return sequenceLength;
+	}
+
+	size_t TextCodec::encodeUTF8(unsigned long codePoint, char *out) {
+		if (codePoint < 0x80) {
+			out[0] = static_cast<char>(codePoint);
+			return 1;
+		} else if (codePoint < 0x800) {
+			out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+			out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			return 2;
+		} else if (codePoint < 0x10000) {
+			out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+			out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			return 3;
+		}
+
+		out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+		out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+		return 4;
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef INETR_TEXTCODEC_HPP
+#define INETR_TEXTCODEC_HPP
+
+#include <string>
+
+namespace inetr {
+	enum TextEncoding { INETR_TE_ASCII, INETR_TE_UTF8, INETR_TE_Latin1,
+		INETR_TE_CP1252 };
+
+	// Validation and conversion of metadata text. All conversions write into
+	// caller-provided buffers which have to be large enough for the worst
+	// case noted for each function; runs of ASCII are processed 16 bytes at
+	// a time where SSE2 is available.
+	class TextCodec {
+	public:
+		static bool IsASCII(const char *str, size_t length);
+		static bool IsValidUTF8(const char *str, size_t length);
+
+		// Guesses the charset of text that claims to be UTF-8
+		static TextEncoding Detect(const char *str, size_t length);
+
+		// out needs room for 2 * length bytes
+		static size_t Latin1ToUTF8(const char *in, size_t length, char *out);
+		// out needs room for 3 * length bytes
+		static size_t CP1252ToUTF8(const char *in, size_t length, char *out);
+		// Re-encodes mislabeled text as UTF-8, out needs room for 3 * length
+		// bytes
+		static size_t ToUTF8(const char *in, size_t length, char *out);
+		// out needs room for length units, invalid sequences become U+FFFD
+		static size_t UTF8ToUTF16(const char *in, size_t length, wchar_t *out);
+		// Surrogates and code points beyond U+10FFFF become U+FFFD, like
+		// invalid sequences do in the other conversions
+		static void AppendUTF8(std::string &out, unsigned long codePoint);
+
+		static std::string ToUTF8(const std::string &str);
+	private:
+		static const wchar_t cp1252HighTable[32];
+
+		static size_t asciiPrefix(const char *str, size_t length);
+		static size_t decodeUTF8(const unsigned char *str, size_t length,
+			unsigned long &codePoint);
+		static size_t encodeUTF8(unsigned long codePoint, char *out);
+	};
+}
+
+#endif  // !INETR_TEXTCODEC_HPP
@@ -0,0 +1,251 @@
+#include "ThumbnailPack.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+#include "MappedFile.hpp"
+
+using std::ios;
+using std::map;
+using std::ofstream;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace inetr {
+	namespace {
+		struct Record {
+			uint64_t ContentHash;
+			uint32_t Size;
+			string ImagePath;
+			const uint32_t *Pixels;
+		};
+	}
+
+	const char ThumbnailPack::magic[4] = { 'I', 'R', 'T', 'P' };
+
+	ThumbnailPack::ThumbnailPack(const string &path,
+		size_t maxEntries /* = 256 */) : file(new MappedFile(path)) {
+
+		this->path = path;
+		this->maxEntries = maxEntries;
+
+		entries = nullptr;
+		strings = nullptr;
+		if (!validate()) {
+			entries = nullptr;
+			index.clear();
+		}
+		used.assign(index.size(), false);
+
+		InitializeCriticalSection(&lock);
+	}
+
+	ThumbnailPack::~ThumbnailPack() {
+		DeleteCriticalSection(&lock);
+	}
+
+	const uint32_t *ThumbnailPack::Find(uint64_t contentHash, uint32_t size) {
+		Key key(contentHash, size);
+		const uint32_t *pixels = nullptr;
+
+		EnterCriticalSection(&lock);
+
+		map<Key, Added>::const_iterator addedIt = added.find(key);
+		if (addedIt != added.end()) {
+			pixels = &addedIt->second.Pixels[0];
+		} else if (entries != nullptr) {
+			map<Key, size_t>::const_iterator it = index.find(key);
+			if (it != index.end()) {
+				used[it->second] = true;
+				pixels = reinterpret_cast<const uint32_t*>(file->GetData() +
+					entries[it->second].PixelOffset);
+			}
+		}
+
+		LeaveCriticalSection(&lock);
+
+		return pixels;
+	}
+
+	void ThumbnailPack::Add(uint64_t contentHash, uint32_t size,
+		const string &imagePath, const vector<uint32_t> &pixels) {
+
+		if (pixels.size() != static_cast<size_t>(size) * size || size == 0)
+			return;
+
+		Added thumbnail;
+		thumbnail.ImagePath = imagePath;
+		thumbnail.Pixels = pixels;
+
+		// Pixels handed out by Find must not move, so the first one stays
+		EnterCriticalSection(&lock);
+		if (added.find(Key(contentHash, size)) == added.end())
+			added.insert(pair<Key, Added>(Key(contentHash, size), thumbnail));
+		LeaveCriticalSection(&lock);
+	}
+
+	bool ThumbnailPack::Save() {
+		EnterCriticalSection(&lock);
+
+		vector<Record> records;
+		set<string> replacedPaths;
+		set<Key> keys;
+		for (map<Key, Added>::const_iterator it = added.begin();
+			it != added.end() && records.size() < maxEntries; ++it) {
+
+			Record record;
+			record.ContentHash = it->first.first;
+			record.Size = it->first.second;
+			record.ImagePath = it->second.ImagePath;
+			record.Pixels = &it->second.Pixels[0];
+			records.push_back(record);
+
+			replacedPaths.insert(record.ImagePath);
+			keys.insert(it->first);
+		}
+
+		// Thumbnails found this session are kept before the others
+		if (entries != nullptr) {
+			for (int pass = 0; pass < 2; ++pass) {
+				for (map<Key, size_t>::const_iterator it = index.begin();
+					it != index.end() && records.size() < maxEntries; ++it) {
+
+					const Entry &entry = entries[it->second];
+					string imagePath(strings + entry.PathOffset,
+						entry.PathLength);
+					if (used[it->second] != (pass == 0) ||
+						keys.find(it->first) != keys.end() ||
+						replacedPaths.find(imagePath) != replacedPaths.end())
+						continue;
+
+					Record record;
+					record.ContentHash = entry.ContentHash;
+					record.Size = entry.Size;
+					record.ImagePath = imagePath;
+					record.Pixels = reinterpret_cast<const uint32_t*>(
+						file->GetData() + entry.PixelOffset);
+					records.push_back(record);
+				}
+			}
+		}
+
+		string stringTable;
+		vector<Entry> newEntries(records.size());
+		for (size_t i = 0; i < records.size(); ++i) {
+			memset(&newEntries[i], 0, sizeof(Entry));
+			newEntries[i].ContentHash = records[i].ContentHash;
+			newEntries[i].Size = records[i].Size;
+			newEntries[i].PathOffset = static_cast<uint32_t>(
+				stringTable.size());
+			newEntries[i].PathLength = static_cast<uint32_t>(
+				records[i].ImagePath.length());
+			stringTable.append(records[i].ImagePath);
+		}
+		// Pixels start 16 byte aligned
+		stringTable.resize((stringTable.size() + 15) & ~static_cast<size_t>(
+			15));
+
+		uint64_t pixelOffset = sizeof(Header) + newEntries.size() *
+			sizeof(Entry) + stringTable.size();
+		for (size_t i = 0; i < records.size(); ++i) {
+			newEntries[i].PixelOffset = pixelOffset;
+			pixelOffset += static_cast<uint64_t>(records[i].Size) *
+				records[i].Size * sizeof(uint32_t);
+		}
+
+		Header header;
+		memcpy(header.Magic, magic, sizeof(magic));
+		header.Version = formatVersion;
+		header.EntryCount = static_cast<uint32_t>(newEntries.size());
+		header.StringBytes = static_cast<uint32_t>(stringTable.size());
+
+		string tempPath = path + ".tmp";
+		bool written = false;
+		{
+			ofstream tempFile;
+			tempFile.open(tempPath, ios::out | ios::binary | ios::trunc);
+			if (tempFile.is_open()) {
+				tempFile.write(reinterpret_cast<const char*>(&header),
+					sizeof(header));
+				if (!newEntries.empty())
+					tempFile.write(reinterpret_cast<const char*>(
+						&newEntries[0]), newEntries.size() * sizeof(Entry));
+				tempFile.write(stringTable.data(), stringTable.size());
+				for (size_t i = 0; i < records.size(); ++i)
+					tempFile.write(reinterpret_cast<const char*>(
+						records[i].Pixels), static_cast<std::streamsize>(
+						records[i].Size) * records[i].Size * sizeof(uint32_t));
+
+				written = !tempFile.fail();
+			}
+		}
+
+		// The old pack has to be unmapped before it can be replaced
+		entries = nullptr;
+		strings = nullptr;
+		index.clear();
+		used.clear();
+		added.clear();
+		file.reset();
+
+		LeaveCriticalSection(&lock);
+
+		if (!written) {
+			DeleteFile(tempPath.c_str());
+			return false;
+		}
+
+		return MoveFileEx(tempPath.c_str(), path.c_str(),
+			MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
+	bool ThumbnailPack::validate() {
+		if (!file->IsOpen() || file->GetSize() < sizeof(Header))
+			return false;
+
+		const Header *header = reinterpret_cast<const Header*>(
+			file->GetData());
+		if (memcmp(header->Magic, magic, sizeof(magic)) != 0 ||
+			header->Version != formatVersion)
+			return false;
+
+		uint64_t fileSize = file->GetSize();
+		uint64_t stringsEnd = sizeof(Header) + static_cast<uint64_t>(
+			header->EntryCount) * sizeof(Entry) + header->StringBytes;
+		if (stringsEnd > fileSize)
+			return false;
+
+		entries = reinterpret_cast<const Entry*>(file->GetData() +
+			sizeof(Header));
+		strings = reinterpret_cast<const char*>(entries + header->EntryCount);
+
+		for (uint32_t i = 0; i < header->EntryCount; ++i) {
+			const Entry &entry = entries[i];
+			uint64_t pixelBytes = static_cast<uint64_t>(entry.Size) *
+				entry.Size * sizeof(uint32_t);
+			if (entry.PathOffset > header->StringBytes ||
+				entry.PathLength > header->StringBytes - entry.PathOffset ||
+				entry.PixelOffset < stringsEnd || entry.PixelOffset %
+				sizeof(uint32_t) != 0 || pixelBytes > fileSize ||
+				entry.PixelOffset > fileSize - pixelBytes)
+				return false;
+
+			index.insert(pair<Key, size_t>(Key(entry.ContentHash,
+				entry.Size), i));
+		}
+
+		return true;
+	}
+}
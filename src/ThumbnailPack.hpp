@@ -0,0 +1,83 @@
+#ifndef INETR_THUMBNAILPACK_HPP
+#define INETR_THUMBNAILPACK_HPP
+
+#include <cstdint>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Windows.h>
+
+#include "MappedFile.hpp"
+
+namespace inetr {
+	// Finished station thumbnails as raw premultiplied BGRA pixels in one
+	// memory-mapped file. Thumbnails are keyed by the hash of the image file
+	// they were made from and their size, so a changed image simply misses
+	// and its new thumbnail replaces the old one on the next Save.
+	class ThumbnailPack {
+	public:
+		ThumbnailPack(const std::string &path, size_t maxEntries = 256);
+		~ThumbnailPack();
+
+		// Returns size x size pixels or nullptr, the pixels stay valid until
+		// Save. May be called from any thread.
+		const uint32_t *Find(uint64_t contentHash, uint32_t size);
+		void Add(uint64_t contentHash, uint32_t size,
+			const std::string &imagePath, const std::vector<uint32_t> &pixels);
+
+		// Rewrites the pack with the thumbnails added since it was opened
+		// first, then those that were found, then the rest up to maxEntries.
+		// The pack is closed afterwards.
+		bool Save();
+	private:
+		struct Header {
+			char Magic[4];
+			uint32_t Version;
+			uint32_t EntryCount;
+			uint32_t StringBytes;
+		};
+
+		struct Entry {
+			uint64_t ContentHash;
+			uint32_t Size;
+			uint32_t PathOffset;
+			uint32_t PathLength;
+			uint32_t Reserved;
+			uint64_t PixelOffset;
+		};
+
+		struct Added {
+			std::string ImagePath;
+			std::vector<uint32_t> Pixels;
+		};
+
+		typedef std::pair<uint64_t, uint32_t> Key;
+
+		ThumbnailPack(const ThumbnailPack &original);
+		ThumbnailPack& operator=(const ThumbnailPack &original);
+
+		static const char magic[4];
+		static const uint32_t formatVersion = 1;
+
+		bool validate();
+
+		std::string path;
+		size_t maxEntries;
+
+		std::unique_ptr<MappedFile> file;
+		const Entry *entries;
+		const char *strings;
+		std::map<Key, size_t> index;
+		std::vector<bool> used;
+
+		std::map<Key, Added> added;
+
+		CRITICAL_SECTION lock;
+	};
+}
+
+#endif  // !INETR_THUMBNAILPACK_HPP
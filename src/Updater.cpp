@@ -5,16 +5,20 @@
 #include <algorithm>
 #include <fstream>
 #include <map>
+#include <ostream>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <ShlObj.h>
 #include <Windows.h>
 
 #include "../resource/resource.h"
 
+#include "ChecksumStreamBuf.hpp"
 #include "CryptUtil.hpp"
+#include "FileHashCache.hpp"
 #include "HTTP.hpp"
 #include "INETRException.hpp"
 #include "MUtil.hpp"
@@ -27,6 +31,7 @@ using std::ios;
 using std::vector;
 using std::map;
 using std::ofstream;
+using std::ostream;
 using std::pair;
 using std::string;
 using std::stringstream;
@@ -34,6 +39,7 @@ using std::stringstream;
 namespace inetr {
 	Updater::Updater(string remoteUpdateRoot) {
 		this->remoteUpdateRoot = remoteUpdateRoot;
+		checksumAlgorithm = INETR_HA_MD5;
 	}
 
 	bool Updater::GetRemoteVersion(uint16_t *version) {
@@ -86,51 +92,80 @@ namespace inetr {
 	bool Updater::PrepareUpdateToRemoteVersion(uint16_t *version) {
 		memset(versionToUpdateTo, 0, sizeof(versionToUpdateTo));
 		remoteFilesToDownload.clear();
+		remoteFileChecksums.clear();
 
 		string versionStr;
 		VersionUtil::VersionArrToStr(version, versionStr, true);
 
-		stringstream remoteChecksumsStream;
-		try {
-			HTTP::Get(remoteUpdateRoot + "/" + versionStr + "/" + INETR_ARCH +
-				"/checksums", &remoteChecksumsStream);
-		} catch(INETRException) {
-			return false;
+		// Releases carry a list tagged with a faster algorithm next to the
+		// MD5 one older versions read
+		string remoteArchRoot = remoteUpdateRoot + "/" + versionStr + "/" +
+			INETR_ARCH;
+		string remoteChecksums;
+		bool haveChecksums = false;
+		const char *checksumLists[] = { "/checksums2", "/checksums" };
+		for (int i = 0; i < 2 && !haveChecksums; ++i) {
+			stringstream remoteChecksumsStream;
+			try {
+				HTTP::Get(remoteArchRoot + checksumLists[i],
+					&remoteChecksumsStream);
+			} catch(INETRException) {
+				continue;
+			}
+
+			remoteChecksums = remoteChecksumsStream.str();
+			haveChecksums = CryptUtil::StripAlgorithmTag(remoteChecksums,
+				checksumAlgorithm);
 		}
+		if (!haveChecksums)
+			return false;
 
-		map<string, string> remoteFileChecksums;
-		while (remoteChecksumsStream.good()) {
-			string filePathAndChecksum;
-			remoteChecksumsStream >> filePathAndChecksum;
-			if (filePathAndChecksum == "")
+		StringTokenizer checksumEntries(remoteChecksums, " \t\r\n",
+			INETR_STM_CharSet);
+		StringRef filePathAndChecksum;
+		while (checksumEntries.Next(filePathAndChecksum)) {
+			StringTokenizer fields(filePathAndChecksum, ":");
+			StringRef filePath, checksum, extraField;
+			if (!fields.Next(filePath) || !fields.Next(checksum) ||
+				fields.Next(extraField))
 				continue;
-			vector<string> filePathAndChecksumSplit = StringUtil::Explode(
-				filePathAndChecksum, ":");
+
 			remoteFileChecksums.insert(pair<string, string>(
-				filePathAndChecksumSplit[0], filePathAndChecksumSplit[1]));
+				filePath.ToString(), checksum.ToString()));
 		}
 
+		vector<string> localFiles;
 		for (map<string, string>::iterator it = remoteFileChecksums.begin();
 			it != remoteFileChecksums.end(); ++it) {
 
 			ifstream localFileStream(it->first);
 			if (localFileStream.is_open()) {
 				localFileStream.close();
-				string md5Hash;
-				try {
-					md5Hash = CryptUtil::FileMD5Hash(it->first);
-				} catch(INETRException) {
-					return false;
-				}
-				if (md5Hash != "" && md5Hash == it->second)
-					continue;
+				localFiles.push_back(it->first);
 			} else if (find(OptionalFiles.begin(), OptionalFiles.end(),
-				it->first) != OptionalFiles.end()) {
+				it->first) == OptionalFiles.end()) {
 
-				continue;
+				remoteFilesToDownload.push_back(it->first);
 			}
+		}
 
-			remoteFilesToDownload.push_back(it->first);
+		// Installed files only change with an update, they are read again
+		// only if their size, write time or file ID changed
+		char appDataPath[MAX_PATH];
+		SHGetFolderPath(nullptr, CSIDL_COMMON_APPDATA, nullptr,
+			SHGFP_TYPE_CURRENT, appDataPath);
+		FileHashCache hashCache(string(appDataPath) +
+			"\\InternetRadio\\updatehashes");
+
+		vector<string> localChecksums;
+		hashCache.FileHashes(localFiles, checksumAlgorithm, localChecksums);
+		hashCache.Save();
+		for (size_t i = 0; i < localFiles.size(); ++i) {
+			if (localChecksums[i].empty())
+				return false;
+
+			if (localChecksums[i] != remoteFileChecksums[localFiles[i]])
+				remoteFilesToDownload.push_back(localFiles[i]);
 		}
 
 		if (remoteFilesToDownload.empty())
@@ -185,39 +220,109 @@ namespace inetr {
 	}
 
 	bool Updater::PerformPreparedUpdate() {
+		// Nothing is replaced before every file has been downloaded and
+		// verified, a failed download leaves the installation as it was
+		vector<string> localFilenames;
 		for (vector<string>::iterator it = remoteFilesToDownload.begin();
 			it != remoteFilesToDownload.end(); ++it) {
 
-			string remoteFilename = *it;
-			StringUtil::SearchAndReplace(remoteFilename, "\\", "/");
 			string localFilename = *it;
 			StringUtil::SearchAndReplace(localFilename, "/", "\\");
+			localFilenames.push_back(localFilename);
 
-			string versionStr;
-			VersionUtil::VersionArrToStr(versionToUpdateTo, versionStr, true);
+			if (!downloadFile(*it, localFilename + ".download")) {
+				for (vector<string>::iterator dlIt = localFilenames.begin();
+					dlIt != localFilenames.end(); ++dlIt) {
 
-			string remoteURL = remoteUpdateRoot + "/" + versionStr + "/" +
-				INETR_ARCH + "/" + remoteFilename;
+					DeleteFile((*dlIt + ".download").c_str());
+				}
 
+				return false;
+			}
+		}
+
+		// A running executable can be renamed but not overwritten. If any
+		// file can't be put in place the ones replaced before are restored.
+		vector<bool> hadOriginals;
+		size_t replaced = 0;
+		for (; replaced < localFilenames.size(); ++replaced) {
+			const string &localFilename = localFilenames[replaced];
+			string localDlFilename = localFilename + ".download";
 			string localTmpFilename = localFilename + ".updatetmp";
+
 			DeleteFile(localTmpFilename.c_str());
-			MoveFile(localFilename.c_str(), localTmpFilename.c_str());
+			bool hadOriginal = MoveFile(localFilename.c_str(),
+				localTmpFilename.c_str()) != FALSE;
+			hadOriginals.push_back(hadOriginal);
+
+			if (!MoveFile(localDlFilename.c_str(), localFilename.c_str())) {
+				if (hadOriginal)
+					MoveFile(localTmpFilename.c_str(), localFilename.c_str());
+				break;
+			}
+		}
 
-			stringstream remoteFileStream;
-			try {
-				HTTP::Get(remoteURL, &remoteFileStream);
-			} catch(INETRException) {
-				return false;
+		if (replaced < localFilenames.size()) {
+			for (size_t i = 0; i < replaced; ++i) {
+				string localTmpFilename = localFilenames[i] + ".updatetmp";
+				if (hadOriginals[i])
+					MoveFileEx(localTmpFilename.c_str(),
+						localFilenames[i].c_str(), MOVEFILE_REPLACE_EXISTING);
+				else
+					DeleteFile(localFilenames[i].c_str());
 			}
 
-			ofstream localFileStream;
-			localFileStream.open(localFilename, ios::out | ios::binary);
+			for (size_t i = replaced; i < localFilenames.size(); ++i)
+				DeleteFile((localFilenames[i] + ".download").c_str());
 
-			localFileStream << remoteFileStream.rdbuf();
+			return false;
+		}
+
+		for (vector<string>::iterator it = localFilenames.begin();
+			it != localFilenames.end(); ++it) {
+
+			DeleteFile((*it + ".updatetmp").c_str());
+		}
+
+		return true;
+	}
+
+	bool Updater::downloadFile(const string &file,
+		const string &localDlFilename) {
+
+		string remoteFilename = file;
+		StringUtil::SearchAndReplace(remoteFilename, "\\", "/");
+
+		string versionStr;
+		VersionUtil::VersionArrToStr(versionToUpdateTo, versionStr, true);
+
+		string remoteURL = remoteUpdateRoot + "/" + versionStr + "/" +
+			INETR_ARCH + "/" + remoteFilename;
+
+		// The download is checked while it is written
+		ofstream localFileStream;
+		localFileStream.open(localDlFilename, ios::out | ios::binary |
+			ios::trunc);
+		if (!localFileStream.is_open())
+			return false;
 
+		ChecksumStreamBuf checksumBuf(localFileStream.rdbuf(),
+			checksumAlgorithm);
+		ostream checksumStream(&checksumBuf);
+		try {
+			HTTP::Get(remoteURL, &checksumStream);
+		} catch(INETRException) {
 			localFileStream.close();
+			DeleteFile(localDlFilename.c_str());
+			return false;
+		}
 
-			DeleteFile(localTmpFilename.c_str());
+		localFileStream.close();
+		if (localFileStream.fail() || checksumStream.fail() ||
+			checksumBuf.Final() != remoteFileChecksums[file]) {
+
+			DeleteFile(localDlFilename.c_str());
+			return false;
 		}
 
 		return true;
@@ -242,11 +347,17 @@ namespace inetr {
 			* sizeof(uint16_t));
 		UnmapViewOfFile(versionMappingPtr);
 
-		size_t filesToDlMappingSize = 0;
+		// The checksum algorithm comes first and every file is followed by
+		// its checksum for the elevated process to verify the download
+		// against
+		string algorithmName = CryptUtil::HashAlgorithmName(
+			checksumAlgorithm);
+		size_t filesToDlMappingSize = algorithmName.length() + 1;
 		for (vector<string>::iterator it = remoteFilesToDownload.begin();
 			it != remoteFilesToDownload.end(); ++it) {
 
-				filesToDlMappingSize += it->length() + 1;
+				filesToDlMappingSize += it->length() + 1 +
+					remoteFileChecksums[*it].length() + 1;
 		}
 		filesToDlMappingSize += 1;
 
@@ -285,11 +396,17 @@ namespace inetr {
 		}
 
 		char *ptr = reinterpret_cast<char*>(filesToDlPtr);
+		memcpy(ptr, algorithmName.c_str(), algorithmName.length() + 1);
+		ptr += (ptrdiff_t)(algorithmName.length() + 1);
 		for (vector<string>::iterator it = remoteFilesToDownload.begin();
 			it != remoteFilesToDownload.end(); ++it) {
 
 				memcpy(ptr, it->c_str(), it->length() + 1);
 				ptr += (ptrdiff_t)(it->length() + 1);
+
+				const string &checksum = remoteFileChecksums[*it];
+				memcpy(ptr, checksum.c_str(), checksum.length() + 1);
+				ptr += (ptrdiff_t)(checksum.length() + 1);
 		}
 		*ptr = '\0';
 
@@ -346,15 +463,23 @@ namespace inetr {
 		}
 
 		char *ptr = reinterpret_cast<char*>(filesToDlPtr);
-		while (*ptr != '\0') {
-			remoteFilesToDownload.push_back(string(ptr));
+		bool knownAlgorithm = CryptUtil::HashAlgorithmFromName(string(ptr),
+			checksumAlgorithm);
+		ptr += (ptrdiff_t)(strlen(ptr) + 1);
+		while (knownAlgorithm && *ptr != '\0') {
+			string file(ptr);
 			ptr += (ptrdiff_t)(strlen(ptr) + 1);
+			string checksum(ptr);
+			ptr += (ptrdiff_t)(strlen(ptr) + 1);
+
+			remoteFilesToDownload.push_back(file);
+			remoteFileChecksums[file] = checksum;
 		}
 
 		UnmapViewOfFile(filesToDlPtr);
 		CloseHandle(filesToDlMapping);
 
-		return true;
+		return knownAlgorithm;
 	}
 
 	void Updater::FreeUpdateInformationSharedMemory() {
@@ -3,10 +3,13 @@
 
 #include <cstdint>
 
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "CryptUtil.hpp"
+
 namespace inetr {
 	class Updater {
 	public:
@@ -28,6 +31,9 @@ namespace inetr {
 		std::vector<std::string> OptionalFiles;
 
 	private:
+		bool downloadFile(const std::string &file,
+			const std::string &localDlFilename);
+
 		std::string remoteUpdateRoot;
 
 		void *versionToUpdateToMapping;
@@ -36,6 +42,8 @@ namespace inetr {
 
 		uint16_t versionToUpdateTo[4];
 		std::vector<std::string> remoteFilesToDownload;
+		std::map<std::string, std::string> remoteFileChecksums;
+		HashAlgorithm checksumAlgorithm;
 	};
 }
 
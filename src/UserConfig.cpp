@@ -2,22 +2,17 @@
 
 #include <algorithm>
 #include <fstream>
-#include <list>
 #include <string>
-#include <vector>
 
 #include <ShlObj.h>
 
 #include <json/json.h>
 
-using std::find_if;
 using std::for_each;
 using std::ifstream;
 using std::ios;
-using std::list;
 using std::ofstream;
 using std::string;
-using std::vector;
 using Json::arrayValue;
 using Json::nullValue;
 using Json::objectValue;
@@ -68,20 +63,15 @@ namespace inetr {
 				}
 				string favSta = favStaVal.asString();
 
-				list<Station>::const_iterator it = find_if(stations.begin(),
-					stations.end(), [&favSta](const Station &elem) {
-
-					return elem.Identifier == favSta;
-				});
-
-				if (it == stations.end()) {
+				const Station *station = stations.Find(favSta);
+				if (station == nullptr) {
 					MessageBox(nullptr, ("Unable to load user config, unknown \
 						station: " + favSta).c_str(), "Error", MB_OK |
 						MB_ICONERROR);
 					continue;
 				}
 
-				FavoriteStations.push_back(&*it);
+				FavoriteStations.push_back(station);
 			}
 		}
 
@@ -92,18 +82,12 @@ namespace inetr {
 		} else {
 			string languageStr = languageVal.asString();
 
-			vector<Language>::const_iterator it = find_if(languages.begin(),
-				languages.end(), [&languageStr](const Language &elem) {
-
-				return elem.Identifier == languageStr;
-			});
-
-			if (it == languages.end()) {
+			if (!languages.IsLanguageLoaded(languageStr)) {
 				MessageBox(nullptr, ("Unable to load user config, unknown \
 					language: " + languageStr).c_str(), "Error", MB_OK |
 					MB_ICONERROR);
 			} else {
-				CurrentLanguage = *it;
+				CurrentLanguage = languages[languageStr];
 			}
 		}
 
@@ -126,7 +110,8 @@ namespace inetr {
 		for_each(FavoriteStations.begin(), FavoriteStations.end(),
 			[&rootValue](const Station* &elem) {
 
-			rootValue["favoriteStations"].append(Value(elem->Identifier));
+			rootValue["favoriteStations"].append(Value(
+				elem->GetIdentifier().Data()));
 		});
 
 		rootValue["language"] = Value(CurrentLanguage.Identifier);
@@ -1,8 +1,9 @@
 #include "VersionUtil.hpp"
 
+#include <cctype>
+
 #include <sstream>
 #include <string>
-#include <vector>
 
 #include <Windows.h>
 
@@ -10,7 +11,6 @@
 
 using std::string;
 using std::stringstream;
-using std::vector;
 
 namespace inetr {
 	struct LANGANDCODEPAGE {
@@ -72,13 +72,21 @@ namespace inetr {
 	}
 
 	void VersionUtil::VersionStrToArr(string &verStr, uint16_t *version) {
-		vector<string> verDigitStrs = StringUtil::Explode(verStr, ".");
+		StringTokenizer verDigitStrs(verStr, ".");
 
 		for (size_t i = 0; i < 4; ++i) {
-			if (verDigitStrs.size() > i)
-				version[i] = atoi(verDigitStrs[i].c_str());
-			else
-				version[i] = 0;
+			version[i] = 0;
+
+			StringRef verDigitStr;
+			if (!verDigitStrs.Next(verDigitStr))
+				continue;
+
+			for (size_t j = 0; j < verDigitStr.Length() &&
+				isdigit(static_cast<unsigned char>(verDigitStr[j])); ++j) {
+
+				version[i] = static_cast<uint16_t>(version[i] * 10 +
+					(verDigitStr[j] - '0'));
+			}
 		}
 	}
 
@@ -0,0 +1,132 @@
+#include "XXH64.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+
+using std::string;
+
+#define INETR_XXH64_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+namespace inetr {
+	XXH64::XXH64(uint64_t seed /* = 0 */) {
+		this->seed = seed;
+		accumulators[0] = seed + prime1 + prime2;
+		accumulators[1] = seed + prime2;
+		accumulators[2] = seed;
+		accumulators[3] = seed - prime1;
+		length = 0;
+		buffered = 0;
+	}
+
+	void XXH64::Update(const void *data, size_t length) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		this->length += length;
+
+		if (buffered > 0) {
+			size_t taken = (length < 32 - buffered) ? length : 32 - buffered;
+			memcpy(buffer + buffered, bytes, taken);
+			buffered += taken;
+			bytes += taken;
+			length -= taken;
+
+			if (buffered < 32)
+				return;
+			for (int i = 0; i < 4; ++i)
+				accumulators[i] = round(accumulators[i], read64(buffer + i * 8));
+			buffered = 0;
+		}
+
+		// Four independent lanes, which keeps the multiplier busy
+		uint64_t v1 = accumulators[0], v2 = accumulators[1],
+			v3 = accumulators[2], v4 = accumulators[3];
+		for (; length >= 32; bytes += 32, length -= 32) {
+			v1 = round(v1, read64(bytes));
+			v2 = round(v2, read64(bytes + 8));
+			v3 = round(v3, read64(bytes + 16));
+			v4 = round(v4, read64(bytes + 24));
+		}
+		accumulators[0] = v1;
+		accumulators[1] = v2;
+		accumulators[2] = v3;
+		accumulators[3] = v4;
+
+		if (length > 0)
+			memcpy(buffer, bytes, length);
+		buffered = length;
+	}
+
+	uint64_t XXH64::Final() const {
+		uint64_t hash;
+		if (length >= 32) {
+			hash = INETR_XXH64_ROTL(accumulators[0], 1) +
+				INETR_XXH64_ROTL(accumulators[1], 7) +
+				INETR_XXH64_ROTL(accumulators[2], 12) +
+				INETR_XXH64_ROTL(accumulators[3], 18);
+			for (int i = 0; i < 4; ++i)
+				hash = mergeRound(hash, accumulators[i]);
+		} else {
+			hash = seed + prime5;
+		}
+		hash += length;
+
+		const unsigned char *p = buffer;
+		size_t rest = buffered;
+		for (; rest >= 8; p += 8, rest -= 8) {
+			hash ^= round(0, read64(p));
+			hash = INETR_XXH64_ROTL(hash, 27) * prime1 + prime4;
+		}
+		if (rest >= 4) {
+			hash ^= static_cast<uint64_t>(read32(p)) * prime1;
+			hash = INETR_XXH64_ROTL(hash, 23) * prime2 + prime3;
+			p += 4;
+			rest -= 4;
+		}
+		for (; rest > 0; ++p, --rest) {
+			hash ^= *p * prime5;
+			hash = INETR_XXH64_ROTL(hash, 11) * prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	string XXH64::ToHex(uint64_t digest) {
+		const char hexDigits[] = "0123456789abcdef";
+
+		string hex(16, '0');
+		for (int i = 15; i >= 0; --i, digest >>= 4)
+			hex[i] = hexDigits[digest & 0x0F];
+
+		return hex;
+	}
+
+	uint64_t XXH64::round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * prime2;
+		accumulator = INETR_XXH64_ROTL(accumulator, 31);
+		return accumulator * prime1;
+	}
+
+	uint64_t XXH64::mergeRound(uint64_t accumulator, uint64_t value) {
+		accumulator ^= round(0, value);
+		return accumulator * prime1 + prime4;
+	}
+
+	uint64_t XXH64::read64(const unsigned char *p) {
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t XXH64::read32(const unsigned char *p) {
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef INETR_XXH64_HPP
+#define INETR_XXH64_HPP
+
+#include <cstdint>
+
+#include <string>
+
+namespace inetr {
+	// Portable XXH64, a non-cryptographic hash several times faster than
+	// MD5. It only guards against corruption, which is all the checksum
+	// manifests need.
+	class XXH64 {
+	public:
+		XXH64(uint64_t seed = 0);
+
+		void Update(const void *data, size_t length);
+		uint64_t Final() const;
+
+		// Big endian, the way the reference implementation prints digests
+		static std::string ToHex(uint64_t digest);
+	private:
+		static const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+		static const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+		static const uint64_t prime3 = 0x165667B19E3779F9ULL;
+		static const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+		static const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+		static uint64_t round(uint64_t accumulator, uint64_t input);
+		static uint64_t mergeRound(uint64_t accumulator, uint64_t value);
+		static uint64_t read64(const unsigned char *p);
+		static uint32_t read32(const unsigned char *p);
+
+		uint64_t seed;
+		uint64_t accumulators[4];
+		uint64_t length;
+		unsigned char buffer[32];
+		size_t buffered;
+	};
+}
+
+#endif  // !INETR_XXH64_HPP
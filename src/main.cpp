@@ -1,26 +1,24 @@
 #include <Windows.h>
 
 #include <string>
-#include <vector>
 
 #include "MainWindow.hpp"
 #include "StringUtil.hpp"
 #include "Updater.hpp"
 
 using std::string;
-using std::vector;
 using inetr::MainWindow;
-using inetr::StringUtil;
+using inetr::StringRef;
+using inetr::StringTokenizer;
 using inetr::Updater;
 
 int CALLBACK WinMain(__in HINSTANCE hInstance, __in_opt HINSTANCE hPrevInstance,
 	__in LPSTR lpCmdLine, __in int nShowCmd) {
 
-	vector<string> cmdLineArgs = StringUtil::Explode(lpCmdLine, " ");
-	for(vector<string>::iterator it = cmdLineArgs.begin(); it !=
-		cmdLineArgs.end(); ++it) {
-
-		if (*it == "/update") {
+	StringTokenizer cmdLineArgs(lpCmdLine, " ");
+	StringRef arg;
+	while (cmdLineArgs.Next(arg)) {
+		if (arg == "/update") {
 			Updater u(string("http://internetradio.clemensboos.net/publish"));
 			if (!u.FetchUpdateInformationFromSharedMemory())
 				return 1;